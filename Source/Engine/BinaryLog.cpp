@@ -0,0 +1,203 @@
+#include "pch.h"
+#include "BinaryLog.h"
+
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+
+namespace Armillary
+{
+    namespace BinaryLog
+    {
+        namespace
+        {
+            std::mutex g_FormatsLock;
+            std::deque<FormatInfo> g_Formats;
+
+            template <typename T>
+            bool ReadValue(const uint8_t*& cursor, const uint8_t* end, T& value)
+            {
+                if ((size_t)(end - cursor) < sizeof(T))
+                    return false;
+                std::memcpy(&value, cursor, sizeof(T));
+                cursor += sizeof(T);
+                return true;
+            }
+
+            bool AppendArg(std::string& out, const uint8_t*& cursor, const uint8_t* end)
+            {
+                uint8_t type = 0;
+                if (!ReadValue(cursor, end, type))
+                    return false;
+
+                char text[32];
+                switch ((LogArgType)type)
+                {
+                case LogArgType::Int32:   { int32_t v;  if (!ReadValue(cursor, end, v)) return false; out += std::to_string(v); return true; }
+                case LogArgType::UInt32:  { uint32_t v; if (!ReadValue(cursor, end, v)) return false; out += std::to_string(v); return true; }
+                case LogArgType::Int64:   { int64_t v;  if (!ReadValue(cursor, end, v)) return false; out += std::to_string(v); return true; }
+                case LogArgType::UInt64:  { uint64_t v; if (!ReadValue(cursor, end, v)) return false; out += std::to_string(v); return true; }
+                case LogArgType::Float:   { float v;    if (!ReadValue(cursor, end, v)) return false; std::snprintf(text, sizeof(text), "%g", v); out += text; return true; }
+                case LogArgType::Double:  { double v;   if (!ReadValue(cursor, end, v)) return false; std::snprintf(text, sizeof(text), "%g", v); out += text; return true; }
+                case LogArgType::Bool:    { uint8_t v;  if (!ReadValue(cursor, end, v)) return false; out += v ? "true" : "false"; return true; }
+                case LogArgType::Char:    { char v;     if (!ReadValue(cursor, end, v)) return false; out += v; return true; }
+                case LogArgType::Pointer: { uint64_t v; if (!ReadValue(cursor, end, v)) return false; std::snprintf(text, sizeof(text), "0x%016llx", (unsigned long long)v); out += text; return true; }
+                case LogArgType::String:
+                {
+                    uint16_t length = 0;
+                    if (!ReadValue(cursor, end, length) || (size_t)(end - cursor) < length)
+                        return false;
+                    out.append((const char*)cursor, length);
+                    cursor += length;
+                    return true;
+                }
+                default:
+                    return false;
+                }
+            }
+        }
+
+        uint32_t RegisterFormat(LogLevel level, const char* file, uint32_t line, const char* format)
+        {
+            std::lock_guard<std::mutex> lock(g_FormatsLock);
+            FormatInfo& info = g_Formats.emplace_back();
+            info.Level = level;
+            info.File = file ? file : "";
+            info.Line = line;
+            info.Format = format ? format : "";
+            return (uint32_t)(g_Formats.size() - 1);
+        }
+
+        bool GetFormat(uint32_t formatId, FormatInfo& outInfo)
+        {
+            std::lock_guard<std::mutex> lock(g_FormatsLock);
+            if (formatId >= g_Formats.size())
+                return false;
+            outInfo = g_Formats[formatId];
+            return true;
+        }
+
+        std::string FormatPayload(const std::string& format, const uint8_t* payload, size_t size)
+        {
+            const uint8_t* cursor = payload + sizeof(uint32_t) + 1;
+            const uint8_t* end = payload + size;
+            uint32_t remaining = size > sizeof(uint32_t) ? payload[sizeof(uint32_t)] : 0;
+            if (cursor > end)
+                cursor = end;
+
+            std::string out;
+            out.reserve(format.size() + 32);
+            for (size_t i = 0; i < format.size(); ++i)
+            {
+                char c = format[i];
+                if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c)
+                {
+                    // {{ and }} are escaped braces
+                    out += c;
+                    ++i;
+                }
+                else if (c == '{' && i + 1 < format.size() && format[i + 1] == '}' && remaining > 0)
+                {
+                    if (!AppendArg(out, cursor, end))
+                    {
+                        out += "<corrupt>";
+                        remaining = 0;
+                    }
+                    else
+                    {
+                        --remaining;
+                    }
+                    ++i;
+                }
+                else
+                {
+                    out += c;
+                }
+            }
+            return out;
+        }
+
+        bool DecodeFile(const std::string& path, std::ostream& out)
+        {
+            std::ifstream file(path, std::ios::in | std::ios::binary);
+            if (!file.is_open())
+                return false;
+
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            file.read((char*)&magic, sizeof(magic));
+            file.read((char*)&version, sizeof(version));
+            if (!file || magic != FileMagic || version != FileVersion)
+                return false;
+
+            std::vector<FormatInfo> formats;
+            std::string buffer;
+            uint8_t kind = 0;
+            while (file.read((char*)&kind, 1))
+            {
+                if (kind == RecordFormat)
+                {
+                    uint32_t id = 0;
+                    uint8_t level = 0;
+                    uint32_t line = 0;
+                    uint16_t fileLength = 0;
+                    uint16_t formatLength = 0;
+                    file.read((char*)&id, sizeof(id));
+                    file.read((char*)&level, sizeof(level));
+                    file.read((char*)&line, sizeof(line));
+
+                    FormatInfo info;
+                    info.Level = (LogLevel)level;
+                    info.Line = line;
+                    file.read((char*)&fileLength, sizeof(fileLength));
+                    info.File.resize(fileLength);
+                    file.read(info.File.data(), fileLength);
+                    file.read((char*)&formatLength, sizeof(formatLength));
+                    info.Format.resize(formatLength);
+                    file.read(info.Format.data(), formatLength);
+                    if (!file)
+                        return false;
+
+                    if (id >= formats.size())
+                        formats.resize(id + 1);
+                    formats[id] = std::move(info);
+                }
+                else if (kind == RecordMessage)
+                {
+                    int64_t microseconds = 0;
+                    uint16_t size = 0;
+                    file.read((char*)&microseconds, sizeof(microseconds));
+                    file.read((char*)&size, sizeof(size));
+                    buffer.resize(size);
+                    file.read(buffer.data(), size);
+                    if (!file || size < sizeof(uint32_t))
+                        return false;
+
+                    uint32_t id = 0;
+                    std::memcpy(&id, buffer.data(), sizeof(id));
+
+                    auto ticks = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::microseconds(microseconds)).count();
+                    out << '[' << Logger::FormatTimestamp(ticks) << "] ";
+                    if (id < formats.size())
+                    {
+                        out << '[' << Logger::LevelToString(formats[id].Level) << "] "
+                            << FormatPayload(formats[id].Format, (const uint8_t*)buffer.data(), buffer.size()) << '\n';
+                    }
+                    else
+                    {
+                        out << "[UNKNOWN] <missing format " << id << ">\n";
+                    }
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+} // namespace Armillary
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "Logger.h"
+
+namespace Armillary
+{
+
+    // Binary structured logging: a call site registers its format string once and then
+    // only ships the format id plus raw arguments. Text is produced on the writer thread
+    // or offline by the decoder (see LogDecoder), never on the calling thread.
+    //
+    // .alog layout (little endian):
+    //   header  : "ALOG" u32 version
+    //   format  : u8 RecordFormat, u32 id, u8 level, u32 line, u16 len file, u16 len format
+    //   message : u8 RecordMessage, i64 microseconds since epoch, u16 payload size, payload
+    //   payload : u32 format id, u8 arg count, then per arg u8 LogArgType + value
+    namespace BinaryLog
+    {
+        constexpr uint32_t FileMagic = 0x474F4C41; // "ALOG"
+        constexpr uint32_t FileVersion = 1;
+        constexpr uint8_t RecordFormat = 1;
+        constexpr uint8_t RecordMessage = 2;
+        constexpr size_t MaxPayloadSize = 1024;
+
+        enum class LogArgType : uint8_t
+        {
+            Int32,
+            UInt32,
+            Int64,
+            UInt64,
+            Float,
+            Double,
+            Bool,
+            Char,
+            String,
+            Pointer
+        };
+
+        struct FormatInfo
+        {
+            LogLevel Level = LogLevel::Info;
+            std::string File;
+            uint32_t Line = 0;
+            std::string Format;
+        };
+
+        uint32_t RegisterFormat(LogLevel level, const char* file, uint32_t line, const char* format);
+        bool GetFormat(uint32_t formatId, FormatInfo& outInfo);
+
+        // Replaces each "{}" in the format with the next decoded argument
+        std::string FormatPayload(const std::string& format, const uint8_t* payload, size_t size);
+
+        // Turns a .alog file back into the same text the Logger would have written
+        bool DecodeFile(const std::string& path, std::ostream& out);
+
+        class PayloadWriter
+        {
+        public:
+            explicit PayloadWriter(uint32_t formatId)
+            {
+                Put(&formatId, sizeof(formatId));
+                m_Size += 1; // arg count, patched as arguments are added
+            }
+
+            template <typename T>
+            void Add(const T& value)
+            {
+                using Type = std::decay_t<T>;
+                if constexpr (std::is_same_v<Type, bool>)
+                {
+                    uint8_t v = value ? 1 : 0;
+                    PutArg(LogArgType::Bool, &v, 1);
+                }
+                else if constexpr (std::is_same_v<Type, char>)
+                {
+                    PutArg(LogArgType::Char, &value, 1);
+                }
+                else if constexpr (std::is_enum_v<Type>)
+                {
+                    Add((std::underlying_type_t<Type>)value);
+                }
+                else if constexpr (std::is_integral_v<Type>)
+                {
+                    if constexpr (sizeof(Type) <= 4)
+                    {
+                        if constexpr (std::is_signed_v<Type>) { int32_t v = (int32_t)value; PutArg(LogArgType::Int32, &v, 4); }
+                        else { uint32_t v = (uint32_t)value; PutArg(LogArgType::UInt32, &v, 4); }
+                    }
+                    else
+                    {
+                        if constexpr (std::is_signed_v<Type>) { int64_t v = (int64_t)value; PutArg(LogArgType::Int64, &v, 8); }
+                        else { uint64_t v = (uint64_t)value; PutArg(LogArgType::UInt64, &v, 8); }
+                    }
+                }
+                else if constexpr (std::is_same_v<Type, float>)
+                {
+                    PutArg(LogArgType::Float, &value, 4);
+                }
+                else if constexpr (std::is_floating_point_v<Type>)
+                {
+                    double v = (double)value;
+                    PutArg(LogArgType::Double, &v, 8);
+                }
+                else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+                {
+                    std::string_view text(value);
+                    size_t room = m_Size + 1 + 2 < MaxPayloadSize ? MaxPayloadSize - m_Size - 1 - 2 : 0;
+                    uint16_t length = (uint16_t)(text.size() < room ? text.size() : room);
+                    if (PutArg(LogArgType::String, &length, 2))
+                        Put(text.data(), length);
+                }
+                else if constexpr (std::is_pointer_v<Type>)
+                {
+                    uint64_t v = (uint64_t)(uintptr_t)value;
+                    PutArg(LogArgType::Pointer, &v, 8);
+                }
+                else
+                {
+                    static_assert(std::is_void_v<T>, "Unsupported binary log argument type");
+                }
+            }
+
+            const uint8_t* GetData() const { return m_Data; }
+            size_t GetSize() const { return m_Size; }
+
+        private:
+            bool PutArg(LogArgType type, const void* data, size_t size)
+            {
+                if (m_Size + 1 + size > MaxPayloadSize)
+                    return false;
+                m_Data[m_Size++] = (uint8_t)type;
+                Put(data, size);
+                ++m_Data[sizeof(uint32_t)];
+                return true;
+            }
+
+            void Put(const void* data, size_t size)
+            {
+                std::memcpy(m_Data + m_Size, data, size);
+                m_Size += size;
+            }
+
+            uint8_t m_Data[MaxPayloadSize] = {};
+            size_t m_Size = 0;
+        };
+
+        template <typename... Args>
+        void Write(LogLevel level, uint32_t formatId, const Args&... args)
+        {
+            PayloadWriter writer(formatId);
+            (writer.Add(args), ...);
+            Logger::GetInstance().LogBinary(level, writer.GetData(), writer.GetSize());
+        }
+    }
+
+} // namespace Armillary
+
+// Same threshold as LOG_*; arguments are only evaluated after the runtime level check passes
+#define ARMILLARY_ALOG(level, format, ...) \
+    do { \
+        if (Armillary::Logger::GetInstance().IsLevelEnabled(level)) { \
+            static const uint32_t s_ALogFormatId = Armillary::BinaryLog::RegisterFormat(level, __FILE__, __LINE__, format); \
+            Armillary::BinaryLog::Write(level, s_ALogFormatId, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 0
+#define ALOG_DEBUG(format, ...)   ARMILLARY_ALOG(Armillary::LogLevel::Debug, format, ##__VA_ARGS__)
+#else
+#define ALOG_DEBUG(format, ...)   ((void)0)
+#endif
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 1
+#define ALOG_INFO(format, ...)    ARMILLARY_ALOG(Armillary::LogLevel::Info, format, ##__VA_ARGS__)
+#else
+#define ALOG_INFO(format, ...)    ((void)0)
+#endif
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 2
+#define ALOG_WARNING(format, ...) ARMILLARY_ALOG(Armillary::LogLevel::Warning, format, ##__VA_ARGS__)
+#else
+#define ALOG_WARNING(format, ...) ((void)0)
+#endif
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 3
+#define ALOG_ERROR(format, ...)   ARMILLARY_ALOG(Armillary::LogLevel::Error, format, ##__VA_ARGS__)
+#else
+#define ALOG_ERROR(format, ...)   ((void)0)
+#endif
@@ -1,6 +1,11 @@
 ﻿#include "pch.h"
 #include "Engine.h"
 #include "Logger.h"
+#include "BinaryLog.h"
+#include "JobSystem.h"
+
+#include <chrono>
+#include <thread>
 
 namespace Armillary
 {
@@ -9,7 +14,14 @@ namespace Armillary
 	{
 		Logger::GetInstance().SetLogLevel(LogLevel::Debug);
 		Logger::GetInstance().EnableConsoleOutput(true);
+
+		LogRotationConfig rotation;
+		rotation.MaxFileSizeBytes = 16ull * 1024 * 1024;
+		rotation.MaxFileAgeSeconds = 24 * 60 * 60;
+		rotation.MaxRetainedFiles = 8;
+		Logger::GetInstance().SetFileRotation(rotation);
 		Logger::GetInstance().EnableFileOutput("engine.log");
+		Logger::GetInstance().EnableAsyncMode(true);
 		LOG_INFO("CEngine constructor called");
 	}
 
@@ -18,63 +30,161 @@ namespace Armillary
 		LOG_INFO("CEngine destructor called");
 	}
 
-	bool Engine::Initialize()
+	bool Engine::Initialize(const EngineConfig& config)
 	{
 		LOG_INFO("Initializing CEngine...");
-		LOG_INFO("CEngine initialized successfully");
-		
+		m_Config = config;
 
-		if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		m_JobSystem = std::make_unique<JobSystem>();
+		if (!m_JobSystem->Initialize())
 		{
-			LOG_ERROR("SDL could not initialize! SDL_Error: " + std::string(SDL_GetError()));
+			LOG_ERROR("Failed to initialize JobSystem");
 			return false;
 		}
 
-		// Создание окна
-		SDL_Window* testWindow = SDL_CreateWindow(
-			"Armillary Engine - SDL2 Test",
-			SDL_WINDOWPOS_CENTERED,
-			SDL_WINDOWPOS_CENTERED,
-			800, 600,
-			SDL_WINDOW_SHOWN
-		);
-
-		if (testWindow == nullptr)
+		if (m_Config.bHeadless)
 		{
-			LOG_ERROR("Window could not be created! SDL_Error: " + std::string(SDL_GetError()));
-			return false;
+			LOG_INFO("Running headless, no window will be created");
 		}
+		else
+		{
+			if (SDL_Init(SDL_INIT_VIDEO) < 0)
+			{
+				LOG_ERROR("SDL could not initialize! SDL_Error: " + std::string(SDL_GetError()));
+				return false;
+			}
+			m_bSDLInitialized = true;
 
-		LOG_INFO("SDL2 initialized and window created successfully!");
+			m_Window = SDL_CreateWindow(
+				m_Config.WindowTitle.c_str(),
+				SDL_WINDOWPOS_CENTERED,
+				SDL_WINDOWPOS_CENTERED,
+				m_Config.WindowWidth, m_Config.WindowHeight,
+				SDL_WINDOW_SHOWN
+			);
 
-		// Задержка 3 секунды
-		SDL_Delay(3000);
+			if (m_Window == nullptr)
+			{
+				LOG_ERROR("Window could not be created! SDL_Error: " + std::string(SDL_GetError()));
+				return false;
+			}
 
-		// Уничтожение окна и выход
-		SDL_DestroyWindow(testWindow);
-		SDL_Quit();
+			LOG_INFO("SDL2 initialized and window created successfully!");
+		}
 
-		return true; // или false, если вы хотите сразу завершить программу после теста
+		LOG_INFO("CEngine initialized successfully");
+		return true;
 	}
 
 	void Engine::Run()
 	{
 		LOG_INFO("CEngine main loop started");
-		std::cout << "Press Enter to exit..." << std::endl;
 		m_bIsRunning = true;
+		m_FrameStats.Reset();
+
+		const double fixedStep = m_Config.FixedTimeStep > 0.0 ? m_Config.FixedTimeStep : 1.0 / 60.0;
+		double accumulator = 0.0;
+		double previousTime = GetTimeSeconds();
+		uint64_t frameIndex = 0;
+
 		while (m_bIsRunning)
 		{
-			std::cin.get();
-			m_bIsRunning = false;
+			double frameStart = GetTimeSeconds();
+			double frameDelta = frameStart - previousTime;
+			previousTime = frameStart;
+			if (frameDelta > m_Config.MaxFrameDelta)
+				frameDelta = m_Config.MaxFrameDelta;
+
+			// Headless runs simulate at exactly one fixed step per frame so soak tests are deterministic
+			accumulator += m_Config.bHeadless ? fixedStep : frameDelta;
+
+			if (!m_Config.bHeadless)
+				PumpEvents();
+
+			while (accumulator >= fixedStep)
+			{
+				if (m_UpdateCallback)
+					m_UpdateCallback(fixedStep);
+				accumulator -= fixedStep;
+			}
+
+			if (m_RenderCallback)
+				m_RenderCallback(accumulator / fixedStep);
+
+			m_FrameStats.Record((GetTimeSeconds() - frameStart) * 1000.0);
+
+			++frameIndex;
+			if (m_Config.MaxFrames > 0 && frameIndex >= m_Config.MaxFrames)
+				m_bIsRunning = false;
+
+			if (m_bIsRunning && !m_Config.bHeadless)
+				PaceFrame(frameStart);
 		}
 
-		LOG_INFO("CEngine main loop finished");
+		ALOG_INFO("CEngine main loop finished after {} frames. CPU frame time p50: {} ms, p99: {} ms",
+			frameIndex, m_FrameStats.GetP50(), m_FrameStats.GetP99());
 	}
 
 	void Engine::Shutdown()
 	{
 		LOG_INFO("Shutting down CEngine...");
+
+		if (m_Window)
+		{
+			SDL_DestroyWindow(m_Window);
+			m_Window = nullptr;
+		}
+
+		if (m_bSDLInitialized)
+		{
+			SDL_Quit();
+			m_bSDLInitialized = false;
+		}
+
+		if (m_JobSystem)
+		{
+			m_JobSystem->Shutdown();
+			m_JobSystem.reset();
+		}
+
 		LOG_INFO("CEngine shutdown complete");
+		Logger::GetInstance().Flush();
+	}
+
+	void Engine::PumpEvents()
+	{
+		SDL_Event event;
+		while (SDL_PollEvent(&event))
+		{
+			if (event.type == SDL_QUIT)
+				m_bIsRunning = false;
+			else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE)
+				m_bIsRunning = false;
+		}
+	}
+
+	void Engine::PaceFrame(double frameStartSeconds)
+	{
+		if (m_Config.TargetFrameRate <= 0.0)
+			return;
+
+		const double targetEnd = frameStartSeconds + 1.0 / m_Config.TargetFrameRate;
+		const double spinWindow = m_Config.SpinWaitMs / 1000.0;
+
+		// Coarse sleep until we are close, then spin for the rest
+		double remaining = targetEnd - GetTimeSeconds();
+		if (remaining > spinWindow)
+			std::this_thread::sleep_for(std::chrono::duration<double>(remaining - spinWindow));
+
+		while (GetTimeSeconds() < targetEnd)
+			std::this_thread::yield();
+	}
+
+	double Engine::GetTimeSeconds() const
+	{
+		using Clock = std::chrono::steady_clock;
+		static const Clock::time_point s_Start = Clock::now();
+		return std::chrono::duration<double>(Clock::now() - s_Start).count();
 	}
 
-} // namespace Armillary
\ No newline at end of file
+} // namespace Armillary
@@ -1,20 +1,77 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "FrameStats.h"
+
+struct SDL_Window;
+
 namespace Armillary
 {
 
+	class JobSystem;
+
+	struct EngineConfig
+	{
+		std::string WindowTitle = "Armillary Engine";
+		int WindowWidth = 1280;
+		int WindowHeight = 720;
+
+		// No window and no event pump; Run() stops after MaxFrames (soak tests)
+		bool bHeadless = false;
+		// 0 = run until a quit event or RequestExit()
+		uint64_t MaxFrames = 0;
+
+		// Simulation step in seconds
+		double FixedTimeStep = 1.0 / 60.0;
+		// Clamp for a single frame's delta so a hitch can't queue up endless fixed steps
+		double MaxFrameDelta = 0.25;
+		// 0 = unlimited, otherwise the loop paces itself to this rate
+		double TargetFrameRate = 60.0;
+		// The last part of the pacing wait is spent spinning, sleep is too coarse for it
+		double SpinWaitMs = 2.0;
+	};
+
 	class Engine
 	{
 	public:
+		using UpdateCallback = std::function<void(double fixedDeltaSeconds)>;
+		using RenderCallback = std::function<void(double interpolationAlpha)>;
+
 		Engine();
 		~Engine();
 
-		bool Initialize();
+		bool Initialize(const EngineConfig& config = EngineConfig());
 		void Run();
 		void Shutdown();
 
+		void RequestExit() { m_bIsRunning = false; }
+
+		void SetUpdateCallback(UpdateCallback callback) { m_UpdateCallback = std::move(callback); }
+		void SetRenderCallback(RenderCallback callback) { m_RenderCallback = std::move(callback); }
+
+		JobSystem* GetJobSystem() const { return m_JobSystem.get(); }
+		SDL_Window* GetWindow() const { return m_Window; }
+		const EngineConfig& GetConfig() const { return m_Config; }
+		const FrameStats& GetFrameStats() const { return m_FrameStats; }
+
 	private:
+		void PumpEvents();
+		void PaceFrame(double frameStartSeconds);
+		double GetTimeSeconds() const;
+
 		bool m_bIsRunning = false;
+		bool m_bSDLInitialized = false;
+		EngineConfig m_Config;
+		SDL_Window* m_Window = nullptr;
+		std::unique_ptr<JobSystem> m_JobSystem;
+
+		UpdateCallback m_UpdateCallback;
+		RenderCallback m_RenderCallback;
+		FrameStats m_FrameStats;
 	};
 
-} // namespace Armillary
\ No newline at end of file
+} // namespace Armillary
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Armillary
+{
+
+	FrameStats::FrameStats(uint32_t capacity)
+		: m_Samples(capacity > 0 ? capacity : 1, 0.0)
+	{
+		m_Scratch.reserve(m_Samples.size());
+	}
+
+	void FrameStats::Record(double frameTimeMs)
+	{
+		m_Samples[m_Head] = frameTimeMs;
+		m_Head = (m_Head + 1) % (uint32_t)m_Samples.size();
+		if (m_Count < m_Samples.size())
+			++m_Count;
+		++m_TotalFrames;
+		m_Last = frameTimeMs;
+	}
+
+	void FrameStats::Reset()
+	{
+		m_Head = 0;
+		m_Count = 0;
+		m_TotalFrames = 0;
+		m_Last = 0.0;
+	}
+
+	double FrameStats::GetAverage() const
+	{
+		if (m_Count == 0)
+			return 0.0;
+
+		double sum = 0.0;
+		for (uint32_t i = 0; i < m_Count; ++i)
+			sum += m_Samples[i];
+		return sum / m_Count;
+	}
+
+	double FrameStats::GetMin() const
+	{
+		if (m_Count == 0)
+			return 0.0;
+		return *(std::min_element)(m_Samples.begin(), m_Samples.begin() + m_Count);
+	}
+
+	double FrameStats::GetMax() const
+	{
+		if (m_Count == 0)
+			return 0.0;
+		return *(std::max_element)(m_Samples.begin(), m_Samples.begin() + m_Count);
+	}
+
+	double FrameStats::GetPercentile(double percentile) const
+	{
+		if (m_Count == 0)
+			return 0.0;
+
+		percentile = (std::min)((std::max)(percentile, 0.0), 100.0);
+
+		// Samples are unordered in the ring, so select on a copy (no allocation: reserved up front)
+		m_Scratch.assign(m_Samples.begin(), m_Samples.begin() + m_Count);
+		size_t rank = (size_t)std::ceil(percentile / 100.0 * m_Count);
+		size_t index = rank > 0 ? rank - 1 : 0;
+		std::nth_element(m_Scratch.begin(), m_Scratch.begin() + index, m_Scratch.end());
+		return m_Scratch[index];
+	}
+
+} // namespace Armillary
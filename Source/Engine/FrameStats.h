@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Armillary
+{
+
+	// Fixed-size ring of per-frame CPU times (milliseconds) with percentile queries.
+	class FrameStats
+	{
+	public:
+		explicit FrameStats(uint32_t capacity = 1024);
+
+		void Record(double frameTimeMs);
+		void Reset();
+
+		uint32_t GetSampleCount() const { return m_Count; }
+		uint64_t GetTotalFrames() const { return m_TotalFrames; }
+		double GetLast() const { return m_Last; }
+
+		double GetAverage() const;
+		double GetMin() const;
+		double GetMax() const;
+
+		// percentile in [0, 100], e.g. 50 for median, 99 for the 1% worst frames
+		double GetPercentile(double percentile) const;
+		double GetP50() const { return GetPercentile(50.0); }
+		double GetP99() const { return GetPercentile(99.0); }
+
+	private:
+		std::vector<double> m_Samples;
+		mutable std::vector<double> m_Scratch;
+		uint32_t m_Head = 0;
+		uint32_t m_Count = 0;
+		uint64_t m_TotalFrames = 0;
+		double m_Last = 0.0;
+	};
+
+} // namespace Armillary
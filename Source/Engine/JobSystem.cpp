@@ -0,0 +1,378 @@
+#include "pch.h"
+#include "JobSystem.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+namespace Armillary
+{
+
+	struct Job
+	{
+		JobFunction Function;
+		JobCounter* Counter = nullptr;
+	};
+
+	namespace
+	{
+		struct WorkerContext
+		{
+			JobSystem* Owner = nullptr;
+			uint32_t Index = 0;
+			uint32_t StealSeed = 0;
+		};
+
+		thread_local WorkerContext t_Worker;
+
+		constexpr int IdleSpinCount = 64;
+	}
+
+	// ---------------------------------------------------------
+	// WorkStealingQueue
+	// ---------------------------------------------------------
+
+	WorkStealingQueue::WorkStealingQueue()
+		: m_Buffer(new std::atomic<Job*>[Capacity])
+	{
+		for (int64_t i = 0; i < Capacity; ++i)
+			m_Buffer[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	bool WorkStealingQueue::Push(Job* job)
+	{
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		if (bottom - top >= Capacity)
+			return false;
+
+		m_Buffer[bottom & Mask].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Job* WorkStealingQueue::Pop()
+	{
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// Queue was already empty
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = m_Buffer[bottom & Mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// Last element: race against thieves for it
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* WorkStealingQueue::Steal()
+	{
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+			return nullptr;
+
+		Job* job = m_Buffer[top & Mask].load(std::memory_order_relaxed);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return job;
+	}
+
+	bool WorkStealingQueue::IsEmpty() const
+	{
+		return m_Top.load(std::memory_order_acquire) >= m_Bottom.load(std::memory_order_acquire);
+	}
+
+	// ---------------------------------------------------------
+	// JobSystem
+	// ---------------------------------------------------------
+
+	JobSystem::JobSystem() = default;
+
+	JobSystem::~JobSystem()
+	{
+		Shutdown();
+	}
+
+	bool JobSystem::Initialize(uint32_t workerCount)
+	{
+		if (m_bIsInitialized)
+			return true;
+
+		if (workerCount == 0)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_bShuttingDown = false;
+		m_QueuedJobs = 0;
+
+		// Slot 0 belongs to the owning thread, 1..N to background workers
+		m_Queues.clear();
+		for (uint32_t i = 0; i <= workerCount; ++i)
+			m_Queues.push_back(std::make_unique<WorkStealingQueue>());
+
+		m_PreviousOwner = t_Worker.Owner;
+		m_PreviousIndex = t_Worker.Index;
+		m_PreviousStealSeed = t_Worker.StealSeed;
+		t_Worker = { this, 0, 0 };
+
+		for (uint32_t i = 1; i <= workerCount; ++i)
+			m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+
+		m_bIsInitialized = true;
+		LOG_INFO("JobSystem initialized with " + std::to_string(workerCount) + " worker threads");
+		return true;
+	}
+
+	void JobSystem::Shutdown()
+	{
+		if (!m_bIsInitialized)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_SleepLock);
+			m_bShuttingDown = true;
+		}
+		m_SleepCondition.notify_all();
+
+		for (auto& worker : m_Workers)
+		{
+			if (worker.joinable())
+				worker.join();
+		}
+		m_Workers.clear();
+
+		// Anything still queued runs here so no counter is left hanging
+		while (ExecuteOne()) {}
+
+		m_Queues.clear();
+		if (t_Worker.Owner == this)
+			t_Worker = { m_PreviousOwner, m_PreviousIndex, m_PreviousStealSeed };
+		m_PreviousOwner = nullptr;
+
+		m_bIsInitialized = false;
+		LOG_INFO("JobSystem shut down");
+	}
+
+	void JobSystem::Schedule(JobFunction function, JobCounter* counter)
+	{
+		Schedule(std::move(function), counter, nullptr);
+	}
+
+	void JobSystem::Schedule(JobFunction function, JobCounter* counter, JobCounter* dependency)
+	{
+		Job* job = new Job{ std::move(function), counter };
+		if (counter)
+			counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+		if (!m_bIsInitialized)
+		{
+			Execute(job);
+			return;
+		}
+
+		if (dependency)
+		{
+			// Only the job count: once it is zero the last Finish takes the list under this lock
+			// or has already taken it, either way a job added now would never be released
+			std::unique_lock<std::mutex> lock(dependency->m_ContinuationLock);
+			if (dependency->m_Pending.load(std::memory_order_acquire) != 0)
+			{
+				dependency->m_Continuations.push_back(job);
+				return;
+			}
+		}
+
+		Submit(job);
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		while (!counter.IsDone())
+		{
+			if (!ExecuteOne())
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const JobRangeFunction& function)
+	{
+		if (count == 0)
+			return;
+
+		grainSize = (std::max)(grainSize, 1u);
+		if (!m_bIsInitialized || count <= grainSize)
+		{
+			function(0, count);
+			return;
+		}
+
+		JobCounter counter;
+		for (uint32_t begin = 0; begin < count; begin += grainSize)
+		{
+			uint32_t end = (std::min)(begin + grainSize, count);
+			Schedule([&function, begin, end]() { function(begin, end); }, &counter);
+		}
+		Wait(counter);
+	}
+
+	void JobSystem::Submit(Job* job)
+	{
+		bool bPushed = false;
+		if (t_Worker.Owner == this)
+			bPushed = m_Queues[t_Worker.Index]->Push(job);
+
+		if (!bPushed)
+		{
+			std::lock_guard<std::mutex> lock(m_InjectionLock);
+			m_InjectionQueue.push_back(job);
+			m_InjectedJobs.fetch_add(1, std::memory_order_release);
+		}
+
+		m_QueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+		// Only touch the sleep lock when somebody is actually parked on it
+		if (m_SleepingWorkers.load(std::memory_order_seq_cst) > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_SleepLock);
+			}
+			m_SleepCondition.notify_one();
+		}
+	}
+
+	Job* JobSystem::FindJob()
+	{
+		Job* job = nullptr;
+		bool bIsWorker = (t_Worker.Owner == this);
+
+		if (bIsWorker)
+			job = m_Queues[t_Worker.Index]->Pop();
+
+		if (!job && m_InjectedJobs.load(std::memory_order_acquire) > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_InjectionLock);
+			if (!m_InjectionQueue.empty())
+			{
+				job = m_InjectionQueue.front();
+				m_InjectionQueue.pop_front();
+				m_InjectedJobs.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+		if (!job && !m_Queues.empty())
+		{
+			// xorshift so each thread picks a different first victim
+			uint32_t seed = t_Worker.StealSeed ? t_Worker.StealSeed : (uint32_t)(uintptr_t)&t_Worker | 1u;
+			seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+			t_Worker.StealSeed = seed;
+
+			uint32_t queueCount = (uint32_t)m_Queues.size();
+			for (uint32_t i = 0; i < queueCount && !job; ++i)
+			{
+				uint32_t victim = (seed + i) % queueCount;
+				if (bIsWorker && victim == t_Worker.Index)
+					continue;
+				job = m_Queues[victim]->Steal();
+			}
+		}
+
+		if (job)
+			m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	bool JobSystem::ExecuteOne()
+	{
+		Job* job = FindJob();
+		if (!job)
+			return false;
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::Execute(Job* job)
+	{
+		job->Function();
+		JobCounter* counter = job->Counter;
+		delete job;
+		Finish(counter);
+	}
+
+	void JobSystem::Finish(JobCounter* counter)
+	{
+		if (!counter)
+			return;
+
+		// Wait() may return and destroy the counter as soon as it is done, so keep it from
+		// looking done until the continuations are out of it
+		counter->m_Finishing.fetch_add(1, std::memory_order_acq_rel);
+
+		// Counter hit zero: release everything that was waiting on it
+		std::vector<Job*> continuations;
+		if (counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(counter->m_ContinuationLock);
+			continuations.swap(counter->m_Continuations);
+		}
+
+		// Last access to the counter
+		counter->m_Finishing.fetch_sub(1, std::memory_order_release);
+
+		for (Job* job : continuations)
+		{
+			if (m_bIsInitialized)
+				Submit(job);
+			else
+				Execute(job);
+		}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t workerIndex)
+	{
+		t_Worker = { this, workerIndex, workerIndex * 2654435761u };
+
+		int idleSpins = 0;
+		while (!m_bShuttingDown.load(std::memory_order_acquire))
+		{
+			if (ExecuteOne())
+			{
+				idleSpins = 0;
+				continue;
+			}
+
+			if (++idleSpins < IdleSpinCount)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_SleepLock);
+			m_SleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+			m_SleepCondition.wait(lock, [this]() {
+				return m_bShuttingDown.load(std::memory_order_acquire) ||
+					m_QueuedJobs.load(std::memory_order_seq_cst) > 0;
+			});
+			m_SleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+			idleSpins = 0;
+		}
+
+		t_Worker = {};
+	}
+
+} // namespace Armillary
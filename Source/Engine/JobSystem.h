@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Armillary
+{
+
+	struct Job;
+
+	// Counts outstanding jobs. Jobs scheduled with a dependency counter are held back
+	// until that counter drops to zero, so counters double as the dependency graph edges.
+	class JobCounter
+	{
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		// Zero jobs left and no thread still releasing continuations, so the owner may destroy it
+		bool IsDone() const
+		{
+			return m_Pending.load(std::memory_order_acquire) == 0 && m_Finishing.load(std::memory_order_acquire) == 0;
+		}
+		int GetPending() const { return m_Pending.load(std::memory_order_acquire); }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> m_Pending{ 0 };
+		// Threads inside JobSystem::Finish; dropped as their very last access to the counter
+		std::atomic<int> m_Finishing{ 0 };
+		std::mutex m_ContinuationLock;
+		std::vector<Job*> m_Continuations;
+	};
+
+	// Chase-Lev work-stealing deque. The owning worker pushes and pops at the bottom,
+	// every other worker steals from the top. Fixed capacity: Push() fails when full
+	// and the caller falls back to the shared injection queue.
+	class WorkStealingQueue
+	{
+	public:
+		static constexpr int64_t Capacity = 4096;
+
+		WorkStealingQueue();
+
+		bool Push(Job* job);
+		Job* Pop();
+		Job* Steal();
+
+		bool IsEmpty() const;
+
+	private:
+		static constexpr int64_t Mask = Capacity - 1;
+
+		alignas(64) std::atomic<int64_t> m_Top{ 0 };
+		alignas(64) std::atomic<int64_t> m_Bottom{ 0 };
+		std::unique_ptr<std::atomic<Job*>[]> m_Buffer;
+	};
+
+	using JobFunction = std::function<void()>;
+	using JobRangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+	class JobSystem
+	{
+	public:
+		JobSystem();
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// workerCount == 0 picks hardware_concurrency - 1 background workers.
+		// The thread calling Initialize becomes worker 0 and helps while waiting.
+		bool Initialize(uint32_t workerCount = 0);
+		void Shutdown();
+
+		bool IsInitialized() const { return m_bIsInitialized; }
+
+		// Total number of threads executing jobs, including the owning thread.
+		uint32_t GetThreadCount() const { return (uint32_t)m_Queues.size(); }
+
+		void Schedule(JobFunction function, JobCounter* counter = nullptr);
+		void Schedule(JobFunction function, JobCounter* counter, JobCounter* dependency);
+
+		// Executes pending jobs on the calling thread until the counter reaches zero.
+		void Wait(JobCounter& counter);
+
+		// Splits [0, count) into chunks of at most grainSize and blocks until all are done.
+		void ParallelFor(uint32_t count, uint32_t grainSize, const JobRangeFunction& function);
+
+	private:
+		void WorkerLoop(uint32_t workerIndex);
+		void Submit(Job* job);
+		Job* FindJob();
+		bool ExecuteOne();
+		void Execute(Job* job);
+		void Finish(JobCounter* counter);
+
+		std::vector<std::unique_ptr<WorkStealingQueue>> m_Queues;
+		std::vector<std::thread> m_Workers;
+
+		std::mutex m_InjectionLock;
+		std::deque<Job*> m_InjectionQueue;
+		std::atomic<int> m_InjectedJobs{ 0 };
+
+		std::mutex m_SleepLock;
+		std::condition_variable m_SleepCondition;
+		std::atomic<int> m_QueuedJobs{ 0 };
+		std::atomic<int> m_SleepingWorkers{ 0 };
+		std::atomic<bool> m_bShuttingDown{ false };
+
+		// Slot 0 identity the initializing thread had before (e.g. in another JobSystem),
+		// given back to it on Shutdown
+		JobSystem* m_PreviousOwner = nullptr;
+		uint32_t m_PreviousIndex = 0;
+		uint32_t m_PreviousStealSeed = 0;
+
+		bool m_bIsInitialized = false;
+	};
+
+} // namespace Armillary
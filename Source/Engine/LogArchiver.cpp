@@ -0,0 +1,214 @@
+#include "pch.h"
+#include "LogArchiver.h"
+
+#include <Optick/optick_miniz.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace Armillary
+{
+
+    namespace
+    {
+        constexpr size_t CompressChunkSize = 64 * 1024;
+    }
+
+    LogArchiver::~LogArchiver()
+    {
+        Stop();
+    }
+
+    void LogArchiver::Submit(const std::string& segmentPath, const std::string& activePath, bool bCompress, uint32_t maxRetainedFiles)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            Task& task = m_Tasks.emplace_back();
+            task.SegmentPath = segmentPath;
+            task.ActivePath = activePath;
+            task.bCompress = bCompress;
+            task.MaxRetainedFiles = maxRetainedFiles;
+
+            if (!m_Thread.joinable())
+            {
+                m_bStopping = false;
+                m_Thread = std::thread(&LogArchiver::WorkerLoop, this);
+            }
+        }
+        m_Condition.notify_one();
+    }
+
+    void LogArchiver::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_bStopping = true;
+        }
+        m_Condition.notify_all();
+
+        if (m_Thread.joinable())
+            m_Thread.join();
+    }
+
+    void LogArchiver::WorkerLoop()
+    {
+        while (true)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(m_Lock);
+                m_Condition.wait(lock, [this]() { return m_bStopping || !m_Tasks.empty(); });
+                if (m_Tasks.empty())
+                    return;
+                task = std::move(m_Tasks.front());
+                m_Tasks.pop_front();
+            }
+
+            if (task.bCompress)
+            {
+                std::string compressedPath = task.SegmentPath + ".gz";
+                if (CompressFile(task.SegmentPath, compressedPath))
+                {
+                    std::error_code error;
+                    std::filesystem::remove(task.SegmentPath, error);
+                }
+            }
+
+            PruneSegments(task.ActivePath, task.MaxRetainedFiles);
+        }
+    }
+
+    bool LogArchiver::CompressFile(const std::string& sourcePath, const std::string& destinationPath)
+    {
+        std::ifstream input(sourcePath, std::ios::in | std::ios::binary);
+        if (!input.is_open())
+            return false;
+
+        // Written under a temporary name so a crash never leaves a truncated .gz behind
+        std::string temporaryPath = destinationPath + ".tmp";
+        std::ofstream output(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!output.is_open())
+            return false;
+
+        const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+        output.write((const char*)header, sizeof(header));
+
+        mz_stream stream = {};
+        stream.zalloc = [](void*, size_t items, size_t size) -> void* { return std::malloc(items * size); };
+        stream.zfree = [](void*, void* address) { std::free(address); };
+        if (mz_deflateInit2(&stream, MZ_DEFAULT_LEVEL, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK)
+            return false;
+
+        std::vector<unsigned char> inBuffer(CompressChunkSize);
+        std::vector<unsigned char> outBuffer(CompressChunkSize);
+        mz_ulong crc = mz_crc32(MZ_CRC32_INIT, nullptr, 0);
+        uint32_t totalSize = 0;
+        bool bSucceeded = true;
+
+        bool bFinished = false;
+        while (!bFinished && bSucceeded)
+        {
+            input.read((char*)inBuffer.data(), inBuffer.size());
+            size_t readSize = (size_t)input.gcount();
+            bool bLastChunk = readSize < inBuffer.size();
+
+            crc = mz_crc32(crc, inBuffer.data(), readSize);
+            totalSize += (uint32_t)readSize;
+
+            stream.next_in = inBuffer.data();
+            stream.avail_in = (unsigned int)readSize;
+            while (true)
+            {
+                stream.next_out = outBuffer.data();
+                stream.avail_out = (unsigned int)outBuffer.size();
+
+                int status = mz_deflate(&stream, bLastChunk ? MZ_FINISH : MZ_NO_FLUSH);
+                if (status != MZ_OK && status != MZ_STREAM_END && status != MZ_BUF_ERROR)
+                {
+                    bSucceeded = false;
+                    break;
+                }
+
+                output.write((const char*)outBuffer.data(), outBuffer.size() - stream.avail_out);
+
+                if (status == MZ_STREAM_END)
+                {
+                    bFinished = true;
+                    break;
+                }
+                if (!bLastChunk && stream.avail_in == 0 && stream.avail_out != 0)
+                    break;
+            }
+        }
+        mz_deflateEnd(&stream);
+
+        uint32_t trailer[2] = { (uint32_t)crc, totalSize };
+        output.write((const char*)trailer, sizeof(trailer));
+        output.close();
+
+        std::error_code error;
+        if (!bSucceeded || !output)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+
+        std::filesystem::rename(temporaryPath, destinationPath, error);
+        if (error)
+        {
+            std::cerr << "Failed to archive log segment: " << sourcePath << std::endl;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    void LogArchiver::PruneSegments(const std::string& activePath, uint32_t maxRetainedFiles)
+    {
+        if (maxRetainedFiles == 0)
+            return;
+
+        std::filesystem::path active(activePath);
+        std::filesystem::path directory = active.has_parent_path() ? active.parent_path() : std::filesystem::path(".");
+        std::string prefix = active.stem().string() + ".";
+        std::string extension = active.extension().string();
+        std::string activeName = active.filename().string();
+
+        auto endsWith = [](const std::string& text, const std::string& suffix)
+        {
+            return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+
+        std::error_code error;
+        std::vector<std::filesystem::path> segments;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+        {
+            if (!entry.is_regular_file(error))
+                continue;
+
+            std::string name = entry.path().filename().string();
+            if (name == activeName || name.compare(0, prefix.size(), prefix) != 0)
+                continue;
+            // Segment names start with the rotation timestamp, which also makes them sort by age
+            if (name.size() <= prefix.size() || !std::isdigit((unsigned char)name[prefix.size()]))
+                continue;
+            if (endsWith(name, extension) || endsWith(name, extension + ".gz"))
+                segments.push_back(entry.path());
+        }
+
+        if (segments.size() <= maxRetainedFiles)
+            return;
+
+        std::sort(segments.begin(), segments.end(),
+            [](const std::filesystem::path& a, const std::filesystem::path& b) { return a.filename() < b.filename(); });
+
+        for (size_t i = 0; i < segments.size() - maxRetainedFiles; ++i)
+            std::filesystem::remove(segments[i], error);
+    }
+
+} // namespace Armillary
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Armillary
+{
+
+    // Background worker for rotated log segments: gzips them and deletes the oldest ones
+    // past the retention cap. Has its own thread so neither the frame thread nor the log
+    // writer ever waits on this disk I/O.
+    class LogArchiver
+    {
+    public:
+        LogArchiver() = default;
+        ~LogArchiver();
+
+        // Queues a closed segment of activePath, whose other segments are pruned afterwards
+        void Submit(const std::string& segmentPath, const std::string& activePath, bool bCompress, uint32_t maxRetainedFiles);
+
+        // Finishes everything queued so far and stops the thread
+        void Stop();
+
+        // Writes sourcePath as a .gz file (raw deflate from miniz plus the gzip header/trailer)
+        static bool CompressFile(const std::string& sourcePath, const std::string& destinationPath);
+
+        // Deletes the oldest "<stem>.<timestamp><ext>[.gz]" siblings of activePath beyond maxRetainedFiles
+        static void PruneSegments(const std::string& activePath, uint32_t maxRetainedFiles);
+
+    private:
+        struct Task
+        {
+            std::string SegmentPath;
+            std::string ActivePath;
+            bool bCompress = true;
+            uint32_t MaxRetainedFiles = 0;
+        };
+
+        void WorkerLoop();
+
+        std::mutex m_Lock;
+        std::condition_variable m_Condition;
+        std::deque<Task> m_Tasks;
+        std::thread m_Thread;
+        bool m_bStopping = false;
+    };
+
+} // namespace Armillary
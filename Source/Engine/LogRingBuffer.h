@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace Armillary
+{
+
+    enum class LogLevel;
+
+    struct LogEntry
+    {
+        static constexpr size_t InlineCapacity = 224;
+
+        int64_t Timestamp = 0;  // system_clock ticks, captured on the producer thread
+        LogLevel Level;
+        bool bBinary = false;   // Text holds an encoded BinaryLog payload
+        uint32_t Length = 0;
+        char Text[InlineCapacity];
+        std::string Overflow;   // only used for messages longer than InlineCapacity
+
+        void Assign(const char* data, size_t size)
+        {
+            Length = (uint32_t)size;
+            if (size <= InlineCapacity)
+            {
+                std::memcpy(Text, data, size);
+            }
+            else
+            {
+                Overflow.assign(data, size);
+            }
+        }
+
+        const char* Data() const { return Length <= InlineCapacity ? Text : Overflow.data(); }
+    };
+
+    // Single-producer / single-consumer ring of log entries. Each logging thread owns one;
+    // the logger's writer thread is the only consumer.
+    class LogRingBuffer
+    {
+    public:
+        explicit LogRingBuffer(uint32_t capacity)
+        {
+            uint32_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+            m_Capacity = size;
+            m_Entries.reset(new LogEntry[size]);
+        }
+
+        // Producer side. Returns nullptr when the ring is full.
+        LogEntry* BeginWrite()
+        {
+            uint64_t head = m_Head.load(std::memory_order_relaxed);
+            if (head - m_CachedTail >= m_Capacity)
+            {
+                m_CachedTail = m_Tail.load(std::memory_order_acquire);
+                if (head - m_CachedTail >= m_Capacity)
+                    return nullptr;
+            }
+            return &m_Entries[head & (m_Capacity - 1)];
+        }
+
+        void EndWrite()
+        {
+            m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Consumer side. Returns nullptr when the ring is empty.
+        LogEntry* BeginRead()
+        {
+            uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+            if (tail == m_Head.load(std::memory_order_acquire))
+                return nullptr;
+            return &m_Entries[tail & (m_Capacity - 1)];
+        }
+
+        void EndRead()
+        {
+            uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+            m_Entries[tail & (m_Capacity - 1)].Overflow.clear();
+            m_Tail.store(tail + 1, std::memory_order_release);
+        }
+
+        bool IsEmpty() const
+        {
+            return m_Tail.load(std::memory_order_acquire) == m_Head.load(std::memory_order_acquire);
+        }
+
+        // Set when the owning thread exits; the writer drops the ring once it is drained
+        void MarkOrphaned() { m_bOrphaned.store(true, std::memory_order_release); }
+        bool IsOrphaned() const { return m_bOrphaned.load(std::memory_order_acquire); }
+
+    private:
+        alignas(64) std::atomic<uint64_t> m_Head{ 0 };
+        uint64_t m_CachedTail = 0;
+        alignas(64) std::atomic<uint64_t> m_Tail{ 0 };
+        alignas(64) std::atomic<bool> m_bOrphaned{ false };
+
+        uint32_t m_Capacity = 0;
+        std::unique_ptr<LogEntry[]> m_Entries;
+    };
+
+} // namespace Armillary
@@ -1,8 +1,63 @@
 #include "pch.h"
 #include "Logger.h"
+#include "LogRingBuffer.h"
+#include "BinaryLog.h"
+#include "LogArchiver.h"
+
+#include <algorithm>
+#include <filesystem>
 
 namespace Armillary {
 
+    namespace
+    {
+        // Per ring, so a busy thread can't fill the batch and starve the others
+        constexpr size_t MaxBatchLinesPerRing = 1024;
+        constexpr auto WriterIdleWait = std::chrono::milliseconds(2);
+
+        // Per-thread ring for async mode. The ring itself is shared with the logger,
+        // so it outlives the thread until the writer has drained it.
+        struct ThreadLogBuffer
+        {
+            std::shared_ptr<LogRingBuffer> Buffer;
+            uint64_t Generation = 0;
+
+            ~ThreadLogBuffer()
+            {
+                if (Buffer)
+                    Buffer->MarkOrphaned();
+            }
+        };
+
+        thread_local ThreadLogBuffer t_LogBuffer;
+
+        // "engine.log" -> "engine.20250101-120000-123.log", sorts by rotation time
+        std::string MakeSegmentPath(const std::string& activePath, std::chrono::system_clock::time_point time)
+        {
+            auto time_t = std::chrono::system_clock::to_time_t(time);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) % 1000;
+
+            std::tm tm_buf;
+#ifdef _WIN32
+            localtime_s(&tm_buf, &time_t);
+#else
+            tm_buf = *std::localtime(&time_t);
+#endif
+
+            std::stringstream stamp;
+            stamp << std::put_time(&tm_buf, "%Y%m%d-%H%M%S") << '-' << std::setfill('0') << std::setw(3) << ms.count();
+
+            std::filesystem::path active(activePath);
+            std::filesystem::path segment = active;
+            segment.replace_filename(active.stem().string() + "." + stamp.str() + active.extension().string());
+
+            std::error_code error;
+            for (int suffix = 1; std::filesystem::exists(segment, error); ++suffix)
+                segment.replace_filename(active.stem().string() + "." + stamp.str() + "-" + std::to_string(suffix) + active.extension().string());
+            return segment.string();
+        }
+    }
+
     Logger& Logger::GetInstance()
     {
         static Logger instance;
@@ -13,22 +68,30 @@ namespace Armillary {
 
     Logger::~Logger()
     {
+        StopWriter();
         if (m_FileStream.is_open())
             m_FileStream.close();
+        if (m_BinaryStream.is_open())
+            m_BinaryStream.close();
+        //    
+        if (m_Archiver)
+            m_Archiver->Stop();
     }
 
     void Logger::SetLogLevel(LogLevel level)
     {
-        m_CurrentLevel = level;
+        m_CurrentLevel.store(level, std::memory_order_relaxed);
     }
 
     void Logger::EnableConsoleOutput(bool enable)
     {
+        std::lock_guard<std::mutex> lock(m_OutputLock);
         m_ConsoleOutput = enable;
     }
 
     void Logger::EnableFileOutput(const std::string& filepath)
     {
+        std::lock_guard<std::mutex> lock(m_OutputLock);
         if (m_FileStream.is_open())
             m_FileStream.close();
         m_FileStream.open(filepath, std::ios::out | std::ios::app);
@@ -36,14 +99,109 @@ namespace Armillary {
         {
             std::cerr << "Failed to open log file: " << filepath << std::endl;
         }
+
+        //      ,      
+        std::error_code error;
+        uint64_t existingSize = std::filesystem::file_size(filepath, error);
+        m_FilePath = filepath;
+        m_FileSize = error ? 0 : existingSize;
+        m_FileOpenTime = std::chrono::system_clock::now();
+    }
+
+    void Logger::SetFileRotation(const LogRotationConfig& rotation)
+    {
+        std::lock_guard<std::mutex> lock(m_OutputLock);
+        m_Rotation = rotation;
+    }
+
+    void Logger::RotateFile()
+    {
+        auto now = std::chrono::system_clock::now();
+        std::string segmentPath = MakeSegmentPath(m_FilePath, now);
+
+        m_FileStream.close();
+        std::error_code error;
+        std::filesystem::rename(m_FilePath, segmentPath, error);
+        m_FileStream.open(m_FilePath, std::ios::out | (error ? std::ios::app : std::ios::trunc));
+        m_FileSize = 0;
+        m_FileOpenTime = now;
+
+        if (error)
+        {
+            std::cerr << "Failed to rotate log file: " << m_FilePath << std::endl;
+            return;
+        }
+
+        if (!m_Archiver)
+            m_Archiver = std::make_unique<LogArchiver>();
+        m_Archiver->Submit(segmentPath, m_FilePath, m_Rotation.bCompress, m_Rotation.MaxRetainedFiles);
+    }
+
+    void Logger::EnableBinaryOutput(const std::string& filepath)
+    {
+        std::lock_guard<std::mutex> lock(m_OutputLock);
+        if (m_BinaryStream.is_open())
+            m_BinaryStream.close();
+        m_WrittenFormats.clear();
+        m_bBinaryOutput.store(false, std::memory_order_release);
+        if (filepath.empty())
+            return;
+
+        m_BinaryStream.open(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!m_BinaryStream.is_open())
+        {
+            std::cerr << "Failed to open binary log file: " << filepath << std::endl;
+            return;
+        }
+
+        uint32_t header[2] = { BinaryLog::FileMagic, BinaryLog::FileVersion };
+        m_BinaryStream.write((const char*)header, sizeof(header));
+        m_bBinaryOutput.store(true, std::memory_order_release);
+    }
+
+    void Logger::EnableAsyncMode(bool enable, uint32_t ringCapacity, LogOverflowPolicy policy)
+    {
+        // Expected to be toggled at startup/shutdown, not while other threads are logging
+        if (!enable)
+        {
+            m_bAsync.store(false, std::memory_order_release);
+            StopWriter();
+            return;
+        }
+
+        m_RingCapacity = ringCapacity > 0 ? ringCapacity : 1024;
+        m_OverflowPolicy = policy;
+        // Threads pick up a ring with the new capacity on their next message
+        m_AsyncGeneration.fetch_add(1, std::memory_order_acq_rel);
+        m_bAsync.store(true, std::memory_order_release);
+        StartWriter();
+    }
+
+    void Logger::Flush()
+    {
+        // One drain takes at most MaxBatchLinesPerRing lines from each ring
+        if (IsAsync())
+            while (DrainBuffers() != 0) {}
+
+        std::lock_guard<std::mutex> lock(m_OutputLock);
+        if (m_FileStream.is_open())
+            m_FileStream.flush();
+        if (m_BinaryStream.is_open())
+            m_BinaryStream.flush();
     }
 
     std::string Logger::GetTimestamp() const
     {
         auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
+        return FormatTimestamp(now.time_since_epoch().count());
+    }
+
+    std::string Logger::FormatTimestamp(int64_t ticks)
+    {
+        auto timePoint = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks));
+        auto time_t = std::chrono::system_clock::to_time_t(timePoint);
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()) % 1000;
+            timePoint.time_since_epoch()) % 1000;
 
         std::tm tm_buf;
 #ifdef _WIN32
@@ -58,7 +216,7 @@ namespace Armillary {
         return ss.str();
     }
 
-    std::string Logger::LevelToString(LogLevel level) const
+    std::string Logger::LevelToString(LogLevel level)
     {
         switch (level)
         {
@@ -72,34 +230,332 @@ namespace Armillary {
 
     void Logger::WriteToOutput(const std::string& formatted)
     {
+        // formatted      (    )
         if (m_ConsoleOutput)
         {
-            std::cout << formatted << std::endl;
+            std::cout << formatted;
         }
 
         if (m_FileStream.is_open())
         {
-            m_FileStream << formatted << std::endl;
+            bool bTooLarge = m_Rotation.MaxFileSizeBytes > 0 && m_FileSize + formatted.size() > m_Rotation.MaxFileSizeBytes;
+            bool bTooOld = m_Rotation.MaxFileAgeSeconds > 0 &&
+                std::chrono::system_clock::now() - m_FileOpenTime >= std::chrono::seconds(m_Rotation.MaxFileAgeSeconds);
+            if (m_FileSize > 0 && (bTooLarge || bTooOld))
+                RotateFile();
+
+            m_FileStream << formatted;
             m_FileStream.flush(); //     
+            m_FileSize += formatted.size();
         }
 
         //  Visual Studio     OutputDebugString
 #ifdef _WIN32
-        OutputDebugStringA((formatted + "\n").c_str());
+        OutputDebugStringA(formatted.c_str());
 #endif
     }
 
+    std::string Logger::FormatBinaryRecord(const char* payload, size_t size) const
+    {
+        uint32_t formatId = 0;
+        if (size >= sizeof(formatId))
+            std::memcpy(&formatId, payload, sizeof(formatId));
+
+        BinaryLog::FormatInfo info;
+        if (!BinaryLog::GetFormat(formatId, info))
+            return "<unknown log format " + std::to_string(formatId) + ">";
+        return BinaryLog::FormatPayload(info.Format, (const uint8_t*)payload, size);
+    }
+
+    void Logger::AppendBinaryRecord(std::string& out, int64_t ticks, const char* payload, size_t size)
+    {
+        uint32_t formatId = 0;
+        std::memcpy(&formatId, payload, sizeof(formatId));
+
+        //       ,     
+        if (formatId >= m_WrittenFormats.size() || !m_WrittenFormats[formatId])
+        {
+            BinaryLog::FormatInfo info;
+            BinaryLog::GetFormat(formatId, info);
+            uint8_t level = (uint8_t)info.Level;
+            uint16_t fileLength = (uint16_t)(std::min)(info.File.size(), (size_t)UINT16_MAX);
+            uint16_t formatLength = (uint16_t)(std::min)(info.Format.size(), (size_t)UINT16_MAX);
+
+            out += (char)BinaryLog::RecordFormat;
+            out.append((const char*)&formatId, sizeof(formatId));
+            out.append((const char*)&level, sizeof(level));
+            out.append((const char*)&info.Line, sizeof(info.Line));
+            out.append((const char*)&fileLength, sizeof(fileLength));
+            out.append(info.File.data(), fileLength);
+            out.append((const char*)&formatLength, sizeof(formatLength));
+            out.append(info.Format.data(), formatLength);
+
+            if (formatId >= m_WrittenFormats.size())
+                m_WrittenFormats.resize(formatId + 1, false);
+            m_WrittenFormats[formatId] = true;
+        }
+
+        int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::duration(ticks)).count();
+        uint16_t payloadSize = (uint16_t)size;
+
+        out += (char)BinaryLog::RecordMessage;
+        out.append((const char*)&microseconds, sizeof(microseconds));
+        out.append((const char*)&payloadSize, sizeof(payloadSize));
+        out.append(payload, size);
+    }
+
+    void Logger::LogBinary(LogLevel level, const uint8_t* payload, size_t size)
+    {
+        if (!IsLevelEnabled(level) || size < sizeof(uint32_t))
+            return;
+
+        int64_t ticks = std::chrono::system_clock::now().time_since_epoch().count();
+
+        if (IsAsync())
+        {
+            LogRingBuffer* ring = GetThreadBuffer();
+            LogEntry* entry = ring->BeginWrite();
+            while (!entry)
+            {
+                if (m_OverflowPolicy == LogOverflowPolicy::Drop)
+                {
+                    m_DroppedMessages.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                m_WakeCondition.notify_one();
+                std::this_thread::yield();
+                entry = ring->BeginWrite();
+            }
+
+            entry->Timestamp = ticks;
+            entry->Level = level;
+            entry->bBinary = true;
+            entry->Assign((const char*)payload, size);
+            ring->EndWrite();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_OutputLock);
+        if (m_bBinaryOutput.load(std::memory_order_acquire))
+        {
+            std::string record;
+            AppendBinaryRecord(record, ticks, (const char*)payload, size);
+            m_BinaryStream.write(record.data(), record.size());
+            return;
+        }
+
+        WriteToOutput("[" + FormatTimestamp(ticks) + "] [" + LevelToString(level) + "] " +
+            FormatBinaryRecord((const char*)payload, size) + '\n');
+    }
+
     void Logger::Log(LogLevel level, const std::string& message)
     {
-        if (level < m_CurrentLevel)
+        if (!IsLevelEnabled(level))
             return;
 
+        if (IsAsync())
+        {
+            LogRingBuffer* ring = GetThreadBuffer();
+            LogEntry* entry = ring->BeginWrite();
+            while (!entry)
+            {
+                if (m_OverflowPolicy == LogOverflowPolicy::Drop)
+                {
+                    m_DroppedMessages.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                m_WakeCondition.notify_one();
+                std::this_thread::yield();
+                entry = ring->BeginWrite();
+            }
+
+            entry->Timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+            entry->Level = level;
+            entry->bBinary = false;
+            entry->Assign(message.data(), message.size());
+            ring->EndWrite();
+            return;
+        }
+
         std::stringstream formatted;
         formatted << "[" << GetTimestamp() << "] "
             << "[" << LevelToString(level) << "] "
-            << message;
+            << message << '\n';
 
+        std::lock_guard<std::mutex> lock(m_OutputLock);
         WriteToOutput(formatted.str());
     }
 
+    LogRingBuffer* Logger::GetThreadBuffer()
+    {
+        uint64_t generation = m_AsyncGeneration.load(std::memory_order_acquire);
+        if (!t_LogBuffer.Buffer || t_LogBuffer.Generation != generation)
+        {
+            if (t_LogBuffer.Buffer)
+                t_LogBuffer.Buffer->MarkOrphaned();
+
+            t_LogBuffer.Buffer = std::make_shared<LogRingBuffer>(m_RingCapacity);
+            t_LogBuffer.Generation = generation;
+
+            std::lock_guard<std::mutex> lock(m_BuffersLock);
+            m_Buffers.push_back(t_LogBuffer.Buffer);
+        }
+        return t_LogBuffer.Buffer.get();
+    }
+
+    void Logger::StartWriter()
+    {
+        if (m_bWriterRunning.exchange(true))
+            return;
+        m_WriterThread = std::thread(&Logger::WriterLoop, this);
+    }
+
+    void Logger::StopWriter()
+    {
+        if (!m_bWriterRunning.exchange(false))
+            return;
+
+        m_WakeCondition.notify_all();
+        if (m_WriterThread.joinable())
+            m_WriterThread.join();
+
+        // Whatever was produced before the switch still goes out
+        while (DrainBuffers() != 0) {}
+    }
+
+    void Logger::WriterLoop()
+    {
+        while (m_bWriterRunning.load(std::memory_order_acquire))
+        {
+            if (DrainBuffers() == 0)
+            {
+                std::unique_lock<std::mutex> lock(m_WakeLock);
+                m_WakeCondition.wait_for(lock, WriterIdleWait);
+            }
+        }
+    }
+
+    size_t Logger::DrainBuffers()
+    {
+        std::lock_guard<std::mutex> drainLock(m_DrainLock);
+
+        std::vector<std::shared_ptr<LogRingBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(m_BuffersLock);
+            buffers = m_Buffers;
+        }
+
+        m_BatchCount = 0;
+        for (auto& buffer : buffers)
+        {
+            for (size_t taken = 0; taken < MaxBatchLinesPerRing; ++taken)
+            {
+                LogEntry* entry = buffer->BeginRead();
+                if (!entry)
+                    break;
+
+                if (m_BatchCount == m_Batch.size())
+                    m_Batch.emplace_back();
+
+                BatchedLine& line = m_Batch[m_BatchCount++];
+                line.Timestamp = entry->Timestamp;
+                line.Level = entry->Level;
+                line.bBinary = entry->bBinary;
+                line.Text.assign(entry->Data(), entry->Length);
+                buffer->EndRead();
+            }
+        }
+
+        // Rings of exited threads are released once empty
+        {
+            std::lock_guard<std::mutex> lock(m_BuffersLock);
+            m_Buffers.erase(std::remove_if(m_Buffers.begin(), m_Buffers.end(),
+                [](const std::shared_ptr<LogRingBuffer>& buffer) { return buffer->IsOrphaned() && buffer->IsEmpty(); }),
+                m_Buffers.end());
+        }
+
+        uint64_t dropped = m_DroppedMessages.load(std::memory_order_relaxed);
+        if (m_BatchCount == 0 && dropped == m_ReportedDrops)
+            return 0;
+
+        // Merge the per-thread streams back into time order
+        m_BatchOrder.resize(m_BatchCount);
+        for (uint32_t i = 0; i < (uint32_t)m_BatchCount; ++i)
+            m_BatchOrder[i] = i;
+        std::stable_sort(m_BatchOrder.begin(), m_BatchOrder.end(),
+            [this](uint32_t a, uint32_t b) { return m_Batch[a].Timestamp < m_Batch[b].Timestamp; });
+
+        // Whole seconds repeat across a batch, format them once
+        int64_t cachedSecond = -1;
+        std::string cachedPrefix;
+
+        bool binaryOutput = m_bBinaryOutput.load(std::memory_order_acquire);
+
+        m_BatchText.clear();
+        for (uint32_t index : m_BatchOrder)
+        {
+            const BatchedLine& line = m_Batch[index];
+            if (line.bBinary && binaryOutput)
+                continue;
+
+            auto timePoint = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(line.Timestamp));
+            int64_t second = std::chrono::duration_cast<std::chrono::seconds>(timePoint.time_since_epoch()).count();
+            if (second != cachedSecond)
+            {
+                cachedSecond = second;
+                cachedPrefix = FormatTimestamp(line.Timestamp);
+                cachedPrefix.resize(cachedPrefix.size() - 3);
+            }
+
+            int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(timePoint.time_since_epoch()).count() % 1000;
+            char msText[4] = { (char)('0' + ms / 100), (char)('0' + ms / 10 % 10), (char)('0' + ms % 10), 0 };
+
+            m_BatchText += '[';
+            m_BatchText += cachedPrefix;
+            m_BatchText += msText;
+            m_BatchText += "] [";
+            m_BatchText += LevelToString(line.Level);
+            m_BatchText += "] ";
+            if (line.bBinary)
+                m_BatchText += FormatBinaryRecord(line.Text.data(), line.Text.size());
+            else
+                m_BatchText += line.Text;
+            m_BatchText += '\n';
+        }
+
+        if (dropped != m_ReportedDrops)
+        {
+            m_BatchText += "[" + GetTimestamp() + "] [WARNING] " + std::to_string(dropped - m_ReportedDrops) +
+                " log messages dropped (ring buffer full)\n";
+            m_ReportedDrops = dropped;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_OutputLock);
+            if (!m_BatchText.empty())
+                WriteToOutput(m_BatchText);
+
+            if (binaryOutput && m_BinaryStream.is_open())
+            {
+                m_BinaryBatch.clear();
+                for (uint32_t index : m_BatchOrder)
+                {
+                    const BatchedLine& line = m_Batch[index];
+                    if (line.bBinary)
+                        AppendBinaryRecord(m_BinaryBatch, line.Timestamp, line.Text.data(), line.Text.size());
+                }
+                if (!m_BinaryBatch.empty())
+                {
+                    m_BinaryStream.write(m_BinaryBatch.data(), m_BinaryBatch.size());
+                    m_BinaryStream.flush();
+                }
+            }
+        }
+
+        return m_BatchCount;
+    }
+
 } // namespace Armillary
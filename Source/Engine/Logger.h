@@ -6,8 +6,14 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-namespace Armillary 
+namespace Armillary
 {
 
     enum class LogLevel
@@ -18,22 +24,69 @@ namespace Armillary
         Error
     };
 
+    // What a producer does when its ring buffer is full in async mode
+    enum class LogOverflowPolicy
+    {
+        Block,  // wait for the writer thread to make room
+        Drop    // discard the message and bump the dropped counter
+    };
+
+    // Rotation of the text log file. Zero disables the respective limit.
+    struct LogRotationConfig
+    {
+        uint64_t MaxFileSizeBytes = 0;
+        uint32_t MaxFileAgeSeconds = 0;
+        // Rotated segments kept next to the active file, oldest are deleted first
+        uint32_t MaxRetainedFiles = 0;
+        // gzip rotated segments on the archiver thread
+        bool bCompress = true;
+    };
+
+    class LogRingBuffer;
+    class LogArchiver;
+
     class Logger
     {
     public:
         static Logger& GetInstance();
 
         void SetLogLevel(LogLevel level);
+        bool IsLevelEnabled(LogLevel level) const { return level >= m_CurrentLevel.load(std::memory_order_relaxed); }
         void EnableConsoleOutput(bool enable);
         void EnableFileOutput(const std::string& filepath);
 
+        // Applies to the current and any later EnableFileOutput file. The rotation itself is a
+        // rename done by whoever writes (the writer thread in async mode); compression and
+        // pruning run on a separate archiver thread.
+        void SetFileRotation(const LogRotationConfig& rotation);
+
+        // Async mode: callers only copy the message into a per-thread ring buffer,
+        // a background thread timestamps, batches and writes it out.
+        void EnableAsyncMode(bool enable, uint32_t ringCapacity = 1024, LogOverflowPolicy policy = LogOverflowPolicy::Block);
+        bool IsAsync() const { return m_bAsync.load(std::memory_order_acquire); }
+        uint64_t GetDroppedMessageCount() const { return m_DroppedMessages.load(std::memory_order_relaxed); }
+
+        // Blocks until everything logged so far has reached the outputs
+        void Flush();
+
         void Log(LogLevel level, const std::string& message);
 
+        // Encoded ALOG_* record (see BinaryLog.h). Formatted on the writer thread, or written
+        // raw to the binary output if one is enabled.
+        void LogBinary(LogLevel level, const uint8_t* payload, size_t size);
+
+        // Binary records go to this .alog file instead of the text outputs; decode with LogDecoder.
+        // An empty path switches back to formatting them as text.
+        void EnableBinaryOutput(const std::string& filepath);
+
         void Debug(const std::string& msg) { Log(LogLevel::Debug, msg); }
         void Info(const std::string& msg) { Log(LogLevel::Info, msg); }
         void Warning(const std::string& msg) { Log(LogLevel::Warning, msg); }
         void Error(const std::string& msg) { Log(LogLevel::Error, msg); }
 
+        static std::string FormatTimestamp(int64_t ticks);
+        static std::string LevelToString(LogLevel level);
+
     private:
         Logger();
         ~Logger();
@@ -41,19 +94,101 @@ namespace Armillary
         Logger& operator=(const Logger&) = delete;
 
         std::string GetTimestamp() const;
-        std::string LevelToString(LogLevel level) const;
         void WriteToOutput(const std::string& formatted);
+        void RotateFile();
+        std::string FormatBinaryRecord(const char* payload, size_t size) const;
+        void AppendBinaryRecord(std::string& out, int64_t ticks, const char* payload, size_t size);
 
-        LogLevel m_CurrentLevel = LogLevel::Info;
+        LogRingBuffer* GetThreadBuffer();
+        void StartWriter();
+        void StopWriter();
+        void WriterLoop();
+        size_t DrainBuffers();
+
+        std::atomic<LogLevel> m_CurrentLevel{ LogLevel::Info };
         bool m_ConsoleOutput = true;
         std::ofstream m_FileStream;
+        std::mutex m_OutputLock;
+
+        std::string m_FilePath;
+        uint64_t m_FileSize = 0;
+        std::chrono::system_clock::time_point m_FileOpenTime;
+        LogRotationConfig m_Rotation;
+        std::unique_ptr<LogArchiver> m_Archiver;
+
+        std::atomic<bool> m_bBinaryOutput{ false };
+        std::ofstream m_BinaryStream;
+        std::vector<bool> m_WrittenFormats;  // format definitions already in the current .alog
+
+        std::atomic<bool> m_bAsync{ false };
+        std::atomic<uint64_t> m_AsyncGeneration{ 0 };
+        uint32_t m_RingCapacity = 1024;
+        LogOverflowPolicy m_OverflowPolicy = LogOverflowPolicy::Block;
+        std::atomic<uint64_t> m_DroppedMessages{ 0 };
+
+        std::mutex m_BuffersLock;
+        std::vector<std::shared_ptr<LogRingBuffer>> m_Buffers;
+
+        struct BatchedLine
+        {
+            int64_t Timestamp = 0;
+            LogLevel Level = LogLevel::Info;
+            bool bBinary = false;
+            std::string Text;
+        };
+
+        // Held by whoever is consuming the rings (writer thread or Flush)
+        std::mutex m_DrainLock;
+        std::vector<BatchedLine> m_Batch;
+        std::vector<uint32_t> m_BatchOrder;
+        size_t m_BatchCount = 0;
+        uint64_t m_ReportedDrops = 0;
+        std::string m_BatchText;
+        std::string m_BinaryBatch;
+
+        std::thread m_WriterThread;
+        std::atomic<bool> m_bWriterRunning{ false };
+        std::mutex m_WakeLock;
+        std::condition_variable m_WakeCondition;
     };
 
 } // namespace Armillary
 
-#define LOG_DEBUG(msg)    Armillary::Logger::GetInstance().Debug(msg)
-#define LOG_INFO(msg)     Armillary::Logger::GetInstance().Info(msg)
-#define LOG_WARNING(msg)  Armillary::Logger::GetInstance().Warning(msg)
-#define LOG_ERROR(msg)    Armillary::Logger::GetInstance().Error(msg)
+// Levels below this are compiled out completely (0 = Debug, 1 = Info, 2 = Warning, 3 = Error)
+#ifndef ARMILLARY_LOG_MIN_LEVEL
+#define ARMILLARY_LOG_MIN_LEVEL 0
+#endif
+
+// The level is checked before the message expression is evaluated, so disabled
+// levels don't pay for string concatenation at the call site
+#define ARMILLARY_LOG(level, msg) \
+    do { \
+        if (Armillary::Logger::GetInstance().IsLevelEnabled(level)) \
+            Armillary::Logger::GetInstance().Log(level, msg); \
+    } while (0)
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(msg)    ARMILLARY_LOG(Armillary::LogLevel::Debug, msg)
+#else
+#define LOG_DEBUG(msg)    ((void)0)
+#endif
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 1
+#define LOG_INFO(msg)     ARMILLARY_LOG(Armillary::LogLevel::Info, msg)
+#else
+#define LOG_INFO(msg)     ((void)0)
+#endif
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 2
+#define LOG_WARNING(msg)  ARMILLARY_LOG(Armillary::LogLevel::Warning, msg)
+#else
+#define LOG_WARNING(msg)  ((void)0)
+#endif
+
+#if ARMILLARY_LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(msg)    ARMILLARY_LOG(Armillary::LogLevel::Error, msg)
+#else
+#define LOG_ERROR(msg)    ((void)0)
+#endif
 
-#define LOG(msg) Armillary::Logger::GetInstance().Info(msg)
\ No newline at end of file
+#define LOG(msg) LOG_INFO(msg)
\ No newline at end of file
@@ -0,0 +1,36 @@
+﻿#include <iostream>
+#include <fstream>
+#include <BinaryLog.h>
+
+// Turns a binary .alog written by Logger::EnableBinaryOutput back into text
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: LogDecoder <input.alog> [output.log]" << std::endl;
+        return 1;
+    }
+
+    bool bDecoded = false;
+    if (argc >= 3)
+    {
+        std::ofstream output(argv[2], std::ios::out | std::ios::trunc);
+        if (!output.is_open())
+        {
+            std::cerr << "Failed to open output file: " << argv[2] << std::endl;
+            return 1;
+        }
+        bDecoded = Armillary::BinaryLog::DecodeFile(argv[1], output);
+    }
+    else
+    {
+        bDecoded = Armillary::BinaryLog::DecodeFile(argv[1], std::cout);
+    }
+
+    if (!bDecoded)
+    {
+        std::cerr << "Failed to decode " << argv[1] << " (missing, truncated or not an .alog file)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
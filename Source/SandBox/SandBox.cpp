@@ -1,7 +1,26 @@
 ﻿#include <iostream>
 #include <Engine.h>
 #include <Logger.h>
+#include <BinaryLog.h>
+#include <JobSystem.h>
 #include <AfterMath\AfterMath.h>
+#include <Rendeructor/Rendeructor.h>
+#include <Rendeructor/RendeructorConstants.h>
+#include <Rendeructor/RendeructorDrawQueue.h>
+#include <SDL\SDL.h>
+#include <SDL\SDL_syswm.h>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace Armillary;
 
@@ -13,11 +32,382 @@ void TestAfterMath()
     LOG_INFO("Vector addition: (" + std::to_string(c.x) + ", " + std::to_string(c.y) + ", " + std::to_string(c.z) + ")");
 }
 
-int main()
+// Runs the same ParallelFor workload with 1..N threads and reports the speedup over one thread
+void BenchmarkJobSystem()
+{
+    const uint32_t elementCount = 1u << 22;
+    const uint32_t grainSize = 4096;
+    const int repetitions = 10;
+
+    std::vector<float> data(elementCount, 1.0f);
+    auto workload = [&data](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+            data[i] = std::sqrt(data[i] * 1.0001f + (float)i) * 0.5f;
+    };
+
+    uint32_t maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0)
+        maxThreads = 1;
+    double baselineMs = 0.0;
+
+    for (uint32_t threads = 1; threads <= maxThreads; ++threads)
+    {
+        JobSystem jobSystem;
+        if (threads > 1)
+            jobSystem.Initialize(threads - 1);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int rep = 0; rep < repetitions; ++rep)
+            jobSystem.ParallelFor(elementCount, grainSize, workload);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count() / repetitions;
+        if (threads == 1)
+            baselineMs = ms;
+
+        LOG_INFO("JobSystem benchmark: " + std::to_string(threads) + " threads, " +
+            std::to_string(ms) + " ms/iteration, speedup x" + std::to_string(baselineMs / ms));
+    }
+}
+
+// ns per Log() call with 8 threads hammering the async logger, for both overflow policies
+void BenchmarkLogger()
+{
+    const int threadCount = 8;
+    const int messagesPerThread = 100000;
+    Logger& logger = Logger::GetInstance();
+
+    logger.Flush();
+    logger.EnableConsoleOutput(false);
+    logger.EnableFileOutput("logger_benchmark.log");
+
+    const LogOverflowPolicy policies[] = { LogOverflowPolicy::Block, LogOverflowPolicy::Drop };
+    for (LogOverflowPolicy policy : policies)
+    {
+        logger.EnableAsyncMode(true, 4096, policy);
+        uint64_t droppedBefore = logger.GetDroppedMessageCount();
+
+        std::vector<std::thread> threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&logger, t]()
+            {
+                for (int i = 0; i < messagesPerThread; ++i)
+                    logger.Info("Benchmark message " + std::to_string(i) + " from thread " + std::to_string(t));
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        logger.Flush();
+
+        double nsPerCall = std::chrono::duration<double, std::nano>(end - start).count() / (threadCount * messagesPerThread);
+        uint64_t dropped = logger.GetDroppedMessageCount() - droppedBefore;
+
+        logger.EnableFileOutput("engine.log");
+        logger.EnableConsoleOutput(true);
+        LOG_INFO(std::string("Logger benchmark (") + (policy == LogOverflowPolicy::Block ? "Block" : "Drop") + "): " +
+            std::to_string(nsPerCall) + " ns/call, " + std::to_string(dropped) + " dropped");
+        logger.Flush();
+        logger.EnableConsoleOutput(false);
+        logger.EnableFileOutput("logger_benchmark.log");
+    }
+
+    // Same load through ALOG_INFO: only the format id and raw arguments leave the calling thread
+    {
+        logger.EnableAsyncMode(true, 4096, LogOverflowPolicy::Block);
+        logger.EnableBinaryOutput("logger_benchmark.alog");
+
+        std::vector<std::thread> threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([t]()
+            {
+                for (int i = 0; i < messagesPerThread; ++i)
+                    ALOG_INFO("Benchmark message {} from thread {}", i, t);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        logger.Flush();
+        logger.EnableBinaryOutput("");
+
+        double nsPerCall = std::chrono::duration<double, std::nano>(end - start).count() / (threadCount * messagesPerThread);
+        logger.EnableFileOutput("engine.log");
+        logger.EnableConsoleOutput(true);
+        LOG_INFO("Logger benchmark (Binary): " + std::to_string(nsPerCall) + " ns/call");
+        logger.Flush();
+    }
+
+    logger.EnableAsyncMode(true);
+    logger.EnableFileOutput("engine.log");
+    logger.EnableConsoleOutput(true);
+}
+
+// ns per draw for 1000 draws x 10 float4x4 constants: the old string-keyed map storage
+// against ConstantStore with pre-hashed ids. CPU side only, the GPU upload is the same for both.
+void BenchmarkConstants()
+{
+    const int drawCount = 1000;
+    const int repetitions = 100;
+    const uint32_t constantSize = 16 * sizeof(float);
+    const char* names[] = { "World", "View", "Projection", "ViewProjection", "PrevWorld",
+        "LightMatrix", "NormalMatrix", "TextureTransform", "BoneOffset", "Custom" };
+    const int constantCount = (int)(sizeof(names) / sizeof(names[0]));
+
+    float value[16] = {};
+    std::vector<uint8_t> shadow(constantCount * constantSize);
+    double checksum = 0.0;
+
+    // Old path: SetConstant copies into a fresh vector and assigns it into a std::map,
+    // the upload does a count() and an operator[] per reflected variable
+    double legacyNs = 0.0;
+    {
+        std::map<std::string, std::vector<uint8_t>> storage;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int rep = 0; rep < repetitions; ++rep)
+        {
+            for (int draw = 0; draw < drawCount; ++draw)
+            {
+                value[0] = (float)draw;
+                for (int c = 0; c < constantCount; ++c)
+                {
+                    const std::string name = names[c];
+                    std::vector<uint8_t> buffer(constantSize);
+                    memcpy(buffer.data(), value, constantSize);
+                    storage[name] = buffer;
+                }
+
+                for (int c = 0; c < constantCount; ++c)
+                {
+                    const std::string name = names[c];
+                    if (storage.count(name))
+                    {
+                        const auto& stored = storage[name];
+                        memcpy(shadow.data() + c * constantSize, stored.data(), constantSize);
+                    }
+                }
+                checksum += *(const float*)shadow.data();
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        legacyNs = std::chrono::duration<double, std::nano>(end - start).count() / (repetitions * drawCount);
+    }
+
+    // New path: ids hashed once, Set() is a lookup and a memcpy, Apply() a version compare
+    double hashedNs = 0.0;
+    {
+        ConstantStore store;
+        std::vector<ConstantId> ids;
+        std::vector<ConstantBinding> bindings(constantCount);
+        for (int c = 0; c < constantCount; ++c)
+        {
+            ids.push_back(ConstantId(names[c]));
+            bindings[c].NameHash = ids[c].Hash;
+            bindings[c].Offset = c * constantSize;
+            bindings[c].Size = constantSize;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int rep = 0; rep < repetitions; ++rep)
+        {
+            for (int draw = 0; draw < drawCount; ++draw)
+            {
+                value[0] = (float)draw;
+                for (int c = 0; c < constantCount; ++c)
+                    store.Set(ids[c], value, constantSize);
+
+                for (auto& binding : bindings)
+                    store.Apply(binding, shadow.data(), shadow.size());
+                checksum += *(const float*)shadow.data();
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        hashedNs = std::chrono::duration<double, std::nano>(end - start).count() / (repetitions * drawCount);
+    }
+
+    LOG_INFO("Constants benchmark: string map " + std::to_string(legacyNs) + " ns/draw, ConstantId " +
+        std::to_string(hashedNs) + " ns/draw, speedup x" + std::to_string(legacyNs / hashedNs) +
+        " (checksum " + std::to_string(checksum) + ")");
+}
+
+// Synthetic 50k-draw scene in random submission order: pass/state changes before and after
+// sorting by DrawSortKey, plus the radix sort cost
+void BenchmarkDrawSort()
+{
+    const int drawCount = 50000;
+    const int shaderCount = 64;
+    const int materialCount = 512;
+    const int stateCount = 4;
+
+    std::mt19937 random(1234);
+    DrawQueue queue;
+    for (int i = 0; i < drawCount; ++i)
+    {
+        DrawItem item;
+        item.PassId = (uint16_t)(random() % shaderCount);
+        item.StateId = (uint16_t)(random() % stateCount);
+        uint32_t material = random() % materialCount;
+        uint32_t depth = DrawSortKey::DepthBucket((float)(random() % 1000), 0.0f, 1000.0f, false);
+        item.SortKey = DrawSortKey::Make(0, item.StateId, item.PassId, material, depth);
+        item.IndexCount = 36;
+        queue.Add(item);
+    }
+
+    DrawQueueStats unsorted = queue.CountStateChanges(false);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    queue.Sort();
+    auto end = std::chrono::high_resolution_clock::now();
+    double sortMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+    DrawQueueStats sorted = queue.CountStateChanges(true);
+
+    LOG_INFO("Draw sort benchmark: " + std::to_string(drawCount) + " draws, pass changes " +
+        std::to_string(unsorted.PassChanges) + " -> " + std::to_string(sorted.PassChanges) + ", state changes " +
+        std::to_string(unsorted.StateChanges) + " -> " + std::to_string(sorted.StateChanges) +
+        ", radix sort " + std::to_string(sortMs) + " ms");
+}
+
+// Texture::LoadBatch over every image in a folder with 1, 4 and 8 worker threads. Needs the
+// engine window for the D3D11 device, so it doesn't run with --headless
+void BenchmarkTextureLoading(Engine& engine, const std::string& folder)
+{
+    const uint32_t threadCounts[] = { 1, 4, 8 };
+    const char* extensions[] = { ".dds", ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+
+    SDL_SysWMinfo windowInfo;
+    SDL_VERSION(&windowInfo.version);
+    if (!engine.GetWindow() || !SDL_GetWindowWMInfo(engine.GetWindow(), &windowInfo))
+    {
+        LOG_ERROR("Texture benchmark: needs the engine window, run without --headless");
+        return;
+    }
+
+    // Started from bin\ or from the project folder: look for the resources up the tree
+    std::filesystem::path directory = folder;
+    for (int up = 0; up < 3 && !std::filesystem::is_directory(directory); ++up)
+        directory = std::filesystem::path("..") / directory;
+    if (!std::filesystem::is_directory(directory))
+    {
+        LOG_ERROR("Texture benchmark: folder " + folder + " not found");
+        return;
+    }
+
+    std::vector<std::string> paths;
+    for (const auto& file : std::filesystem::directory_iterator(directory))
+    {
+        std::string extension = file.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (std::find(std::begin(extensions), std::end(extensions), extension) != std::end(extensions))
+            paths.push_back(file.path().string());
+    }
+    if (paths.empty())
+    {
+        LOG_ERROR("Texture benchmark: no images in " + directory.string());
+        return;
+    }
+
+    int width = 0, height = 0;
+    SDL_GetWindowSize(engine.GetWindow(), &width, &height);
+    BackendConfig backendConfig;
+    backendConfig.Width = width;
+    backendConfig.Height = height;
+    backendConfig.WindowHandle = windowInfo.info.win.window;
+
+    Rendeructor renderer;
+    if (!renderer.Create(backendConfig))
+    {
+        LOG_ERROR("Texture benchmark: failed to create the renderer");
+        return;
+    }
+
+    auto loadAll = [&paths](uint32_t threads)
+    {
+        std::vector<Texture> textures(paths.size());
+        std::vector<TextureLoadRequest> requests(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            requests[i].Target = &textures[i];
+            requests[i].Path = paths[i];
+        }
+        TextureBatchStats stats = Texture::LoadBatch(requests, threads);
+        for (auto& texture : textures)
+            texture.Release();
+        return stats;
+    };
+
+    // The first pass reads the files into the OS cache, so every thread count sees the same disk
+    loadAll(0);
+
+    double baselineMs = 0.0;
+    for (uint32_t threads : threadCounts)
+    {
+        TextureBatchStats stats = loadAll(threads);
+        if (threads == 1)
+            baselineMs = stats.TotalMs;
+
+        LOG_INFO("Texture benchmark: " + std::to_string(stats.Threads) + " threads, " +
+            std::to_string(stats.Loaded) + " loaded, " + std::to_string(stats.Failed) + " failed, decode " +
+            std::to_string(stats.DecodeMs) + " ms, upload " + std::to_string(stats.UploadMs) + " ms, total " +
+            std::to_string(stats.TotalMs) + " ms, speedup x" + std::to_string(baselineMs / stats.TotalMs));
+    }
+
+    renderer.Destroy();
+}
+
+int main(int argc, char* argv[])
 {
     Engine engine;
 
-    bool bEngineInitialized = engine.Initialize();
+    EngineConfig config;
+    bool bRunJobBenchmark = false;
+    bool bRunLogBenchmark = false;
+    bool bRunConstantBenchmark = false;
+    bool bRunDrawSortBenchmark = false;
+    bool bRunTextureBenchmark = false;
+    std::string textureBenchmarkFolder = "GameResources/textures";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--bench-jobs") == 0)
+        {
+            bRunJobBenchmark = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-log") == 0)
+        {
+            bRunLogBenchmark = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-constants") == 0)
+        {
+            bRunConstantBenchmark = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-drawsort") == 0)
+        {
+            bRunDrawSortBenchmark = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-textures") == 0)
+        {
+            // --bench-textures [folder]: default is the shipped textures
+            bRunTextureBenchmark = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                textureBenchmarkFolder = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            // --headless [frames]: soak test without a window
+            config.bHeadless = true;
+            config.MaxFrames = 1000;
+            if (i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0]))
+                config.MaxFrames = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
+    bool bEngineInitialized = engine.Initialize(config);
 
     if(!bEngineInitialized)
     {
@@ -27,6 +417,21 @@ int main()
 
     TestAfterMath();
 
+    if (bRunJobBenchmark)
+        BenchmarkJobSystem();
+
+    if (bRunLogBenchmark)
+        BenchmarkLogger();
+
+    if (bRunConstantBenchmark)
+        BenchmarkConstants();
+
+    if (bRunDrawSortBenchmark)
+        BenchmarkDrawSort();
+
+    if (bRunTextureBenchmark)
+        BenchmarkTextureLoading(engine, textureBenchmarkFolder);
+
     engine.Run();
     engine.Shutdown();
 
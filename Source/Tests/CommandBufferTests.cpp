@@ -0,0 +1,222 @@
+#include "TestFramework.h"
+
+#include <Rendeructor/RendeructorCommandBuffer.h>
+
+#include <string>
+
+namespace
+{
+	// Stands in for BackendInterface in RenderCommandBuffer::Replay: every call is written down
+	// as text, constant payloads as their bytes
+	struct RecordingBackend
+	{
+		std::vector<std::string> Calls;
+		uint32_t MisalignedConstants = 0;
+
+		void SetShaderPass(const ShaderPass& pass)
+		{
+			Calls.push_back("SetShaderPass " + std::to_string((uintptr_t)&pass));
+		}
+		void UpdateConstantRaw(ConstantId id, const void* data, size_t size)
+		{
+			if ((uintptr_t)data % RenderCommandBuffer::CommandAlignment != 0)
+				++MisalignedConstants;
+			std::string call = "UpdateConstantRaw " + std::to_string(id.Hash) + " " + std::to_string(size) + ":";
+			for (size_t i = 0; i < size; ++i)
+				call += " " + std::to_string(((const uint8_t*)data)[i]);
+			Calls.push_back(call);
+		}
+		void SetRenderTarget(TextureHandle t1, TextureHandle t2, TextureHandle t3, TextureHandle t4)
+		{
+			Calls.push_back("SetRenderTarget " + Name(t1) + " " + Name(t2) + " " + Name(t3) + " " + Name(t4));
+		}
+		void Clear(float r, float g, float b, float a)
+		{
+			Calls.push_back("Clear " + Floats({r, g, b, a}));
+		}
+		void ClearTexture(TextureHandle target, float r, float g, float b, float a)
+		{
+			Calls.push_back("ClearTexture " + Name(target) + " " + Floats({r, g, b, a}));
+		}
+		void ClearDepth(float depth, int stencil)
+		{
+			Calls.push_back("ClearDepth " + Floats({depth}) + " " + std::to_string(stencil));
+		}
+		void DrawMesh(BufferHandle vb, BufferHandle ib, int indexCount)
+		{
+			Calls.push_back("DrawMesh " + Name(vb) + " " + Name(ib) + " " + std::to_string(indexCount));
+		}
+		void DrawMeshInstanced(BufferHandle vb, BufferHandle ib, int indexCount, BufferHandle instances, int instanceCount,
+							   int instanceStride, int firstInstance)
+		{
+			Calls.push_back("DrawMeshInstanced " + Name(vb) + " " + Name(ib) + " " + std::to_string(indexCount) + " " +
+							Name(instances) + " " + std::to_string(instanceCount) + " " + std::to_string(instanceStride) + " " +
+							std::to_string(firstInstance));
+		}
+		void DrawFullScreenQuad()
+		{
+			Calls.push_back("DrawFullScreenQuad");
+		}
+
+		template <typename Tag>
+		static std::string Name(ResourceHandle<Tag> handle)
+		{
+			return handle.IsValid() ? std::to_string(handle.Index) + "/" + std::to_string(handle.Generation) : "-";
+		}
+		static std::string Floats(std::initializer_list<float> values)
+		{
+			std::string text;
+			for (float value : values)
+				text += (text.empty() ? "" : ",") + std::to_string(value);
+			return text;
+		}
+	};
+
+	template <typename Tag>
+	ResourceHandle<Tag> Handle(uint32_t index, uint32_t generation = 1)
+	{
+		ResourceHandle<Tag> handle;
+		handle.Index = index;
+		handle.Generation = generation;
+		return handle;
+	}
+
+	std::vector<std::string> Replay(const RenderCommandBuffer& buffer)
+	{
+		RecordingBackend backend;
+		buffer.Replay(backend);
+		CHECK_EQ(backend.MisalignedConstants, 0u);
+		return backend.Calls;
+	}
+}
+
+TEST(EveryCommandReplaysWithItsArguments)
+{
+	const ShaderPass* pass = reinterpret_cast<const ShaderPass*>(uintptr_t(0x1000));
+	BufferHandle vb = Handle<BufferHandleTag>(3, 7), ib = Handle<BufferHandleTag>(4, 2), inst = Handle<BufferHandleTag>(9);
+	TextureHandle a = Handle<TextureHandleTag>(1, 5), b = Handle<TextureHandleTag>(2);
+
+	RenderCommandBuffer buffer;
+	buffer.SetPass(*pass);
+	buffer.SetRenderTarget(a, b);
+	buffer.SetRenderTarget(TextureHandle());
+	buffer.Clear(0.25f, 0.5f, 0.75f);
+	buffer.ClearTexture(b, 1.0f, 0.0f, 0.0f, 0.5f);
+	buffer.ClearDepth(0.0f, 3);
+	buffer.DrawMesh(vb, ib, 36);
+	buffer.DrawMeshInstanced(vb, ib, 6, inst, 100, 64, 12);
+	buffer.DrawFullScreenQuad();
+	CHECK_EQ(buffer.GetCommandCount(), (size_t)9);
+
+	std::vector<std::string> expected = {
+		"SetShaderPass " + std::to_string(0x1000),
+		"SetRenderTarget 1/5 2/1 - -",
+		"SetRenderTarget - - - -",
+		"Clear 0.250000,0.500000,0.750000,1.000000",
+		"ClearTexture 2/1 1.000000,0.000000,0.000000,0.500000",
+		"ClearDepth 0.000000 3",
+		"DrawMesh 3/7 4/2 36",
+		"DrawMeshInstanced 3/7 4/2 6 9/1 100 64 12",
+		"DrawFullScreenQuad",
+	};
+	std::vector<std::string> calls = Replay(buffer);
+	REQUIRE(calls.size() == expected.size());
+	for (size_t i = 0; i < calls.size(); ++i)
+	{
+		if (calls[i] != expected[i])
+			std::printf("  got \"%s\", expected \"%s\"\n", calls[i].c_str(), expected[i].c_str());
+		CHECK(calls[i] == expected[i]);
+	}
+}
+
+TEST(ConstantPayloadsKeepTheirBytesAndAlignment)
+{
+	constexpr ConstantId world("World");
+	RenderCommandBuffer buffer;
+
+	// Sizes around the 8-byte command alignment, each followed by another command
+	for (uint32_t size = 1; size <= 17; ++size)
+	{
+		std::vector<uint8_t> bytes(size);
+		for (uint32_t i = 0; i < size; ++i)
+			bytes[i] = (uint8_t)(size * 16 + i);
+		buffer.SetConstants(world, bytes.data(), size);
+		buffer.ClearDepth();
+		CHECK_EQ(buffer.GetSizeBytes() % RenderCommandBuffer::CommandAlignment, (size_t)0);
+	}
+	struct Matrix
+	{
+		float M[16];
+	} matrix = {{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16}};
+	buffer.SetConstant(world, matrix);
+
+	std::vector<std::string> calls = Replay(buffer);
+	REQUIRE(calls.size() == 17 * 2 + 1);
+	for (uint32_t size = 1; size <= 17; ++size)
+	{
+		std::string expected = "UpdateConstantRaw " + std::to_string(world.Hash) + " " + std::to_string(size) + ":";
+		for (uint32_t i = 0; i < size; ++i)
+			expected += " " + std::to_string((uint8_t)(size * 16 + i));
+		CHECK(calls[(size - 1) * 2] == expected);
+	}
+
+	RecordingBackend single;
+	RenderCommandBuffer one;
+	one.SetConstant(world, matrix);
+	one.Replay(single);
+	std::string expected = "UpdateConstantRaw " + std::to_string(world.Hash) + " 64:";
+	for (size_t i = 0; i < sizeof(matrix); ++i)
+		expected += " " + std::to_string(((const uint8_t*)&matrix)[i]);
+	CHECK(calls.back() == expected);
+	CHECK(single.Calls.size() == 1 && single.Calls[0] == expected);
+}
+
+TEST(AppendKeepsBuffersInOrder)
+{
+	RenderCommandBuffer shadows, opaque, empty, merged;
+	shadows.ClearDepth(1.0f, 0);
+	shadows.DrawMesh(Handle<BufferHandleTag>(1), Handle<BufferHandleTag>(2), 3);
+	opaque.SetConstant(ConstantId("Tint"), 0x01020304u);
+	opaque.DrawFullScreenQuad();
+
+	merged.Clear(0, 0, 0);
+	size_t clearSize = merged.GetSizeBytes();
+	merged.Append(shadows);
+	merged.Append(empty);
+	merged.Append(opaque);
+	CHECK_EQ(merged.GetCommandCount(), (size_t)5);
+	CHECK_EQ(merged.GetSizeBytes(), clearSize + shadows.GetSizeBytes() + opaque.GetSizeBytes());
+
+	std::vector<std::string> calls = Replay(merged);
+	REQUIRE(calls.size() == 5);
+	CHECK(calls[0].rfind("Clear ", 0) == 0);
+	CHECK(calls[1] == "ClearDepth 1.000000 0");
+	CHECK(calls[2] == "DrawMesh 1/1 2/1 3");
+	CHECK(calls[3] == "UpdateConstantRaw " + std::to_string(ConstantId("Tint").Hash) + " 4: 4 3 2 1");
+	CHECK(calls[4] == "DrawFullScreenQuad");
+	// Sources are left as they were
+	CHECK_EQ(Replay(shadows).size(), (size_t)2);
+}
+
+TEST(ResetKeepsTheMemory)
+{
+	RenderCommandBuffer buffer;
+	for (int i = 0; i < 1000; ++i)
+		buffer.DrawMesh(Handle<BufferHandleTag>(i), Handle<BufferHandleTag>(i), i);
+	size_t capacity = buffer.GetCapacityBytes();
+	CHECK(capacity >= buffer.GetSizeBytes());
+
+	buffer.Reset();
+	CHECK(buffer.IsEmpty());
+	CHECK_EQ(buffer.GetSizeBytes(), (size_t)0);
+	CHECK_EQ(buffer.GetCapacityBytes(), capacity);
+	CHECK(Replay(buffer).empty());
+
+	// A frame of the same size records without growing
+	for (int i = 0; i < 1000; ++i)
+		buffer.DrawMesh(Handle<BufferHandleTag>(i), Handle<BufferHandleTag>(i), i);
+	CHECK_EQ(buffer.GetCapacityBytes(), capacity);
+	CHECK_EQ(Replay(buffer).size(), (size_t)1000);
+}
+
+TEST_MAIN()
@@ -0,0 +1,143 @@
+#include "TestFramework.h"
+
+#include <Rendeructor/RendeructorDDS.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	std::vector<uint8_t> ReadTexture(const std::string& name)
+	{
+		std::ifstream file(std::string(ARMILLARY_GAME_RESOURCES) + "/textures/" + name, std::ios::binary | std::ios::ate);
+		if (!file)
+			return {};
+		std::vector<uint8_t> data((size_t)file.tellg());
+		file.seekg(0);
+		file.read((char*)data.data(), (std::streamsize)data.size());
+		return data;
+	}
+
+	struct ShippedTexture
+	{
+		const char* Name;
+		DdsFormat Format;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t MipCount;
+	};
+
+	const ShippedTexture ShippedTextures[] = {
+		{"dummy_white.dds", DdsFormat::BC1, 256, 256, 1},
+		{"dummy_black.dds", DdsFormat::BC1, 256, 256, 1},
+		{"dummy_normal.dds", DdsFormat::BC1, 256, 256, 1},
+		{"nobody.dds", DdsFormat::BC3, 512, 512, 1},
+		{"dingus_nowhiskers.dds", DdsFormat::BGRX8, 512, 512, 10},
+	};
+
+	void Write32(std::vector<uint8_t>& file, size_t offset, uint32_t value)
+	{
+		memcpy(&file[offset], &value, sizeof(value));
+	}
+}
+
+TEST(ShippedTexturesParse)
+{
+	for (const ShippedTexture& expected : ShippedTextures)
+	{
+		std::vector<uint8_t> file = ReadTexture(expected.Name);
+		REQUIRE(!file.empty());
+
+		DdsImage image;
+		std::string error;
+		bool parsed = DdsParser::Parse(file.data(), file.size(), image, &error);
+		if (!parsed)
+			std::printf("  %s: %s\n", expected.Name, error.c_str());
+		REQUIRE(parsed);
+
+		CHECK(image.Format == expected.Format);
+		CHECK_EQ(image.Width, expected.Width);
+		CHECK_EQ(image.Height, expected.Height);
+		CHECK_EQ(image.MipCount, expected.MipCount);
+		CHECK_EQ(image.ArraySize, 1u);
+		CHECK(!image.IsCube);
+		REQUIRE(image.Subresources.size() == expected.MipCount);
+
+		// Mips halve down to 1x1 and their data tiles the file up to its last byte
+		const uint8_t* next = image.Subresources[0].Data;
+		for (uint32_t mip = 0; mip < image.MipCount; ++mip)
+		{
+			const DdsSubresource& sub = image.Get(0, mip);
+			CHECK_EQ(sub.Width, std::max(1u, expected.Width >> mip));
+			CHECK_EQ(sub.Height, std::max(1u, expected.Height >> mip));
+			CHECK_EQ(sub.RowPitch, DdsParser::GetRowPitch(image.Format, sub.Width));
+			CHECK_EQ(sub.Size, (size_t)sub.RowPitch * DdsParser::GetRowCount(image.Format, sub.Height));
+			CHECK(sub.Data == next);
+			next = sub.Data + sub.Size;
+		}
+		CHECK(next == file.data() + file.size());
+	}
+}
+
+TEST(TruncatedFilesAreRejected)
+{
+	for (const ShippedTexture& expected : ShippedTextures)
+	{
+		std::vector<uint8_t> file = ReadTexture(expected.Name);
+		REQUIRE(!file.empty());
+
+		DdsImage image;
+		CHECK(!DdsParser::Parse(file.data(), file.size() - 1, image));
+		CHECK(!DdsParser::Parse(file.data(), 100, image));
+		CHECK(!DdsParser::Parse(file.data(), 0, image));
+	}
+}
+
+TEST(BadMagicIsRejected)
+{
+	std::vector<uint8_t> file = ReadTexture("dummy_white.dds");
+	REQUIRE(!file.empty());
+	file[0] = 'X';
+	DdsImage image;
+	std::string error;
+	CHECK(!DdsParser::Parse(file.data(), file.size(), image, &error));
+	CHECK(!error.empty());
+}
+
+TEST(Dx10CubeArrayLayout)
+{
+	// 8x8 BC7 sRGB cube with 2 mips, DX10 header
+	std::vector<uint8_t> file(4 + 124 + 20, 0);
+	Write32(file, 0, 0x20534444);
+	Write32(file, 4, 124);
+	Write32(file, 8, 0x20000 | 0x1007);
+	Write32(file, 12, 8);
+	Write32(file, 16, 8);
+	Write32(file, 28, 2);
+	Write32(file, 4 + 72, 32);
+	Write32(file, 4 + 76, 0x4);
+	Write32(file, 4 + 80, 0x30315844); // "DX10"
+	Write32(file, 128, 99);			   // DXGI_FORMAT_BC7_UNORM_SRGB
+	Write32(file, 132, 3);			   // Texture2D
+	Write32(file, 136, 0x4);		   // Cube
+	Write32(file, 140, 1);
+	size_t perFace = 2 * 2 * 16 + 1 * 16;
+	file.resize(file.size() + 6 * perFace, 7);
+
+	DdsImage image;
+	std::string error;
+	REQUIRE(DdsParser::Parse(file.data(), file.size(), image, &error));
+	CHECK(image.Format == DdsFormat::BC7);
+	CHECK(image.Srgb);
+	CHECK(image.IsCube);
+	CHECK_EQ(image.ArraySize, 6u);
+	CHECK_EQ(image.MipCount, 2u);
+	CHECK_EQ(image.Get(1, 0).Size, (size_t)64);
+	CHECK_EQ(image.Get(5, 1).RowPitch, 16u);
+	CHECK(image.Get(5, 1).Data + image.Get(5, 1).Size == file.data() + file.size());
+
+	// One byte short of the last face
+	CHECK(!DdsParser::Parse(file.data(), file.size() - 1, image));
+}
+
+TEST_MAIN()
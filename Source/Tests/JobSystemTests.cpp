@@ -0,0 +1,107 @@
+#include "TestFramework.h"
+
+#include <JobSystem.h>
+
+#include <atomic>
+#include <numeric>
+
+using namespace Armillary;
+
+TEST(ParallelForWithTinyGrainsCoversEveryElement)
+{
+	JobSystem jobSystem;
+	jobSystem.Initialize(4);
+
+	// Every iteration has a fresh counter on ParallelFor's stack: a worker still touching it
+	// after Wait() returned shows up here (and reliably under -fsanitize=address or thread)
+	std::vector<uint32_t> hits(97);
+	uint32_t wrongSums = 0;
+	for (int iteration = 0; iteration < 20000; ++iteration)
+	{
+		std::atomic<uint32_t> sum{0};
+		jobSystem.ParallelFor((uint32_t)hits.size(), 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				++hits[i];
+				sum.fetch_add(i, std::memory_order_relaxed);
+			}
+		});
+		if (sum.load() != 97u * 96u / 2u)
+			++wrongSums;
+	}
+	jobSystem.Shutdown();
+
+	CHECK_EQ(wrongSums, 0u);
+	for (uint32_t count : hits)
+		CHECK_EQ(count, 20000u);
+}
+
+TEST(CountersOnTheStackCanBeDestroyedRightAfterWait)
+{
+	JobSystem jobSystem;
+	jobSystem.Initialize(3);
+
+	std::atomic<uint32_t> ran{0};
+	for (int iteration = 0; iteration < 20000; ++iteration)
+	{
+		JobCounter counter;
+		JobCounter after;
+		for (int i = 0; i < 4; ++i)
+			jobSystem.Schedule([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		// A continuation is handed over by the last job of `counter` while it finishes
+		jobSystem.Schedule([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &after, &counter);
+		jobSystem.Wait(after);
+		jobSystem.Wait(counter);
+	}
+	jobSystem.Shutdown();
+
+	CHECK_EQ(ran.load(), 20000u * 5u);
+}
+
+TEST(ContinuationRunsAfterItsDependency)
+{
+	JobSystem jobSystem;
+	jobSystem.Initialize(4);
+
+	uint32_t misordered = 0;
+	for (int iteration = 0; iteration < 2000; ++iteration)
+	{
+		std::atomic<int> finished{0};
+		int seenByContinuation = -1;
+		JobCounter first, second;
+		for (int i = 0; i < 8; ++i)
+			jobSystem.Schedule([&finished]() { finished.fetch_add(1); }, &first);
+		jobSystem.Schedule([&]() { seenByContinuation = finished.load(); }, &second, &first);
+		jobSystem.Wait(second);
+		if (seenByContinuation != 8)
+			++misordered;
+	}
+	jobSystem.Shutdown();
+
+	CHECK_EQ(misordered, 0u);
+}
+
+TEST(NestedJobSystemGivesTheThreadBack)
+{
+	JobSystem outer;
+	outer.Initialize(2);
+	{
+		JobSystem inner;
+		inner.Initialize(2);
+		std::vector<int> values(1000, 1);
+		inner.ParallelFor((uint32_t)values.size(), 16, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+				values[i] *= 2;
+		});
+		CHECK_EQ(std::accumulate(values.begin(), values.end(), 0), 2000);
+		inner.Shutdown();
+	}
+
+	// The calling thread is slot 0 of the outer system again and can push to its own queue
+	std::atomic<uint32_t> sum{0};
+	outer.ParallelFor(1000, 8, [&](uint32_t begin, uint32_t end) { sum.fetch_add(end - begin); });
+	CHECK_EQ(sum.load(), 1000u);
+	outer.Shutdown();
+}
+
+TEST_MAIN()
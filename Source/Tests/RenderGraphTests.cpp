@@ -0,0 +1,211 @@
+#include "TestFramework.h"
+
+#include <Rendeructor/RendeructorRenderGraph.h>
+
+#include <memory>
+
+namespace
+{
+	struct FakeTexture
+	{
+		int Id = 0;
+	};
+
+	using Graph = RenderGraph<FakeTexture>;
+
+	RenderGraphTextureDesc Desc(int width, int height, int format = 0)
+	{
+		RenderGraphTextureDesc desc;
+		desc.Width = width;
+		desc.Height = height;
+		desc.Format = format;
+		return desc;
+	}
+
+	void NoOp(const Graph&)
+	{
+	}
+}
+
+TEST(UnreadPassesAreCulled)
+{
+	FakeTexture backBuffer;
+	Graph graph;
+	RenderGraphResource screen = graph.ImportTexture("Screen", backBuffer, Desc(1280, 720));
+	RenderGraphResource gbuffer = graph.CreateTexture("GBuffer", Desc(1280, 720));
+	RenderGraphResource debug = graph.CreateTexture("Debug", Desc(1280, 720));
+
+	uint32_t geometry = graph.AddPass("Geometry", NoOp).Write(gbuffer).GetIndex();
+	uint32_t debugView = graph.AddPass("DebugView", NoOp).Read(gbuffer).Write(debug).GetIndex();
+	uint32_t lighting = graph.AddPass("Lighting", NoOp).Read(gbuffer).Write(screen).GetIndex();
+	graph.Compile();
+
+	CHECK(!graph.IsPassCulled(geometry));
+	CHECK(graph.IsPassCulled(debugView));
+	CHECK(!graph.IsPassCulled(lighting));
+	CHECK_EQ(graph.GetStats().PassesDeclared, 3u);
+	CHECK_EQ(graph.GetStats().PassesCulled, 1u);
+	CHECK(graph.GetExecutionOrder() == std::vector<uint32_t>({geometry, lighting}));
+	CHECK_EQ(graph.GetPhysicalIndex(debug), Graph::InvalidIndex);
+}
+
+TEST(EverythingIsCulledWithoutRoots)
+{
+	Graph graph;
+	RenderGraphResource a = graph.CreateTexture("A", Desc(64, 64));
+	RenderGraphResource b = graph.CreateTexture("B", Desc(64, 64));
+	graph.AddPass("First", NoOp).Write(a);
+	graph.AddPass("Second", NoOp).Read(a).Write(b);
+	graph.Compile();
+
+	CHECK_EQ(graph.GetStats().PassesCulled, 2u);
+	CHECK(graph.GetExecutionOrder().empty());
+	CHECK_EQ(graph.GetStats().TransientTextures, 0u);
+	CHECK_EQ(graph.GetStats().PeakLiveBytes, 0ull);
+}
+
+TEST(ImportedTextureKeepsItsWritersAndTheirInputs)
+{
+	FakeTexture history;
+	Graph graph;
+	RenderGraphResource imported = graph.ImportTexture("History", history, Desc(256, 256));
+	RenderGraphResource velocity = graph.CreateTexture("Velocity", Desc(256, 256));
+
+	uint32_t clear = graph.AddPass("ClearHistory", NoOp).Write(imported).GetIndex();
+	uint32_t motion = graph.AddPass("Motion", NoOp).Write(velocity).GetIndex();
+	uint32_t resolve = graph.AddPass("Resolve", NoOp).Read(velocity).Write(imported).GetIndex();
+	graph.Compile();
+
+	CHECK(!graph.IsPassCulled(clear));
+	CHECK(!graph.IsPassCulled(motion));
+	CHECK(!graph.IsPassCulled(resolve));
+	// Imported textures are never aliased
+	CHECK_EQ(graph.GetPhysicalIndex(imported), Graph::InvalidIndex);
+	CHECK_EQ(graph.GetStats().TransientTextures, 1u);
+}
+
+TEST(SideEffectPassIsARoot)
+{
+	Graph graph;
+	RenderGraphResource depth = graph.CreateTexture("Depth", Desc(512, 512, 1));
+	uint32_t prepass = graph.AddPass("DepthPrepass", NoOp).Write(depth).GetIndex();
+	uint32_t readback = graph.AddPass("Readback", NoOp).Read(depth).SideEffects().GetIndex();
+	uint32_t unused = graph.AddPass("Unused", NoOp).Read(depth).GetIndex();
+	graph.Compile();
+
+	CHECK(!graph.IsPassCulled(prepass));
+	CHECK(!graph.IsPassCulled(readback));
+	CHECK(graph.IsPassCulled(unused));
+}
+
+TEST(DisjointLifetimesShareOnePhysicalTexture)
+{
+	FakeTexture backBuffer;
+	Graph graph;
+	RenderGraphResource screen = graph.ImportTexture("Screen", backBuffer, Desc(1024, 1024));
+	RenderGraphResource t1 = graph.CreateTexture("T1", Desc(1024, 1024));
+	RenderGraphResource t2 = graph.CreateTexture("T2", Desc(1024, 1024));
+	RenderGraphResource t3 = graph.CreateTexture("T3", Desc(1024, 1024));
+	RenderGraphResource half = graph.CreateTexture("Half", Desc(512, 512));
+
+	graph.AddPass("P0", NoOp).Write(t1);
+	graph.AddPass("P1", NoOp).Read(t1).Write(t2);
+	graph.AddPass("P2", NoOp).Read(t2).Write(t3).Write(half);
+	graph.AddPass("P3", NoOp).Read(t3).Read(half).Write(screen);
+	graph.Compile();
+
+	// T1 lives in P0..P1, T2 in P1..P2, T3 in P2..P3: T1 and T3 alias, T2 overlaps both
+	CHECK_EQ(graph.GetPhysicalIndex(t1), graph.GetPhysicalIndex(t3));
+	CHECK(graph.GetPhysicalIndex(t1) != graph.GetPhysicalIndex(t2));
+	// A different description never aliases
+	CHECK(graph.GetPhysicalIndex(half) != graph.GetPhysicalIndex(t1));
+	CHECK(graph.GetPhysicalIndex(half) != graph.GetPhysicalIndex(t2));
+
+	const RenderGraphStats& stats = graph.GetStats();
+	uint64_t full = 1024ull * 1024 * 4, quarter = 512ull * 512 * 4;
+	CHECK_EQ(stats.TransientTextures, 4u);
+	CHECK_EQ(stats.PhysicalTextures, 3u);
+	CHECK_EQ(stats.TransientBytes, 3 * full + quarter);
+	CHECK_EQ(stats.PhysicalBytes, 2 * full + quarter);
+}
+
+TEST(PeakLiveBytesIsTheLargestPass)
+{
+	FakeTexture backBuffer;
+	Graph graph;
+	RenderGraphResource screen = graph.ImportTexture("Screen", backBuffer, Desc(100, 100));
+	RenderGraphTextureDesc big = Desc(100, 100);
+	big.BytesPerPixel = 8;
+	RenderGraphResource a = graph.CreateTexture("A", Desc(100, 100));
+	RenderGraphResource b = graph.CreateTexture("B", big);
+	RenderGraphResource c = graph.CreateTexture("C", Desc(50, 50));
+
+	graph.AddPass("P0", NoOp).Write(a);
+	graph.AddPass("P1", NoOp).Write(b);			 // A, B alive
+	graph.AddPass("P2", NoOp).Read(a).Read(b).Write(c); // A, B, C alive
+	graph.AddPass("P3", NoOp).Read(c).Write(screen);	 // C alive
+	graph.Compile();
+
+	uint64_t expected = 100ull * 100 * 4 + 100ull * 100 * 8 + 50ull * 50 * 4;
+	CHECK_EQ(graph.GetStats().PeakLiveBytes, expected);
+	CHECK(graph.GetStats().PeakLiveBytes <= graph.GetStats().TransientBytes);
+}
+
+TEST(ExecuteAcquiresOncePerPhysicalTextureAndRunsInOrder)
+{
+	FakeTexture backBuffer{-1};
+	Graph graph;
+	RenderGraphResource screen = graph.ImportTexture("Screen", backBuffer, Desc(64, 64));
+	RenderGraphResource t1 = graph.CreateTexture("T1", Desc(64, 64));
+	RenderGraphResource t2 = graph.CreateTexture("T2", Desc(64, 64));
+	RenderGraphResource t3 = graph.CreateTexture("T3", Desc(64, 64));
+	RenderGraphResource culled = graph.CreateTexture("Culled", Desc(64, 64));
+
+	std::vector<std::string> ran;
+	const FakeTexture* seenT1 = nullptr;
+	const FakeTexture* seenT3 = nullptr;
+	graph.AddPass("P0", [&](const Graph& g) { ran.push_back("P0"); seenT1 = g.GetTexture(t1); }).Write(t1);
+	graph.AddPass("Dead", [&](const Graph&) { ran.push_back("Dead"); }).Write(culled);
+	graph.AddPass("P1", [&](const Graph&) { ran.push_back("P1"); }).Read(t1).Write(t2);
+	graph.AddPass("P2", [&](const Graph& g) { ran.push_back("P2"); seenT3 = g.GetTexture(t3); }).Read(t2).Write(t3);
+	graph.AddPass("P3", [&](const Graph& g) {
+		ran.push_back("P3");
+		CHECK(g.GetTexture(screen) == &backBuffer);
+	}).Read(t3).Write(screen);
+
+	std::vector<std::unique_ptr<FakeTexture>> pool;
+	graph.Execute([&](const RenderGraphTextureDesc&) {
+		pool.push_back(std::make_unique<FakeTexture>());
+		pool.back()->Id = (int)pool.size();
+		return pool.back().get();
+	});
+
+	CHECK(ran == std::vector<std::string>({"P0", "P1", "P2", "P3"}));
+	CHECK_EQ(pool.size(), (size_t)graph.GetStats().PhysicalTextures);
+	CHECK(seenT1 != nullptr);
+	CHECK(seenT1 == seenT3);
+	CHECK(graph.GetTexture(culled) == nullptr);
+}
+
+TEST(ResetAndRecompileGivesTheSameResult)
+{
+	FakeTexture backBuffer;
+	Graph graph;
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		graph.Reset();
+		RenderGraphResource screen = graph.ImportTexture("Screen", backBuffer, Desc(32, 32));
+		RenderGraphResource a = graph.CreateTexture("A", Desc(32, 32));
+		RenderGraphResource b = graph.CreateTexture("B", Desc(32, 32));
+		graph.AddPass("P0", NoOp).Write(a);
+		graph.AddPass("P1", NoOp).Read(a).Write(b);
+		graph.AddPass("P2", NoOp).Read(b).Write(screen);
+		graph.Compile();
+
+		CHECK_EQ(graph.GetStats().PassesDeclared, 3u);
+		CHECK_EQ(graph.GetStats().PhysicalTextures, 2u);
+		CHECK_EQ(graph.GetExecutionOrder().size(), (size_t)3);
+	}
+}
+
+TEST_MAIN()
@@ -0,0 +1,396 @@
+#include "TestFramework.h"
+
+#include <Rendeructor/RendeructorResidency.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+// Replays texture usage traces through ResidencyPolicy the way TextureStreamer drives it
+// (mip tail up to 64 KB, replaced textures freed 3 frames later) with loads that take
+// LoadLatency frames, and reports how well the budget was kept.
+//   ResidencyReplay               runs the built-in scenarios as tests
+//   ResidencyReplay trace.txt     replays a recorded trace and prints the report
+// Trace format, one command per line:
+//   budget <bytes>
+//   texture <id> <size> <bc1|bc3|bgra8>      square texture with a full mip chain
+//   request <id> <screenSize> [priority]     pixels the texture covers per axis this frame
+//   unload <id>
+//   frame                                    ends the frame
+//   # comment
+namespace
+{
+	// Same as TextureStreamer
+	constexpr uint64_t TailBytes = 64 * 1024;
+	constexpr uint32_t ReleaseDelayFrames = 3;
+	constexpr uint32_t LoadLatency = 2;
+
+	struct ReplayReport
+	{
+		uint64_t Budget = 0;
+		uint32_t Frames = 0;
+		uint64_t PeakBytes = 0;		   // Resident + in flight + awaiting release
+		uint64_t PeakSettledBytes = 0; // Resident + in flight
+		uint32_t OverBudgetFrames = 0;
+		uint32_t SettledOverBudgetFrames = 0;
+		uint32_t StreamIns = 0;
+		uint32_t Evictions = 0;
+		uint32_t UnsatisfiedAtEnd = 0;
+		uint64_t UnsatisfiedTotal = 0;
+	};
+
+	class Replay
+	{
+	  public:
+		Replay()
+		{
+			m_policy.SetReleaseDelay(ReleaseDelayFrames);
+		}
+
+		void SetBudget(uint64_t bytes)
+		{
+			m_policy.SetBudget(bytes);
+		}
+
+		bool AddTexture(uint32_t key, uint32_t size, const std::string& format)
+		{
+			bool blocks = format == "bc1" || format == "bc3";
+			double bytesPerTexel = format == "bc1" ? 0.5 : format == "bc3" ? 1.0 : format == "bgra8" ? 4.0 : 0.0;
+			if (bytesPerTexel == 0.0 || size == 0 || m_textures.count(key))
+				return false;
+
+			std::vector<uint64_t> mipBytes;
+			uint32_t tailMip = ResidencyPolicy::InvalidMip;
+			for (uint32_t mip = 0; (size >> mip) > 0; ++mip)
+			{
+				uint64_t dim = size >> mip;
+				if (blocks)
+					dim = (dim + 3) / 4 * 4;
+				mipBytes.push_back((uint64_t)(dim * dim * bytesPerTexel));
+				if (mipBytes.back() <= TailBytes && tailMip == ResidencyPolicy::InvalidMip)
+					tailMip = mip;
+			}
+			m_textures[key] = {m_policy.Register(mipBytes, tailMip), size};
+			return true;
+		}
+
+		bool Request(uint32_t key, float screenSize, float priority = 1.0f)
+		{
+			auto it = m_textures.find(key);
+			if (it == m_textures.end())
+				return false;
+			m_policy.RequestMip(it->second.Id, ResidencyPolicy::MipForScreenSize(it->second.Size, screenSize), priority);
+			return true;
+		}
+
+		bool Unload(uint32_t key)
+		{
+			auto it = m_textures.find(key);
+			if (it == m_textures.end())
+				return false;
+			uint32_t id = it->second.Id;
+			m_policy.Unregister(id);
+			// The streamer drops loads that finish for an unloaded texture
+			m_loads.erase(std::remove_if(m_loads.begin(), m_loads.end(), [id](const Load& load) { return load.Texture == id; }), m_loads.end());
+			m_textures.erase(it);
+			return true;
+		}
+
+		void Frame()
+		{
+			// Loads finished during the last frame are installed before the policy runs
+			for (auto it = m_loads.begin(); it != m_loads.end();)
+			{
+				if (it->DoneAt <= m_report.Frames)
+				{
+					m_policy.CompleteStreamIn(it->Texture);
+					it = m_loads.erase(it);
+				}
+				else
+					++it;
+			}
+
+			m_ops.clear();
+			m_policy.Update(m_ops);
+			for (const ResidencyOp& op : m_ops)
+			{
+				if (op.Kind == ResidencyOp::Type::StreamIn)
+					m_loads.push_back({op.Texture, m_report.Frames + LoadLatency});
+			}
+
+			const ResidencyStats& stats = m_policy.GetStats();
+			uint64_t settled = stats.ResidentBytes + stats.InFlightBytes;
+			m_report.Budget = stats.Budget;
+			m_report.PeakBytes = stats.PeakBytes;
+			m_report.PeakSettledBytes = std::max(m_report.PeakSettledBytes, settled);
+			m_report.OverBudgetFrames = stats.OverBudgetUpdates;
+			if (settled > stats.Budget)
+				++m_report.SettledOverBudgetFrames;
+			m_report.StreamIns = stats.StreamIns;
+			m_report.Evictions = stats.Evictions;
+			m_report.UnsatisfiedAtEnd = stats.UnsatisfiedRequests;
+			m_report.UnsatisfiedTotal += stats.UnsatisfiedRequests;
+			++m_report.Frames;
+		}
+
+		uint32_t GetResidentMip(uint32_t key) const
+		{
+			auto it = m_textures.find(key);
+			return it == m_textures.end() ? ResidencyPolicy::InvalidMip : m_policy.GetResidentMip(it->second.Id);
+		}
+
+		uint64_t GetSettledBytes() const
+		{
+			return m_policy.GetStats().ResidentBytes + m_policy.GetStats().InFlightBytes;
+		}
+
+		const ReplayReport& GetReport() const
+		{
+			return m_report;
+		}
+
+		void Print(const char* name) const
+		{
+			const double mb = 1.0 / (1024.0 * 1024.0);
+			std::printf("  [%s] budget %.2f MB, %u frames: peak %.2f MB (settled %.2f MB), over budget %u frames "
+						"(settled %u), %u stream-ins, %u evictions, %u unsatisfied at end (%.2f per frame)\n",
+						name, m_report.Budget * mb, m_report.Frames, m_report.PeakBytes * mb, m_report.PeakSettledBytes * mb,
+						m_report.OverBudgetFrames, m_report.SettledOverBudgetFrames, m_report.StreamIns, m_report.Evictions,
+						m_report.UnsatisfiedAtEnd, m_report.Frames ? (double)m_report.UnsatisfiedTotal / m_report.Frames : 0.0);
+		}
+
+	  private:
+		struct TextureInfo
+		{
+			uint32_t Id;
+			uint32_t Size;
+		};
+
+		struct Load
+		{
+			uint32_t Texture;
+			uint32_t DoneAt;
+		};
+
+		ResidencyPolicy m_policy;
+		std::unordered_map<uint32_t, TextureInfo> m_textures;
+		std::vector<Load> m_loads;
+		std::vector<ResidencyOp> m_ops;
+		ReplayReport m_report;
+	};
+
+	bool ReplayTrace(std::istream& input, Replay& replay, std::string& error)
+	{
+		std::string line;
+		for (uint32_t lineNumber = 1; std::getline(input, line); ++lineNumber)
+		{
+			std::istringstream words(line);
+			std::string command;
+			if (!(words >> command) || command[0] == '#')
+				continue;
+
+			bool ok = false;
+			if (command == "frame")
+			{
+				replay.Frame();
+				ok = true;
+			}
+			else if (command == "budget")
+			{
+				uint64_t bytes;
+				if ((ok = (bool)(words >> bytes)))
+					replay.SetBudget(bytes);
+			}
+			else if (command == "texture")
+			{
+				uint32_t key, size;
+				std::string format;
+				ok = (words >> key >> size >> format) && replay.AddTexture(key, size, format);
+			}
+			else if (command == "request")
+			{
+				uint32_t key;
+				float screenSize, priority = 1.0f;
+				if (words >> key >> screenSize)
+				{
+					words >> priority;
+					ok = replay.Request(key, screenSize, priority);
+				}
+			}
+			else if (command == "unload")
+			{
+				uint32_t key;
+				ok = (words >> key) && replay.Unload(key);
+			}
+
+			if (!ok)
+			{
+				error = "line " + std::to_string(lineNumber) + ": " + line;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	constexpr uint64_t MB = 1024 * 1024;
+}
+
+TEST(CameraFlyBy)
+{
+	// 96 BC1 1024x1024 textures along a corridor, the camera goes from one end to the other
+	Replay replay;
+	replay.SetBudget(8 * MB);
+	const uint32_t count = 96;
+	const float spacing = 10.0f;
+	for (uint32_t i = 0; i < count; ++i)
+		REQUIRE(replay.AddTexture(i, 1024, "bc1"));
+
+	bool nearIsSharp = true;
+	for (float camera = 0.0f; camera < count * spacing; camera += 0.5f)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			float distance = std::fabs(i * spacing - camera);
+			if (distance < 40.0f)
+				replay.Request(i, 4096.0f / (1.0f + distance));
+		}
+		replay.Frame();
+
+		// A texture the camera stands next to for a while has all its detail
+		uint32_t nearest = std::min(count - 1, (uint32_t)(camera / spacing + 0.5f));
+		float offset = std::fabs(nearest * spacing - camera);
+		if (offset == 0.0f && replay.GetReport().Frames > 20 && replay.GetResidentMip(nearest) > 1)
+			nearIsSharp = false;
+	}
+	replay.Print("fly-by");
+
+	const ReplayReport& report = replay.GetReport();
+	CHECK_EQ(report.SettledOverBudgetFrames, 0u);
+	CHECK(report.PeakBytes <= report.Budget + 2 * MB);
+	CHECK(report.OverBudgetFrames * 20 <= report.Frames);
+	CHECK(nearIsSharp);
+	// Every texture needs 2 levels streamed in once, some lose them and get them back
+	CHECK(report.StreamIns >= count * 2);
+	CHECK(report.StreamIns <= count * 4);
+}
+
+TEST(ShrinkingBudgetDropsLowPriorityDetailFirst)
+{
+	Replay replay;
+	replay.SetBudget(32 * MB);
+	const uint32_t count = 32;
+	for (uint32_t i = 0; i < count; ++i)
+		REQUIRE(replay.AddTexture(i, 1024, "bc1"));
+
+	uint32_t shrunkAt = 60;
+	uint32_t settledLate = 0;
+	for (uint32_t frame = 0; frame < 200; ++frame)
+	{
+		if (frame == shrunkAt)
+			replay.SetBudget(8 * MB);
+		for (uint32_t i = 0; i < count; ++i)
+			replay.Request(i, 1024.0f, 1.0f + i);
+		replay.Frame();
+
+		if (frame == shrunkAt - 1)
+			CHECK_EQ(replay.GetReport().UnsatisfiedAtEnd, 0u);
+		// Loads that were in flight when the budget shrank still count until they land
+		if (frame > shrunkAt + LoadLatency && replay.GetSettledBytes() > 8 * MB)
+			++settledLate;
+	}
+	replay.Print("budget shrink");
+
+	CHECK_EQ(settledLate, 0u);
+	CHECK_EQ(replay.GetResidentMip(count - 1), 0u);
+	CHECK(replay.GetResidentMip(0) > 0);
+	// Settles: no level keeps going back and forth
+	uint32_t streamIns = replay.GetReport().StreamIns;
+	for (uint32_t frame = 0; frame < 50; ++frame)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			replay.Request(i, 1024.0f, 1.0f + i);
+		replay.Frame();
+	}
+	CHECK_EQ(replay.GetReport().StreamIns, streamIns);
+}
+
+TEST(AlternatingSetsStreamEachLevelOncePerSwitch)
+{
+	// Two rooms of 16 textures, the budget holds the detail of one
+	Replay replay;
+	const uint32_t perSet = 16;
+	for (uint32_t i = 0; i < perSet * 2; ++i)
+		REQUIRE(replay.AddTexture(i, 1024, "bc1"));
+	replay.SetBudget(perSet * 700 * 1024 + perSet * 64 * 1024);
+
+	const uint32_t switches = 10;
+	for (uint32_t room = 0; room < switches; ++room)
+	{
+		uint32_t first = (room % 2) * perSet;
+		for (uint32_t frame = 0; frame < 30; ++frame)
+		{
+			for (uint32_t i = first; i < first + perSet; ++i)
+				replay.Request(i, 1024.0f);
+			replay.Frame();
+		}
+		CHECK_EQ(replay.GetReport().UnsatisfiedAtEnd, 0u);
+	}
+	replay.Print("alternating rooms");
+
+	const ReplayReport& report = replay.GetReport();
+	CHECK_EQ(report.SettledOverBudgetFrames, 0u);
+	CHECK_EQ(report.StreamIns, switches * perSet * 2);
+	CHECK(report.Evictions <= report.StreamIns);
+	// Over only by the smaller copies of just evicted textures
+	CHECK(report.PeakBytes <= report.Budget + MB);
+}
+
+TEST(TraceFileCommands)
+{
+	std::istringstream trace("# two textures\n"
+							 "budget 1048576\n"
+							 "texture 7 1024 bc1\n"
+							 "texture 9 256 bgra8\n"
+							 "request 7 1024\n"
+							 "request 9 64 2\n"
+							 "frame\n"
+							 "frame\n"
+							 "frame\n"
+							 "unload 9\n"
+							 "frame\n");
+	Replay replay;
+	std::string error;
+	REQUIRE(ReplayTrace(trace, replay, error));
+	CHECK_EQ(replay.GetReport().Frames, 4u);
+	CHECK_EQ(replay.GetReport().Budget, 1048576ull);
+	CHECK(replay.GetResidentMip(7) < 2);
+	CHECK_EQ(replay.GetResidentMip(9), ResidencyPolicy::InvalidMip);
+
+	std::istringstream bad("texture 1 512 dxt9\n");
+	CHECK(!ReplayTrace(bad, replay, error));
+	CHECK(error.find("line 1") == 0);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+		return TestRegistry::Get().Run();
+
+	std::ifstream file(argv[1]);
+	if (!file)
+	{
+		std::printf("Can't open %s\n", argv[1]);
+		return 1;
+	}
+	Replay replay;
+	std::string error;
+	if (!ReplayTrace(file, replay, error))
+	{
+		std::printf("%s: %s\n", argv[1], error.c_str());
+		return 1;
+	}
+	replay.Print(argv[1]);
+	return 0;
+}
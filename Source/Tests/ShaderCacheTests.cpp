@@ -0,0 +1,225 @@
+#include "TestFramework.h"
+
+#include <Rendeructor/RendeructorShaderCache.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// Scratch directory with a shader and its includes, removed at the end of the test
+	class ShaderDirectory
+	{
+	  public:
+		explicit ShaderDirectory(const char* name) : m_path(fs::temp_directory_path() / "armillary-shader-cache-tests" / name)
+		{
+			fs::remove_all(m_path);
+			fs::create_directories(m_path / "Include");
+			WriteFile("Lighting.hlsl", "#include \"Include/Common.hlsl\"\n"
+									   "  #  include <Include/Brdf.hlsl>\n"
+									   "float4 PS() : SV_Target { return Shade(); }\n");
+			WriteFile("Include/Common.hlsl", "#include \"Brdf.hlsl\"\ncbuffer Frame { float4x4 View; };\n");
+			WriteFile("Include/Brdf.hlsl", "float4 Shade() { return 1; }\n");
+		}
+		~ShaderDirectory()
+		{
+			std::error_code error;
+			fs::remove_all(m_path, error);
+		}
+
+		void WriteFile(const fs::path& name, const std::string& text) const
+		{
+			std::ofstream file(m_path / name, std::ios::binary | std::ios::trunc);
+			file << text;
+		}
+		const fs::path& GetPath() const
+		{
+			return m_path;
+		}
+
+		uint64_t Key(const ShaderDefines& defines = {{"SHADOWS", "1"}}, const std::string& entry = "PS",
+					 const std::string& profile = "ps_5_0", uint32_t flags = 0, uint32_t compiler = 47) const
+		{
+			return ShaderCache::ComputeKey(m_path / "Lighting.hlsl", entry, profile, defines, flags, compiler);
+		}
+
+	  private:
+		fs::path m_path;
+	};
+
+	ShaderCacheEntry MakeEntry()
+	{
+		ShaderCacheEntry entry;
+		for (int i = 0; i < 300; ++i)
+			entry.Bytecode.push_back((uint8_t)(i * 7));
+		entry.ConstantBuffers = {
+			{"Frame", 0, 128, {{"View", 0, 64}, {"Projection", 64, 64}}},
+			{"Object", 1, 16, {{"Tint", 0, 16}}},
+			{"Empty", 4, 0, {}},
+		};
+		entry.TextureSlots = {{"Albedo", 0}, {"Normal", 3}};
+		entry.SamplerSlots = {{"Linear", 1}};
+		entry.InputElements = {{"POSITION", 0, 0x7}, {"TEXCOORD", 1, 0x3}};
+		return entry;
+	}
+
+	bool Same(const ShaderCacheEntry& a, const ShaderCacheEntry& b)
+	{
+		if (a.Bytecode != b.Bytecode || a.ConstantBuffers.size() != b.ConstantBuffers.size() ||
+			a.TextureSlots.size() != b.TextureSlots.size() || a.SamplerSlots.size() != b.SamplerSlots.size() ||
+			a.InputElements.size() != b.InputElements.size())
+			return false;
+		for (size_t i = 0; i < a.ConstantBuffers.size(); ++i)
+		{
+			const auto& x = a.ConstantBuffers[i];
+			const auto& y = b.ConstantBuffers[i];
+			if (x.Name != y.Name || x.Slot != y.Slot || x.Size != y.Size || x.Variables.size() != y.Variables.size())
+				return false;
+			for (size_t v = 0; v < x.Variables.size(); ++v)
+			{
+				if (x.Variables[v].Name != y.Variables[v].Name || x.Variables[v].Offset != y.Variables[v].Offset ||
+					x.Variables[v].Size != y.Variables[v].Size)
+					return false;
+			}
+		}
+		auto sameSlots = [](const std::vector<ShaderCacheSlot>& x, const std::vector<ShaderCacheSlot>& y) {
+			for (size_t i = 0; i < x.size(); ++i)
+			{
+				if (x[i].Name != y[i].Name || x[i].Slot != y[i].Slot)
+					return false;
+			}
+			return true;
+		};
+		if (!sameSlots(a.TextureSlots, b.TextureSlots) || !sameSlots(a.SamplerSlots, b.SamplerSlots))
+			return false;
+		for (size_t i = 0; i < a.InputElements.size(); ++i)
+		{
+			const auto& x = a.InputElements[i];
+			const auto& y = b.InputElements[i];
+			if (x.SemanticName != y.SemanticName || x.SemanticIndex != y.SemanticIndex || x.Mask != y.Mask)
+				return false;
+		}
+		return true;
+	}
+}
+
+TEST(KeyIsStableWhenNothingChanges)
+{
+	ShaderDirectory shaders("stable");
+	uint64_t key = shaders.Key();
+	CHECK(key != 0);
+	CHECK_EQ(shaders.Key(), key);
+
+	// Rewriting the same text (new timestamp) or reaching an include twice doesn't matter
+	shaders.WriteFile("Include/Brdf.hlsl", "float4 Shade() { return 1; }\n");
+	CHECK_EQ(shaders.Key(), key);
+	CHECK_EQ(ShaderCache::ComputeKey(shaders.GetPath() / "Include" / ".." / "Lighting.hlsl", "PS", "ps_5_0",
+									 {{"SHADOWS", "1"}}, 0, 47),
+			 key);
+
+	CHECK_EQ(ShaderCache::ComputeKey(shaders.GetPath() / "Missing.hlsl", "PS", "ps_5_0", {}, 0, 47), 0ull);
+}
+
+TEST(KeyChangesWithEverythingThatReachesTheCompiler)
+{
+	ShaderDirectory shaders("inputs");
+	const uint64_t key = shaders.Key();
+
+	CHECK(shaders.Key({{"SHADOWS", "0"}}) != key);
+	CHECK(shaders.Key({{"SHADOWS", "1"}, {"FOG", "1"}}) != key);
+	CHECK(shaders.Key({}) != key);
+	// Define boundaries are part of the key
+	CHECK(shaders.Key({{"SHADOWS1", ""}}) != shaders.Key({{"SHADOWS", "1"}}));
+	CHECK(shaders.Key({{"SHADOWS", "1"}}, "VS") != key);
+	CHECK(shaders.Key({{"SHADOWS", "1"}}, "PS", "ps_5_1") != key);
+	CHECK(shaders.Key({{"SHADOWS", "1"}}, "PS", "ps_5_0", 1) != key);
+	CHECK(shaders.Key({{"SHADOWS", "1"}}, "PS", "ps_5_0", 0, 48) != key);
+
+	shaders.WriteFile("Lighting.hlsl", "#include \"Include/Common.hlsl\"\n"
+									   "  #  include <Include/Brdf.hlsl>\n"
+									   "float4 PS() : SV_Target { return Shade() * 2; }\n");
+	const uint64_t editedSource = shaders.Key();
+	CHECK(editedSource != key);
+
+	// A nested include, reached only through Common.hlsl
+	shaders.WriteFile("Include/Brdf.hlsl", "float4 Shade() { return 0.5; }\n");
+	const uint64_t editedInclude = shaders.Key();
+	CHECK(editedInclude != editedSource);
+
+	shaders.WriteFile("Include/Common.hlsl", "#include \"Brdf.hlsl\"\ncbuffer Frame { float4x4 ViewProj; };\n");
+	CHECK(shaders.Key() != editedInclude);
+}
+
+TEST(EntriesRoundTrip)
+{
+	const ShaderCacheEntry entry = MakeEntry();
+	std::vector<uint8_t> data = ShaderCache::Serialize(42, entry);
+
+	ShaderCacheEntry loaded;
+	REQUIRE(ShaderCache::Deserialize(data.data(), data.size(), 42, loaded));
+	CHECK(Same(entry, loaded));
+
+	// And through a file
+	ShaderDirectory shaders("roundtrip");
+	ShaderCache cache(shaders.GetPath() / "Cache");
+	CHECK(!cache.Load(42, loaded));
+	REQUIRE(cache.Store(42, entry));
+	ShaderCacheEntry fromFile;
+	REQUIRE(cache.Load(42, fromFile));
+	CHECK(Same(entry, fromFile));
+	CHECK(!cache.Load(43, fromFile));
+
+	// No temporary files left behind
+	size_t files = 0;
+	for (const auto& file : fs::directory_iterator(cache.GetDirectory()))
+		files += file.path().extension() == ".shc" ? 1 : 100;
+	CHECK_EQ(files, (size_t)1);
+}
+
+TEST(TruncatedAndCorruptFilesAreRejected)
+{
+	const ShaderCacheEntry entry = MakeEntry();
+	const std::vector<uint8_t> data = ShaderCache::Serialize(42, entry);
+	ShaderCacheEntry loaded = entry;
+	loaded.Bytecode = {1, 2, 3};
+
+	uint32_t accepted = 0;
+	for (size_t size = 0; size < data.size(); ++size)
+		accepted += ShaderCache::Deserialize(data.data(), size, 42, loaded);
+	CHECK_EQ(accepted, 0u);
+	// A failed load leaves the output alone
+	CHECK(loaded.Bytecode == std::vector<uint8_t>({1, 2, 3}));
+
+	std::vector<uint8_t> longer = data;
+	longer.push_back(0);
+	CHECK(!ShaderCache::Deserialize(longer.data(), longer.size(), 42, loaded));
+
+	// Header: magic, version, key
+	for (size_t offset : {0, 4, 8})
+	{
+		std::vector<uint8_t> corrupt = data;
+		corrupt[offset] ^= 0x01;
+		CHECK(!ShaderCache::Deserialize(corrupt.data(), corrupt.size(), 42, loaded));
+	}
+	CHECK(!ShaderCache::Deserialize(data.data(), data.size(), 43, loaded));
+
+	// A huge count must fail instead of allocating for it
+	std::vector<uint8_t> hugeCount = data;
+	const uint32_t huge = 0xFFFFFFF0u;
+	memcpy(hugeCount.data() + 16, &huge, sizeof(huge)); // Bytecode size
+	CHECK(!ShaderCache::Deserialize(hugeCount.data(), hugeCount.size(), 42, loaded));
+
+	ShaderCacheEntry noBytecode = entry;
+	noBytecode.Bytecode.clear();
+	std::vector<uint8_t> empty = ShaderCache::Serialize(42, noBytecode);
+	CHECK(!ShaderCache::Deserialize(empty.data(), empty.size(), 42, loaded));
+
+	// Same for files on disk, e.g. a copy interrupted halfway
+	ShaderDirectory shaders("corrupt");
+	ShaderCache cache(shaders.GetPath());
+	REQUIRE(cache.Store(42, entry));
+	fs::resize_file(cache.GetEntryPath(42), data.size() / 2);
+	CHECK(!cache.Load(42, loaded));
+	CHECK(loaded.Bytecode == std::vector<uint8_t>({1, 2, 3}));
+}
+
+TEST_MAIN()
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal test registry for the CPU-only parts of the engine (see CMakeLists.txt). Every test
+// file is its own executable; a failed CHECK reports and the test carries on, a failed
+// REQUIRE leaves the test
+struct TestCase
+{
+	const char* Name;
+	std::function<void()> Body;
+};
+
+class TestRegistry
+{
+  public:
+	static TestRegistry& Get()
+	{
+		static TestRegistry registry;
+		return registry;
+	}
+
+	void Add(const char* name, std::function<void()> body)
+	{
+		m_tests.push_back({name, std::move(body)});
+	}
+
+	void Fail(const char* file, int line, const std::string& message)
+	{
+		std::printf("  %s:%d: %s\n", file, line, message.c_str());
+		++m_failures;
+	}
+
+	int Run()
+	{
+		int failedTests = 0;
+		for (const TestCase& test : m_tests)
+		{
+			int failuresBefore = m_failures;
+			test.Body();
+			bool passed = m_failures == failuresBefore;
+			std::printf("[%s] %s\n", passed ? "PASS" : "FAIL", test.Name);
+			if (!passed)
+				++failedTests;
+		}
+		std::printf("%d/%d tests passed\n", (int)m_tests.size() - failedTests, (int)m_tests.size());
+		return failedTests == 0 ? 0 : 1;
+	}
+
+  private:
+	std::vector<TestCase> m_tests;
+	int m_failures = 0;
+};
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, std::function<void()> body)
+	{
+		TestRegistry::Get().Add(name, std::move(body));
+	}
+};
+
+#define TEST_CONCAT_INNER(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_INNER(a, b)
+
+#define TEST(name)                                                                                  \
+	static void name();                                                                             \
+	static TestRegistration TEST_CONCAT(s_registration_, name)(#name, &name);                      \
+	static void name()
+
+#define CHECK(condition)                                                                            \
+	do                                                                                              \
+	{                                                                                               \
+		if (!(condition))                                                                           \
+			TestRegistry::Get().Fail(__FILE__, __LINE__, "CHECK(" #condition ") failed");          \
+	} while (0)
+
+#define CHECK_EQ(actual, expected)                                                                  \
+	do                                                                                              \
+	{                                                                                               \
+		auto testActual = (actual);                                                                 \
+		auto testExpected = (expected);                                                             \
+		if (!(testActual == testExpected))                                                          \
+			TestRegistry::Get().Fail(__FILE__, __LINE__,                                            \
+									 "CHECK_EQ(" #actual ", " #expected ") failed: " +              \
+										 std::to_string(testActual) + " != " + std::to_string(testExpected)); \
+	} while (0)
+
+#define REQUIRE(condition)                                                                          \
+	do                                                                                              \
+	{                                                                                               \
+		if (!(condition))                                                                           \
+		{                                                                                           \
+			TestRegistry::Get().Fail(__FILE__, __LINE__, "REQUIRE(" #condition ") failed");        \
+			return;                                                                                 \
+		}                                                                                           \
+	} while (0)
+
+#define TEST_MAIN()                                                                                 \
+	int main()                                                                                      \
+	{                                                                                               \
+		return TestRegistry::Get().Run();                                                           \
+	}
@@ -0,0 +1,210 @@
+#include "TestFramework.h"
+
+#include <Rendeructor/RendeructorUploadRing.h>
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Drives UploadRing the way BackendDX11 does (allocate, fence at EndFrame, release frames
+	// UploadFramesInFlight behind) over a plain byte array. The fake GPU reads every slice of a
+	// frame when that frame is retired: if the ring handed out space it was still going to
+	// read, the bytes don't match any more.
+	class FakeUploadBackend
+	{
+	  public:
+		static constexpr uint64_t FramesInFlight = 3;
+
+		explicit FakeUploadBackend(uint64_t capacity) : m_ring(capacity), m_buffer(capacity)
+		{
+		}
+
+		// InvalidOffset when in-flight frames hold the space (the backend then discards)
+		uint64_t Allocate(uint64_t size, uint64_t alignment, bool* wrappedOut = nullptr)
+		{
+			bool wrapped = false;
+			uint64_t offset = m_ring.Allocate(size, alignment, wrapped);
+			if (wrappedOut)
+				*wrappedOut = wrapped;
+			if (offset == UploadRing::InvalidOffset)
+				return offset;
+
+			Slice slice{m_frame, offset, std::vector<uint8_t>(size)};
+			for (uint64_t i = 0; i < size; ++i)
+				slice.Bytes[i] = (uint8_t)(m_nextByte++ * 31 + 7);
+			memcpy(m_buffer.data() + offset, slice.Bytes.data(), size);
+			m_slices.push_back(std::move(slice));
+			return offset;
+		}
+
+		void EndFrame()
+		{
+			m_ring.EndFrame(m_frame);
+			if (m_frame >= FramesInFlight)
+			{
+				Execute(m_frame - FramesInFlight);
+				m_ring.ReleaseCompletedFrames(m_frame - FramesInFlight);
+			}
+			++m_frame;
+		}
+
+		// GPU runs every frame up to this one and checks what it reads
+		void Execute(uint64_t lastFrame)
+		{
+			std::vector<Slice> pending;
+			for (Slice& slice : m_slices)
+			{
+				if (slice.Frame > lastFrame)
+				{
+					pending.push_back(std::move(slice));
+					continue;
+				}
+				if (memcmp(m_buffer.data() + slice.Offset, slice.Bytes.data(), slice.Bytes.size()) != 0)
+					++m_corrupted;
+			}
+			m_slices = std::move(pending);
+		}
+
+		UploadRing& GetRing()
+		{
+			return m_ring;
+		}
+		uint64_t GetFrame() const
+		{
+			return m_frame;
+		}
+		uint32_t GetCorrupted() const
+		{
+			return m_corrupted;
+		}
+
+	  private:
+		struct Slice
+		{
+			uint64_t Frame;
+			uint64_t Offset;
+			std::vector<uint8_t> Bytes;
+		};
+
+		UploadRing m_ring;
+		std::vector<uint8_t> m_buffer;
+		std::vector<Slice> m_slices;
+		uint64_t m_frame = 0;
+		uint32_t m_nextByte = 0;
+		uint32_t m_corrupted = 0;
+	};
+}
+
+TEST(OffsetsAreAligned)
+{
+	UploadRing ring(4096);
+	bool wrapped = false;
+	CHECK_EQ(ring.Allocate(3, 1, wrapped), 0ull);
+	CHECK_EQ(ring.Allocate(16, 256, wrapped), 256ull);
+	CHECK_EQ(ring.Allocate(5, 16, wrapped), 272ull);
+	CHECK_EQ(ring.Allocate(1, 0, wrapped), 277ull); // 0 = no alignment
+	CHECK(!wrapped);
+	// The padding counts as used
+	CHECK_EQ(ring.GetUsedBytes(), 278ull);
+}
+
+TEST(WrapsToZeroWhenTheTailDoesNotFit)
+{
+	FakeUploadBackend backend(1024);
+	bool wrapped = false;
+	CHECK_EQ(backend.Allocate(600, 16, &wrapped), 0ull);
+	for (uint64_t i = 0; i <= FakeUploadBackend::FramesInFlight; ++i)
+		backend.EndFrame(); // Frame 0 retired
+
+	CHECK_EQ(backend.Allocate(300, 16, &wrapped), 608ull);
+	CHECK(!wrapped);
+	// 116 bytes left before the end: not enough, starts over at 0 and skips them
+	CHECK_EQ(backend.Allocate(200, 16, &wrapped), 0ull);
+	CHECK(wrapped);
+	CHECK_EQ(backend.GetRing().GetUsedBytes(), 8ull + 300ull + 116ull + 200ull); // From the tail at 600
+	// Exactly to the end doesn't wrap
+	UploadRing exact(256);
+	CHECK_EQ(exact.Allocate(192, 64, wrapped), 0ull);
+	CHECK_EQ(exact.Allocate(64, 64, wrapped), 192ull);
+	CHECK(!wrapped);
+}
+
+TEST(SpaceIsHeldUntilTheFencedFrameIsRetired)
+{
+	FakeUploadBackend backend(1024);
+	CHECK(backend.Allocate(1024, 1) != UploadRing::InvalidOffset);
+	backend.EndFrame(); // Frame 0 fenced, the GPU may still read it
+
+	for (uint64_t frame = 1; frame <= FakeUploadBackend::FramesInFlight; ++frame)
+	{
+		CHECK_EQ(backend.Allocate(1, 1), UploadRing::InvalidOffset);
+		CHECK_EQ(backend.GetRing().GetUsedBytes(), 1024ull);
+		backend.EndFrame();
+	}
+
+	// EndFrame of frame 3 retired frame 0
+	CHECK_EQ(backend.GetRing().GetUsedBytes(), 0ull);
+	CHECK_EQ(backend.Allocate(1024, 1), 0ull);
+	CHECK_EQ(backend.GetCorrupted(), 0u);
+}
+
+TEST(EarlierSlicesOfTheFrameSurviveAWrap)
+{
+	FakeUploadBackend backend(1024);
+	CHECK_EQ(backend.Allocate(512, 1), 0ull);
+	for (uint64_t i = 0; i <= FakeUploadBackend::FramesInFlight; ++i)
+		backend.EndFrame();
+
+	// One frame: two slices up to the end, then a wrap into the retired space of frame 0
+	CHECK_EQ(backend.Allocate(256, 1), 512ull);
+	CHECK_EQ(backend.Allocate(200, 1), 768ull);
+	bool wrapped = false;
+	CHECK_EQ(backend.Allocate(400, 1, &wrapped), 0ull);
+	CHECK(wrapped);
+	// The next wrap can't reach the slices at 512.. of this frame
+	CHECK_EQ(backend.Allocate(200, 1), UploadRing::InvalidOffset);
+	CHECK_EQ(backend.Allocate(112, 1), 400ull);
+
+	for (uint64_t i = 0; i <= FakeUploadBackend::FramesInFlight; ++i)
+		backend.EndFrame();
+	CHECK_EQ(backend.GetCorrupted(), 0u);
+}
+
+TEST(SteadyStreamNeverOverwritesFramesInFlight)
+{
+	// Odd sizes and alignments so the wraps land everywhere
+	FakeUploadBackend backend(96 * 1024);
+	uint32_t failed = 0, wraps = 0;
+	uint64_t sizes[] = {48, 256, 1000, 64, 4096, 16, 777};
+	uint64_t alignments[] = {16, 256, 4, 16, 256, 1, 64};
+	for (int frame = 0; frame < 500; ++frame)
+	{
+		for (int i = 0; i < 20; ++i)
+		{
+			bool wrapped = false;
+			if (backend.Allocate(sizes[(frame + i) % 7], alignments[i % 7], &wrapped) == UploadRing::InvalidOffset)
+				++failed;
+			wraps += wrapped;
+		}
+		backend.EndFrame();
+	}
+	backend.Execute(backend.GetFrame());
+
+	// ~19 KB a frame with 4 frames alive fits in 96 KB
+	CHECK_EQ(failed, 0u);
+	CHECK(wraps > 50);
+	CHECK_EQ(backend.GetCorrupted(), 0u);
+}
+
+TEST(OversizedAndEmptyAllocationsFail)
+{
+	UploadRing ring(128);
+	bool wrapped = true;
+	CHECK_EQ(ring.Allocate(129, 1, wrapped), UploadRing::InvalidOffset);
+	CHECK(!wrapped);
+	CHECK_EQ(ring.Allocate(0, 1, wrapped), UploadRing::InvalidOffset);
+	CHECK_EQ(ring.GetUsedBytes(), 0ull);
+}
+
+TEST_MAIN()
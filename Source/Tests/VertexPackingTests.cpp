@@ -0,0 +1,196 @@
+#include "TestFramework.h"
+
+#include <Rendeructor/RendeructorVertexPacking.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace
+{
+	// Angle between two directions in degrees, stable for tiny angles
+	double AngleDegrees(const float a[3], const double b[3])
+	{
+		double cross[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+		double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+		double cosine = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+		return std::atan2(sine, cosine) * 180.0 / 3.14159265358979323846;
+	}
+
+	double MaxOctError(const float v[3])
+	{
+		double length = std::sqrt((double)v[0] * v[0] + (double)v[1] * v[1] + (double)v[2] * v[2]);
+		double unit[3] = {v[0] / length, v[1] / length, v[2] / length};
+		int16_t encoded[2];
+		float decoded[3];
+		VertexPacking::OctEncode(v, encoded);
+		VertexPacking::OctDecode(encoded, decoded);
+		return AngleDegrees(decoded, unit);
+	}
+
+	bool IsHalfNaN(uint16_t half)
+	{
+		return (half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0;
+	}
+}
+
+TEST(PositionsAreOffByAtMostHalfAStep)
+{
+	const float boundsMin[3] = {-12.5f, 0.0f, 100.0f};
+	const float boundsMax[3] = {37.5f, 0.001f, 100.0f}; // Last axis is flat
+	PositionQuantization quantization = VertexPacking::QuantizationFromBounds(boundsMin, boundsMax);
+	CHECK_EQ(quantization.Scale[2], 0.0f);
+
+	std::mt19937 random(42);
+	const float normal[3] = {0.0f, 0.0f, 1.0f}, tangent[3] = {1.0f, 0.0f, 0.0f}, uv[2] = {0.0f, 0.0f};
+	double worst[3] = {};
+	for (int i = 0; i < 100000; ++i)
+	{
+		float position[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			// Corners first, then random points inside the bounds
+			float t = i < 8 ? (float)((i >> axis) & 1) : std::uniform_real_distribution<float>(0.0f, 1.0f)(random);
+			position[axis] = boundsMin[axis] + (boundsMax[axis] - boundsMin[axis]) * t;
+		}
+
+		CompactVertex vertex = VertexPacking::Pack(position, normal, tangent, 1.0f, uv, quantization);
+		float unpacked[3], n[3], t[3], sign, unpackedUV[2];
+		VertexPacking::Unpack(vertex, quantization, unpacked, n, t, sign, unpackedUV);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			// Half a step, plus the float rounding of Offset + snorm * Scale
+			double step = quantization.Scale[axis] / 32767.0;
+			double slack = 2.0 * std::numeric_limits<float>::epsilon() * (std::fabs(quantization.Offset[axis]) + quantization.Scale[axis]);
+			double error = std::fabs((double)unpacked[axis] - position[axis]);
+			CHECK(error <= 0.5 * step + slack);
+			worst[axis] = std::max(worst[axis], step > 0.0 ? error / step : error);
+		}
+	}
+	std::printf("  worst position error: %.3f, %.3f steps, flat axis %g\n", worst[0], worst[1], worst[2]);
+	CHECK_EQ(worst[2], 0.0);
+}
+
+TEST(UnpackReturnsWhatPackStored)
+{
+	const float boundsMin[3] = {-1.0f, -1.0f, -1.0f}, boundsMax[3] = {1.0f, 1.0f, 1.0f};
+	PositionQuantization quantization = VertexPacking::QuantizationFromBounds(boundsMin, boundsMax);
+	const float position[3] = {0.25f, -0.5f, 0.75f};
+	const float normal[3] = {0.0f, 1.0f, 0.0f}, tangent[3] = {0.0f, 0.0f, -1.0f};
+	const float uv[2] = {0.3f, 1.75f};
+
+	for (float bitangentSign : {1.0f, -1.0f})
+	{
+		CompactVertex vertex = VertexPacking::Pack(position, normal, tangent, bitangentSign, uv, quantization);
+		float p[3], n[3], t[3], sign, unpackedUV[2];
+		VertexPacking::Unpack(vertex, quantization, p, n, t, sign, unpackedUV);
+
+		CHECK_EQ(sign, bitangentSign);
+		CHECK(std::fabs(n[1] - 1.0f) < 1e-6f);
+		CHECK(std::fabs(t[2] + 1.0f) < 1e-6f);
+		// 11 significant bits: relative error at most 2^-11 (half an ulp of 10 stored bits)
+		for (int i = 0; i < 2; ++i)
+			CHECK(std::fabs(unpackedUV[i] - uv[i]) <= std::fabs(uv[i]) * (1.0f / 2048.0f));
+	}
+}
+
+TEST(OctahedralErrorIsBelowTheDocumentedBound)
+{
+	const double bound = 0.04;
+	double worst = 0.0;
+
+	// Axes, diagonals and the folded seams, where the encoding is least regular
+	const float special[][3] = {
+		{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+		{1, 1, 0}, {1, -1, 0}, {-1, 1, 0}, {-1, -1, 0}, {1, 1, 1}, {-1, -1, -1},
+		{1, 0, -1}, {0, -1, -1}, {0.5f, -0.5f, -1e-7f}, {1e-7f, 1e-7f, -1},
+	};
+	for (const auto& v : special)
+		worst = std::max(worst, MaxOctError(v));
+
+	std::mt19937 random(7);
+	std::normal_distribution<float> gaussian;
+	for (int i = 0; i < 500000; ++i)
+	{
+		float v[3] = {gaussian(random), gaussian(random), gaussian(random)};
+		// Unnormalized input is fine too, only the direction is kept
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) * (i % 2 ? 1.0f : 0.1f);
+		if (length < 1e-6f)
+			continue;
+		for (float& c : v)
+			c /= length;
+		worst = std::max(worst, MaxOctError(v));
+	}
+	std::printf("  worst octahedral error: %.5f degrees\n", worst);
+	CHECK(worst < bound);
+}
+
+TEST(ZeroVectorEncodesAsPlusZ)
+{
+	const float zero[3] = {0.0f, 0.0f, 0.0f};
+	int16_t encoded[2] = {1, 1};
+	VertexPacking::OctEncode(zero, encoded);
+	CHECK_EQ(encoded[0], (int16_t)0);
+	CHECK_EQ(encoded[1], (int16_t)0);
+	float decoded[3];
+	VertexPacking::OctDecode(encoded, decoded);
+	CHECK_EQ(decoded[2], 1.0f);
+}
+
+TEST(EveryHalfRoundTrips)
+{
+	uint32_t mismatches = 0;
+	for (uint32_t half = 0; half <= 0xFFFF; ++half)
+	{
+		float value = VertexPacking::FromHalf((uint16_t)half);
+		uint16_t again = VertexPacking::ToHalf(value);
+		if (IsHalfNaN((uint16_t)half))
+		{
+			if (!std::isnan(value) || !IsHalfNaN(again))
+				++mismatches;
+		}
+		else if (again != half)
+			++mismatches;
+	}
+	CHECK_EQ(mismatches, 0u);
+}
+
+TEST(ToHalfRoundsToNearestEven)
+{
+	// Ties go to the even mantissa
+	CHECK_EQ(VertexPacking::ToHalf(1.0f + 1.0f / 2048.0f), (uint16_t)0x3C00);
+	CHECK_EQ(VertexPacking::ToHalf(1.0f + 3.0f / 2048.0f), (uint16_t)0x3C02);
+	CHECK_EQ(VertexPacking::ToHalf(std::ldexp(1.0f, -25)), (uint16_t)0x0000);
+	CHECK_EQ(VertexPacking::ToHalf(std::ldexp(3.0f, -25)), (uint16_t)0x0002);
+	// Range ends: largest half, first value that overflows, smallest normal and subnormal
+	CHECK_EQ(VertexPacking::ToHalf(65504.0f), (uint16_t)0x7BFF);
+	CHECK_EQ(VertexPacking::ToHalf(65519.99f), (uint16_t)0x7BFF);
+	CHECK_EQ(VertexPacking::ToHalf(65520.0f), (uint16_t)0x7C00);
+	CHECK_EQ(VertexPacking::ToHalf(-1e10f), (uint16_t)0xFC00);
+	CHECK_EQ(VertexPacking::ToHalf(std::ldexp(1.0f, -14)), (uint16_t)0x0400);
+	CHECK_EQ(VertexPacking::ToHalf(std::ldexp(1.0f, -24)), (uint16_t)0x0001);
+	CHECK_EQ(VertexPacking::ToHalf(-0.0f), (uint16_t)0x8000);
+	CHECK(IsHalfNaN(VertexPacking::ToHalf(std::numeric_limits<float>::quiet_NaN())));
+
+	// Any float in range: no other half is closer, and on a tie the result is even
+	std::mt19937 random(3);
+	uint32_t wrong = 0;
+	for (int i = 0; i < 200000; ++i)
+	{
+		float value = std::ldexp(std::uniform_real_distribution<float>(-1.0f, 1.0f)(random), (int)(random() % 42) - 25);
+		uint16_t half = VertexPacking::ToHalf(value);
+		double error = std::fabs((double)VertexPacking::FromHalf(half) - value);
+		for (int step : {-1, 1})
+		{
+			uint16_t neighbour = (uint16_t)(half + step);
+			if ((neighbour & 0x7FFF) >= 0x7C00 || (neighbour & 0x8000) != (half & 0x8000))
+				continue;
+			double other = std::fabs((double)VertexPacking::FromHalf(neighbour) - value);
+			if (other < error || (other == error && (half & 1)))
+				++wrong;
+		}
+	}
+	CHECK_EQ(wrong, 0u);
+}
+
+TEST_MAIN()
@@ -2,6 +2,8 @@
 #include "Log.h"
 #include "BackendDX11.h"
 #include "Rendeructor.h"
+#include "RendeructorVertexPacking.h"
+#include <atomic>
 #include <cstdio>
 #include <string>
 #include <vector>
@@ -11,7 +13,74 @@ struct SimpleVertex {
     float u, v;
 };
 
+// Формат цветной текстуры и размер пикселя (для шага строки при загрузке)
+static DXGI_FORMAT GetColorFormat(int format, int& bytesPerPixel) {
+    switch ((TextureFormat)format) {
+    case TextureFormat::RGBA16F:
+        bytesPerPixel = 8;
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case TextureFormat::R16F:
+        bytesPerPixel = 2;
+        return DXGI_FORMAT_R16_FLOAT;
+    case TextureFormat::R32F:
+        bytesPerPixel = 4;
+        return DXGI_FORMAT_R32_FLOAT;
+    case TextureFormat::RGBA32F:
+        bytesPerPixel = 16;
+        return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case TextureFormat::BGRA8:
+        bytesPerPixel = 4;
+        return DXGI_FORMAT_B8G8R8A8_UNORM;
+    case TextureFormat::BGRX8:
+        bytesPerPixel = 4;
+        return DXGI_FORMAT_B8G8R8X8_UNORM;
+    // Сжатые форматы: bytesPerPixel - байт на блок 4x4
+    case TextureFormat::BC1:
+        bytesPerPixel = 8;
+        return DXGI_FORMAT_BC1_UNORM;
+    case TextureFormat::BC2:
+        bytesPerPixel = 16;
+        return DXGI_FORMAT_BC2_UNORM;
+    case TextureFormat::BC3:
+        bytesPerPixel = 16;
+        return DXGI_FORMAT_BC3_UNORM;
+    case TextureFormat::BC4:
+        bytesPerPixel = 8;
+        return DXGI_FORMAT_BC4_UNORM;
+    case TextureFormat::BC5:
+        bytesPerPixel = 16;
+        return DXGI_FORMAT_BC5_UNORM;
+    case TextureFormat::BC6H:
+        bytesPerPixel = 16;
+        return DXGI_FORMAT_BC6H_UF16;
+    case TextureFormat::BC7:
+        bytesPerPixel = 16;
+        return DXGI_FORMAT_BC7_UNORM;
+    default:
+        bytesPerPixel = 4;
+        return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+// Шаг строки уровня ширины width: строка пикселей или строка блоков 4x4 у сжатых
+static UINT GetRowPitch(int format, int width) {
+    int bytesPerElement = 4;
+    GetColorFormat(format, bytesPerElement);
+    if ((TextureFormat)format >= TextureFormat::BC1 && (TextureFormat)format <= TextureFormat::BC7) {
+        return (UINT)((width + 3) / 4 * bytesPerElement);
+    }
+    return (UINT)(width * bytesPerElement);
+}
+
+// Каждый экземпляр бэкенда (и каждый Shutdown) получает свое поколение программ,
+// чтобы ShaderPass не использовал индекс, выданный предыдущим
+static uint32_t NextProgramGeneration() {
+    static std::atomic<uint32_t> s_generation = 0;
+    return ++s_generation;
+}
+
 BackendDX11::BackendDX11() {
+    m_programGeneration = NextProgramGeneration();
     LogDebug("[BackendDX11] Constructor called.");
 }
 
@@ -31,6 +100,10 @@ bool BackendDX11::Initialize(const BackendConfig& config) {
     m_screenWidth = config.Width;
     m_screenHeight = config.Height;
 
+    char modulePath[MAX_PATH] = {};
+    GetModuleFileNameA(nullptr, modulePath, MAX_PATH);
+    m_shaderDiskCache.SetDirectory(std::filesystem::path(modulePath).parent_path() / "ShaderCache");
+
     if (!InitD3D(config)) {
         LogDebug("[BackendDX11] Error: InitD3D failed.");
         return false;
@@ -114,6 +187,7 @@ bool BackendDX11::InitD3D(const BackendConfig& config) {
     if (FAILED(hr)) { LogDebug("Failed to create Rasterizer State"); return false; }
 
     m_context->RSSetState(m_rasterizerState.Get());
+    ResetBindingState();
 
     // --- Создаем Depth Stencil State ---
     D3D11_DEPTH_STENCIL_DESC dsdSetup = {};
@@ -321,12 +395,26 @@ void BackendDX11::CreateDepthResources(int width, int height) {
 
 void BackendDX11::Shutdown() {
     LogDebug("[BackendDX11] Shutdown called.");
+    // Воркеры пишут в дисковый кэш шейдеров, останавливаем их первыми
+    m_compileQueue.Stop();
+    m_pendingVariantCount = 0;
+    m_fallbackPass = nullptr;
+    m_activeShader = nullptr;
+    m_activePassPending = false;
     m_depthCache.clear();
-    for (auto* t : m_textures) delete t;
-    m_textures.clear();
-    for (auto* s : m_samplers) delete s;
-    m_samplers.clear();
-    m_shaderCache.clear();
+    m_textures.Clear();
+    m_buffers.Clear();
+    m_samplers.Clear();
+    m_uploadBuffer = BufferHandle();
+    m_uploadRing.Reset(0);
+    // Проходы, закэшировавшие индексы программ, перерезолвятся по новому поколению
+    m_programs.clear();
+    m_programIds.clear();
+    m_programGeneration = NextProgramGeneration();
+    m_constants.Clear();
+    ResetBindingState();
+    memset(m_bindState.RenderTargets, 0, sizeof(m_bindState.RenderTargets));
+    m_bindState.DepthTarget = nullptr;
 }
 
 void BackendDX11::Resize(int width, int height) {
@@ -350,13 +438,59 @@ void BackendDX11::BeginFrame() {}
 
 void BackendDX11::EndFrame() {
     if (m_swapChain) m_swapChain->Present(1, 0);
+
+    m_frameStats.ShaderPassesPending = m_pendingVariantCount;
+    m_lastFrameStats = m_frameStats;
+    m_frameStats = BackendFrameStats();
+
+    // Шейдеры, скомпилированные в фоне, появляются только между кадрами
+    InstallCompiledShaders();
+    // Контекст могли трогать в обход нас (например, ImGui), поэтому кэш привязок живет один кадр
+    ResetBindingState();
+
+    // Все, что выделено из кольца в этом кадре, освободится через UploadFramesInFlight кадров
+    m_uploadRing.EndFrame(m_frameIndex);
+    if (m_frameIndex >= UploadFramesInFlight) {
+        m_uploadRing.ReleaseCompletedFrames(m_frameIndex - UploadFramesInFlight);
+    }
+
+    // Автоматические буферы глубины под размеры, в которые давно не рисовали, освобождаем.
+    // D3D11 сам держит ресурс, пока GPU его использует
+    for (auto it = m_depthCache.begin(); it != m_depthCache.end();) {
+        if (m_frameIndex - it->second.LastUsedFrame > DepthCacheKeepFrames && it->second.DSV.Get() != m_currentDSV) {
+            LogDebug("[BackendDX11] Releasing unused auto-depth buffer %dx%d", (int)(it->first >> 32), (int)(it->first & 0xFFFFFFFF));
+            it = m_depthCache.erase(it);
+        }
+        else ++it;
+    }
+
+    // Отложенное удаление: ресурсы, чей срок подошел, освобождаются после Present
+    ++m_frameIndex;
+    m_textures.CollectGarbage(m_frameIndex);
+    m_buffers.CollectGarbage(m_frameIndex);
+    m_samplers.CollectGarbage(m_frameIndex);
 }
 
-void* BackendDX11::CreateTextureResource(int width, int height, int format, const void* initialData) {
-    auto* wrapper = new DX11TextureWrapper();
-    wrapper->Width = width;
-    wrapper->Height = height;
-    wrapper->Type = TextureType::Tex2D;
+void BackendDX11::DestroyTexture(TextureHandle handle, uint32_t framesToWait) {
+    if (framesToWait == 0) m_textures.Release(handle);
+    else m_textures.ReleaseDeferred(handle, m_frameIndex + framesToWait);
+}
+
+void BackendDX11::DestroyBuffer(BufferHandle handle, uint32_t framesToWait) {
+    if (framesToWait == 0) m_buffers.Release(handle);
+    else m_buffers.ReleaseDeferred(handle, m_frameIndex + framesToWait);
+}
+
+void BackendDX11::DestroySampler(SamplerHandle handle, uint32_t framesToWait) {
+    if (framesToWait == 0) m_samplers.Release(handle);
+    else m_samplers.ReleaseDeferred(handle, m_frameIndex + framesToWait);
+}
+
+TextureHandle BackendDX11::CreateTextureResource(int width, int height, int format, const void* initialData) {
+    DX11TextureWrapper wrapper = {};
+    wrapper.Width = width;
+    wrapper.Height = height;
+    wrapper.Type = TextureType::Tex2D;
 
     D3D11_TEXTURE2D_DESC desc = {};
     desc.Width = width;
@@ -367,26 +501,34 @@ void* BackendDX11::CreateTextureResource(int width, int height, int format, cons
     desc.Usage = D3D11_USAGE_DEFAULT;
     desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
 
+    if ((TextureFormat)format == TextureFormat::Depth24Stencil8) {
+        // Typeless, чтобы один и тот же ресурс был и DSV, и SRV (глубина читается как R24)
+        desc.Format = DXGI_FORMAT_R24G8_TYPELESS;
+        desc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+
+        HRESULT hr = m_device->CreateTexture2D(&desc, nullptr, wrapper.Texture.GetAddressOf());
+        if (FAILED(hr)) {
+            LogDebug("[BackendDX11] Failed create depth texture. Hr: 0x%X", hr);
+            return TextureHandle();
+        }
+
+        D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+        dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+        dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+        m_device->CreateDepthStencilView(wrapper.Texture.Get(), &dsvDesc, wrapper.DSV.GetAddressOf());
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = 1;
+        m_device->CreateShaderResourceView(wrapper.Texture.Get(), &srvDesc, wrapper.SRV.GetAddressOf());
+
+        return m_textures.Allocate(std::move(wrapper));
+    }
+
     // Определяем формат и размер пикселя для загрузки данных
     int bytesPerPixel = 4;
-    switch ((TextureFormat)format) {
-    case TextureFormat::RGBA16F:
-        desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-        bytesPerPixel = 8;
-        break;
-    case TextureFormat::R16F:
-        desc.Format = DXGI_FORMAT_R16_FLOAT;
-        bytesPerPixel = 2;
-        break;
-    case TextureFormat::R32F:
-        desc.Format = DXGI_FORMAT_R32_FLOAT;
-        bytesPerPixel = 4;
-        break;
-    default:
-        desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        bytesPerPixel = 4;
-        break;
-    }
+    desc.Format = GetColorFormat(format, bytesPerPixel);
 
     D3D11_SUBRESOURCE_DATA* pInitData = nullptr;
     D3D11_SUBRESOURCE_DATA initData = {};
@@ -397,26 +539,121 @@ void* BackendDX11::CreateTextureResource(int width, int height, int format, cons
         pInitData = &initData;
     }
 
-    HRESULT hr = m_device->CreateTexture2D(&desc, pInitData, wrapper->Texture.GetAddressOf());
+    HRESULT hr = m_device->CreateTexture2D(&desc, pInitData, wrapper.Texture.GetAddressOf());
 
     if (FAILED(hr)) {
         LogDebug("[BackendDX11] Failed create texture. Hr: 0x%X", hr);
-        delete wrapper;
-        return nullptr;
+        return TextureHandle();
     }
 
-    m_device->CreateShaderResourceView(wrapper->Texture.Get(), nullptr, wrapper->SRV.GetAddressOf());
-    m_device->CreateRenderTargetView(wrapper->Texture.Get(), nullptr, wrapper->RTV.GetAddressOf());
+    m_device->CreateShaderResourceView(wrapper.Texture.Get(), nullptr, wrapper.SRV.GetAddressOf());
+    m_device->CreateRenderTargetView(wrapper.Texture.Get(), nullptr, wrapper.RTV.GetAddressOf());
 
-    m_textures.push_back(wrapper);
-    return wrapper;
+    return m_textures.Allocate(std::move(wrapper));
 }
 
-void* BackendDX11::CreateTextureCubeResource(int width, int height, int format, const void** initialData) {
-    auto* wrapper = new DX11TextureWrapper();
-    wrapper->Width = width;
-    wrapper->Height = height;
-    wrapper->Type = TextureType::TexCube;
+TextureHandle BackendDX11::CreateSampledTexture(int width, int height, int format, const void* const* mipData, int mipCount, bool cube) {
+    if (!mipData || mipCount <= 0) return TextureHandle();
+
+    DX11TextureWrapper wrapper = {};
+    wrapper.Width = width;
+    wrapper.Height = height;
+    wrapper.Type = cube ? TextureType::TexCube : TextureType::Tex2D;
+
+    int bytesPerPixel = 4;
+    int faceCount = cube ? 6 : 1;
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = width;
+    desc.Height = height;
+    desc.MipLevels = mipCount;
+    desc.ArraySize = faceCount;
+    desc.Format = GetColorFormat(format, bytesPerPixel);
+    desc.SampleDesc.Count = 1;
+    // Данные больше не меняются: IMMUTABLE и только SRV, без RENDER_TARGET
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    if (cube) desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+    // Уровни лежат плотно (грань за гранью), шаг строки считается от ширины уровня
+    std::vector<D3D11_SUBRESOURCE_DATA> levels(faceCount * mipCount);
+    for (int face = 0; face < faceCount; ++face) {
+        int levelWidth = width;
+        for (int i = 0; i < mipCount; ++i) {
+            levels[face * mipCount + i].pSysMem = mipData[face * mipCount + i];
+            levels[face * mipCount + i].SysMemPitch = GetRowPitch(format, levelWidth);
+            levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+        }
+    }
+
+    HRESULT hr = m_device->CreateTexture2D(&desc, levels.data(), wrapper.Texture.GetAddressOf());
+    if (FAILED(hr)) {
+        LogDebug("[BackendDX11] Failed create sampled texture. Hr: 0x%X", hr);
+        return TextureHandle();
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = desc.Format;
+    if (cube) {
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+        srvDesc.TextureCube.MipLevels = mipCount;
+    }
+    else {
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = mipCount;
+    }
+    m_device->CreateShaderResourceView(wrapper.Texture.Get(), &srvDesc, wrapper.SRV.GetAddressOf());
+
+    return m_textures.Allocate(std::move(wrapper));
+}
+
+TextureHandle BackendDX11::CreateTextureFromMips(TextureHandle source, int firstMip) {
+    auto* src = m_textures.Get(source);
+    if (!src || !src->Texture || src->Type != TextureType::Tex2D || firstMip < 0) return TextureHandle();
+
+    D3D11_TEXTURE2D_DESC srcDesc;
+    src->Texture->GetDesc(&srcDesc);
+    if ((UINT)firstMip >= srcDesc.MipLevels || srcDesc.ArraySize != 1) return TextureHandle();
+
+    // Копия назначения не может быть IMMUTABLE, поэтому DEFAULT, но так же только SRV
+    D3D11_TEXTURE2D_DESC desc = srcDesc;
+    desc.Width = std::max(1u, srcDesc.Width >> firstMip);
+    desc.Height = std::max(1u, srcDesc.Height >> firstMip);
+    desc.MipLevels = srcDesc.MipLevels - firstMip;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+
+    DX11TextureWrapper wrapper = {};
+    wrapper.Width = (int)desc.Width;
+    wrapper.Height = (int)desc.Height;
+    wrapper.Type = TextureType::Tex2D;
+
+    HRESULT hr = m_device->CreateTexture2D(&desc, nullptr, wrapper.Texture.GetAddressOf());
+    if (FAILED(hr)) {
+        LogDebug("[BackendDX11] Failed create texture from mips. Hr: 0x%X", hr);
+        return TextureHandle();
+    }
+
+    // Уровни копируются на GPU, без чтения файла и без данных на CPU
+    for (UINT mip = 0; mip < desc.MipLevels; ++mip) {
+        m_context->CopySubresourceRegion(wrapper.Texture.Get(), mip, 0, 0, 0, src->Texture.Get(), firstMip + mip, nullptr);
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = desc.Format;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels = desc.MipLevels;
+    m_device->CreateShaderResourceView(wrapper.Texture.Get(), &srvDesc, wrapper.SRV.GetAddressOf());
+
+    return m_textures.Allocate(std::move(wrapper));
+}
+
+TextureHandle BackendDX11::CreateTextureCubeResource(int width, int height, int format, const void** initialData) {
+    DX11TextureWrapper wrapper = {};
+    wrapper.Width = width;
+    wrapper.Height = height;
+    wrapper.Type = TextureType::TexCube;
 
     D3D11_TEXTURE2D_DESC desc = {};
     desc.Width = width;
@@ -441,9 +678,8 @@ void* BackendDX11::CreateTextureCubeResource(int width, int height, int format,
         }
     }
 
-    if (FAILED(m_device->CreateTexture2D(&desc, initialData ? subData : nullptr, wrapper->Texture.GetAddressOf()))) {
-        delete wrapper;
-        return nullptr;
+    if (FAILED(m_device->CreateTexture2D(&desc, initialData ? subData : nullptr, wrapper.Texture.GetAddressOf()))) {
+        return TextureHandle();
     }
 
     // Создание SRV
@@ -453,45 +689,51 @@ void* BackendDX11::CreateTextureCubeResource(int width, int height, int format,
     srvDesc.TextureCube.MostDetailedMip = 0;
     srvDesc.TextureCube.MipLevels = 1;
 
-    if (FAILED(m_device->CreateShaderResourceView(wrapper->Texture.Get(), &srvDesc, wrapper->SRV.GetAddressOf()))) {
-        delete wrapper;
-        return nullptr;
+    if (FAILED(m_device->CreateShaderResourceView(wrapper.Texture.Get(), &srvDesc, wrapper.SRV.GetAddressOf()))) {
+        return TextureHandle();
     }
 
-    m_textures.push_back(wrapper);
-    return wrapper;
+    return m_textures.Allocate(std::move(wrapper));
 }
 
-void BackendDX11::CopyTexture(void* dstHandle, void* srcHandle) {
-    if (!dstHandle || !srcHandle) return;
-    auto* dst = (DX11TextureWrapper*)dstHandle;
-    auto* src = (DX11TextureWrapper*)srcHandle;
+void BackendDX11::CopyTexture(TextureHandle dstHandle, TextureHandle srcHandle) {
+    auto* dst = m_textures.Get(dstHandle);
+    auto* src = m_textures.Get(srcHandle);
+    if (!dst || !src) return;
 
     // Копирует все содержимое (размеры должны совпадать, иначе DX выдаст ошибку в debug layer)
     m_context->CopyResource(dst->Texture.Get(), src->Texture.Get());
 }
 
-void BackendDX11::SetRenderTarget(void* target1, void* target2,
-    void* target3, void* target4) {
+void BackendDX11::SetRenderTarget(TextureHandle target1, TextureHandle target2,
+    TextureHandle target3, TextureHandle target4) {
+    TextureHandle targets[4] = { target1, target2, target3, target4 };
+    SetRenderTargets(targets, 4, TextureHandle());
+}
+
+void BackendDX11::SetRenderTargets(const TextureHandle* targets, int count, TextureHandle depth) {
     // Собираем все ненулевые цели
     ID3D11RenderTargetView* rtvs[4] = { nullptr, nullptr, nullptr, nullptr };
-    int count = 0;
+    ID3D11Resource* resources[4] = { nullptr, nullptr, nullptr, nullptr };
+    int rtvCount = 0;
 
-    auto addTarget = [&](void* handle) {
-        if (handle) {
-            auto* tex = (DX11TextureWrapper*)handle;
+    for (int i = 0; i < count && rtvCount < 4; ++i) {
+        if (auto* tex = m_textures.Get(targets[i])) {
             if (tex->RTV) {
-                rtvs[count++] = tex->RTV.Get();
+                resources[rtvCount] = GetTextureResource(*tex);
+                rtvs[rtvCount++] = tex->RTV.Get();
             }
         }
-    };
-
-    addTarget(target1);
-    addTarget(target2);
-    addTarget(target3);
-    addTarget(target4);
+    }
 
-    SetRenderTargetsInternal(rtvs, count);
+    // Явный буфер глубины; без него берется автоматический по размеру цели
+    auto* depthTex = m_textures.Get(depth);
+    if (depthTex && depthTex->DSV) {
+        SetRenderTargetsInternal(rtvs, resources, rtvCount, depthTex->DSV.Get(), depthTex->Texture.Get());
+    }
+    else {
+        SetRenderTargetsInternal(rtvs, resources, rtvCount);
+    }
 }
 
 // Хелпер для очистки конкретного RTV
@@ -516,6 +758,7 @@ ID3D11DepthStencilView* BackendDX11::GetDepthStencilForSize(int width, int heigh
     uint64_t key = PackSize(width, height);
     auto it = m_depthCache.find(key);
     if (it != m_depthCache.end()) {
+        it->second.LastUsedFrame = m_frameIndex;
         return it->second.DSV.Get();
     }
 
@@ -542,19 +785,38 @@ ID3D11DepthStencilView* BackendDX11::GetDepthStencilForSize(int width, int heigh
     if (FAILED(hr)) return nullptr;
 
     // Сохраняем в кэш
+    item.LastUsedFrame = m_frameIndex;
     m_depthCache[key] = item;
     return item.DSV.Get();
 }
 
-void BackendDX11::SetRenderTargetsInternal(ID3D11RenderTargetView* rtvs[], int count) {
-    UnbindResources();
+void BackendDX11::SetRenderTargetsInternal(ID3D11RenderTargetView* rtvs[], ID3D11Resource* resources[], int count,
+    ID3D11DepthStencilView* depth, ID3D11Texture2D* depthResource) {
+    ID3D11Resource* depthTarget = depthResource;
+    UnbindRenderTargetHazards(resources, count);
+    UnbindRenderTargetHazards(&depthTarget, 1);
+    memset(m_bindState.RenderTargets, 0, sizeof(m_bindState.RenderTargets));
+    for (int i = 0; i < count && i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+        m_bindState.RenderTargets[i] = resources[i];
+    }
+    m_bindState.DepthTarget = depthTarget;
     m_boundRTVs.clear();
 
     ID3D11DepthStencilView* dsvToBind = nullptr;
     int targetW = m_screenWidth;
     int targetH = m_screenHeight;
 
-    if (count > 0 && rtvs[0] != nullptr) {
+    if (depth && (count == 0 || rtvs[0] == nullptr)) {
+        // Только глубина (например, карта теней): размер берем с буфера глубины
+        D3D11_TEXTURE2D_DESC desc;
+        depthResource->GetDesc(&desc);
+        targetW = desc.Width;
+        targetH = desc.Height;
+
+        dsvToBind = depth;
+        m_context->OMSetRenderTargets(0, nullptr, dsvToBind);
+    }
+    else if (count > 0 && rtvs[0] != nullptr) {
         ID3D11Resource* res = nullptr;
         rtvs[0]->GetResource(&res);
         D3D11_TEXTURE2D_DESC desc;
@@ -564,7 +826,7 @@ void BackendDX11::SetRenderTargetsInternal(ID3D11RenderTargetView* rtvs[], int c
         targetW = desc.Width;
         targetH = desc.Height;
 
-        dsvToBind = GetDepthStencilForSize(targetW, targetH);
+        dsvToBind = depth ? depth : GetDepthStencilForSize(targetW, targetH);
 
         m_context->OMSetRenderTargets(count, rtvs, dsvToBind);
 
@@ -606,9 +868,8 @@ void BackendDX11::Clear(float r, float g, float b, float a) {
     }
 }
 
-void BackendDX11::ClearTexture(void* textureHandle, float r, float g, float b, float a) {
-    if (!textureHandle) return;
-    auto* tex = (DX11TextureWrapper*)textureHandle;
+void BackendDX11::ClearTexture(TextureHandle textureHandle, float r, float g, float b, float a) {
+    auto* tex = m_textures.Get(textureHandle);
 
     if (tex && tex->RTV) {
         ClearRTV(tex->RTV.Get(), r, g, b, a);
@@ -621,10 +882,10 @@ void BackendDX11::ClearDepth(float depth, int stencil) {
     }
 }
 
-void* BackendDX11::CreateTexture3DResource(int width, int height, int depth, int format, const void* initialData) {
-    auto* wrapper = new DX11TextureWrapper();
-    wrapper->Width = width; wrapper->Height = height; wrapper->Depth = depth;
-    wrapper->Type = TextureType::Tex3D;
+TextureHandle BackendDX11::CreateTexture3DResource(int width, int height, int depth, int format, const void* initialData) {
+    DX11TextureWrapper wrapper = {};
+    wrapper.Width = width; wrapper.Height = height; wrapper.Depth = depth;
+    wrapper.Type = TextureType::Tex3D;
 
     D3D11_TEXTURE3D_DESC desc = {};
     desc.Width = width; desc.Height = height; desc.Depth = depth;
@@ -639,21 +900,20 @@ void* BackendDX11::CreateTexture3DResource(int width, int height, int depth, int
     initData.SysMemPitch = width * sizeof(float) * 4; // Строка
     initData.SysMemSlicePitch = width * height * sizeof(float) * 4; // Слой
 
-    if (FAILED(m_device->CreateTexture3D(&desc, &initData, wrapper->Texture3D.GetAddressOf()))) {
-        delete wrapper; return nullptr;
+    if (FAILED(m_device->CreateTexture3D(&desc, &initData, wrapper.Texture3D.GetAddressOf()))) {
+        return TextureHandle();
     }
 
     // Создаем SRV
-    if (FAILED(m_device->CreateShaderResourceView(wrapper->Texture3D.Get(), nullptr, wrapper->SRV.GetAddressOf()))) {
-        delete wrapper; return nullptr;
+    if (FAILED(m_device->CreateShaderResourceView(wrapper.Texture3D.Get(), nullptr, wrapper.SRV.GetAddressOf()))) {
+        return TextureHandle();
     }
 
-    m_textures.push_back(wrapper);
-    return wrapper;
+    return m_textures.Allocate(std::move(wrapper));
 }
 
-void* BackendDX11::CreateSamplerResource(const std::string& filterMode) {
-    auto* wrapper = new DX11SamplerWrapper();
+SamplerHandle BackendDX11::CreateSamplerResource(const std::string& filterMode) {
+    DX11SamplerWrapper wrapper;
     D3D11_SAMPLER_DESC desc = {};
     desc.AddressU = desc.AddressV = desc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
     desc.MaxLOD = D3D11_FLOAT32_MAX;
@@ -661,9 +921,8 @@ void* BackendDX11::CreateSamplerResource(const std::string& filterMode) {
     if (filterMode == "Point") desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
     else desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 
-    m_device->CreateSamplerState(&desc, wrapper->State.GetAddressOf());
-    m_samplers.push_back(wrapper);
-    return wrapper;
+    m_device->CreateSamplerState(&desc, wrapper.State.GetAddressOf());
+    return m_samplers.Allocate(std::move(wrapper));
 }
 
 void BackendDX11::InitQuadGeometry() {
@@ -682,22 +941,38 @@ void BackendDX11::InitQuadGeometry() {
     initData.pSysMem = vertices;
     m_device->CreateBuffer(&bd, &initData, m_quadVertexBuffer.GetAddressOf());
 
-    unsigned long indices[] = { 0, 1, 2, 2, 1, 3 };
-    bd.ByteWidth = sizeof(unsigned long) * 6;
+    uint16_t indices[] = { 0, 1, 2, 2, 1, 3 };
+    bd.ByteWidth = sizeof(uint16_t) * 6;
     bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
     initData.pSysMem = indices;
     m_device->CreateBuffer(&bd, &initData, m_quadIndexBuffer.GetAddressOf());
 }
 
-bool BackendDX11::CompileShader(const std::string& path, const std::string& entry, const std::string& profile, ID3DBlob** outBlob) {
-    std::wstring wpath(path.begin(), path.end());
-    ID3DBlob* errorBlob = nullptr;
+bool BackendDX11::CompileShader(const std::string& path, const std::string& entry, const std::string& profile, const ShaderDefines& defines, ShaderCacheEntry& outShader) {
     UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
 #ifdef _DEBUG
     flags |= D3DCOMPILE_DEBUG;
 #endif
 
-    HRESULT hr = D3DCompileFromFile(wpath.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, entry.c_str(), profile.c_str(), flags, 0, outBlob, &errorBlob);
+    // Ключ - хэш исходника со всеми include, точки входа, профиля, флагов и версии компилятора.
+    // Если такой шейдер уже лежит на диске, не нужны ни компиляция, ни рефлексия
+    uint64_t cacheKey = ShaderCache::ComputeKey(path, entry, profile, defines, flags, D3D_COMPILER_VERSION);
+    if (m_shaderDiskCache.Load(cacheKey, outShader)) {
+        LogDebug("[BackendDX11] Shader cache hit: %s:%s (%s)", path.c_str(), entry.c_str(), profile.c_str());
+        return true;
+    }
+
+    std::wstring wpath(path.begin(), path.end());
+    ID3DBlob* blob = nullptr;
+    ID3DBlob* errorBlob = nullptr;
+
+    std::vector<D3D_SHADER_MACRO> macros;
+    for (const auto& define : defines) {
+        macros.push_back({ define.first.c_str(), define.second.c_str() });
+    }
+    macros.push_back({ nullptr, nullptr });
+
+    HRESULT hr = D3DCompileFromFile(wpath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, entry.c_str(), profile.c_str(), flags, 0, &blob, &errorBlob);
     if (FAILED(hr)) {
         if (errorBlob) {
             LogDebug("[Shader Error] %s", (char*)errorBlob->GetBufferPointer());
@@ -708,15 +983,22 @@ bool BackendDX11::CompileShader(const std::string& path, const std::string& entr
         }
         return false;
     }
+    if (errorBlob) errorBlob->Release(); // Предупреждения
+
+    outShader = ShaderCacheEntry();
+    const uint8_t* bytes = (const uint8_t*)blob->GetBufferPointer();
+    outShader.Bytecode.assign(bytes, bytes + blob->GetBufferSize());
+    blob->Release();
+
+    ReflectShader(outShader);
+    m_shaderDiskCache.Store(cacheKey, outShader);
     return true;
 }
 
-DX11ReflectionData BackendDX11::ReflectShader(ID3DBlob* blob) {
-    DX11ReflectionData data;
-
+void BackendDX11::ReflectShader(ShaderCacheEntry& shader) {
     ComPtr<ID3D11ShaderReflection> reflector;
-    if (FAILED(D3DReflect(blob->GetBufferPointer(), blob->GetBufferSize(), IID_ID3D11ShaderReflection, (void**)reflector.GetAddressOf()))) {
-        return data;
+    if (FAILED(D3DReflect(shader.Bytecode.data(), shader.Bytecode.size(), IID_ID3D11ShaderReflection, (void**)reflector.GetAddressOf()))) {
+        return;
     }
 
     D3D11_SHADER_DESC shaderDesc;
@@ -734,20 +1016,20 @@ DX11ReflectionData BackendDX11::ReflectShader(ID3DBlob* blob) {
             cbSlots[name] = bindDesc.BindPoint;
         }
         else if (bindDesc.Type == D3D_SIT_TEXTURE) {
-            data.TextureSlots[name] = bindDesc.BindPoint;
+            shader.TextureSlots.push_back({ name, bindDesc.BindPoint });
         }
         else if (bindDesc.Type == D3D_SIT_SAMPLER) {
-            data.SamplerSlots[name] = bindDesc.BindPoint;
+            shader.SamplerSlots.push_back({ name, bindDesc.BindPoint });
         }
     }
 
-    // 2. Теперь читаем содержимое буферов и создаем наши структуры
+    // 2. Теперь читаем содержимое буферов
     for (UINT i = 0; i < shaderDesc.ConstantBuffers; ++i) {
         ID3D11ShaderReflectionConstantBuffer* cb = reflector->GetConstantBufferByIndex(i);
         D3D11_SHADER_BUFFER_DESC bufferDesc;
         cb->GetDesc(&bufferDesc);
 
-        ReflectedConstantBuffer myCB;
+        ShaderCacheConstantBuffer myCB;
         myCB.Name = bufferDesc.Name;
         myCB.Size = bufferDesc.Size;
 
@@ -764,12 +1046,54 @@ DX11ReflectionData BackendDX11::ReflectShader(ID3DBlob* blob) {
             ID3D11ShaderReflectionVariable* var = cb->GetVariableByIndex(j);
             D3D11_SHADER_VARIABLE_DESC varDesc;
             var->GetDesc(&varDesc);
+            myCB.Variables.push_back({ varDesc.Name, varDesc.StartOffset, varDesc.Size });
+        }
 
-            ConstantBufferVariable v;
-            v.Name = varDesc.Name;
-            v.Offset = varDesc.StartOffset;
-            v.Size = varDesc.Size;
+        shader.ConstantBuffers.push_back(myCB);
+    }
+
+    // 3. Входные параметры вершинного шейдера - из них строится Input Layout
+    if (D3D11_SHVER_GET_TYPE(shaderDesc.Version) == D3D11_SHVER_VERTEX_SHADER) {
+        for (UINT i = 0; i < shaderDesc.InputParameters; i++) {
+            D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+            reflector->GetInputParameterDesc(i, &paramDesc);
+            shader.InputElements.push_back({ paramDesc.SemanticName, paramDesc.SemanticIndex, paramDesc.Mask });
+        }
+    }
+}
+
+DX11ReflectionData BackendDX11::BuildReflection(const ShaderCacheEntry& shader) {
+    DX11ReflectionData data;
+    // Для проверки коллизий хэшей имен констант
+    std::map<uint32_t, std::string> hashedNames;
+
+    for (const auto& slot : shader.TextureSlots) {
+        data.TextureSlots[slot.Name] = slot.Slot;
+    }
+    for (const auto& slot : shader.SamplerSlots) {
+        data.SamplerSlots[slot.Name] = slot.Slot;
+    }
+
+    for (const auto& cb : shader.ConstantBuffers) {
+        ReflectedConstantBuffer myCB;
+        myCB.Name = cb.Name;
+        myCB.Slot = cb.Slot;
+        myCB.Size = cb.Size;
+        myCB.WholeBuffer.NameHash = ConstantId::HashName(myCB.Name);
+        myCB.WholeBuffer.Size = cb.Size;
+        hashedNames[myCB.WholeBuffer.NameHash] = myCB.Name;
+
+        for (const auto& var : cb.Variables) {
+            ConstantBinding v;
+            v.NameHash = ConstantId::HashName(var.Name);
+            v.Offset = var.Offset;
+            v.Size = var.Size;
             myCB.Variables.push_back(v);
+
+            auto inserted = hashedNames.emplace(v.NameHash, var.Name);
+            if (!inserted.second && inserted.first->second != var.Name) {
+                LogDebug("[BackendDX11] ConstantId collision: '%s' and '%s'", inserted.first->second.c_str(), var.Name.c_str());
+            }
         }
 
         data.Buffers.push_back(myCB);
@@ -778,20 +1102,145 @@ DX11ReflectionData BackendDX11::ReflectShader(ID3DBlob* blob) {
     return data;
 }
 
-void BackendDX11::PrepareShaderPass(const ShaderPass& pass) {
-    std::string key = pass.VertexShaderPath + ":" + pass.VertexShaderEntryPoint + "|" + pass.PixelShaderPath + ":" + pass.PixelShaderEntryPoint;
-    if (m_shaderCache.find(key) != m_shaderCache.end()) return;
+DX11CompiledPass& BackendDX11::GetCompiledPass(const ShaderPass& pass) {
+    auto* compiled = static_cast<DX11CompiledPass*>(pass.GetBackendCache().get());
+    if (compiled && compiled->Owner == &pass && compiled->Generation == m_programGeneration && compiled->PassVersion == pass.GetVersion()) {
+        return *compiled;
+    }
 
-    LogDebug("[BackendDX11] Compiling Shader Pass: %s", key.c_str());
+    // Проход новый, изменен или скопирован из другого (копия делит кэш с оригиналом): собираем заново
+    auto fresh = std::make_shared<DX11CompiledPass>();
+    fresh->Owner = &pass;
+    fresh->Generation = m_programGeneration;
+    fresh->PassVersion = pass.GetVersion();
+    fresh->ProgramId = FindOrCreateProgram(pass);
+    pass.SetBackendCache(fresh);
+    return *fresh;
+}
+
+uint32_t BackendDX11::ResolveProgram(const ShaderPass& pass) {
+    return GetCompiledPass(pass).ProgramId;
+}
+
+uint32_t BackendDX11::FindOrCreateProgram(const ShaderPass& pass) {
+    // Строка собирается один раз на проход (и после его изменения), дальше только целые числа
+    std::string key = pass.GetVertexShaderPath() + ":" + pass.GetVertexShaderEntryPoint() + "|" +
+        pass.GetPixelShaderPath() + ":" + pass.GetPixelShaderEntryPoint();
+    for (const auto& define : pass.GetFeatureDefines()) {
+        key += "|" + define;
+    }
 
+    auto it = m_programIds.find(key);
+    if (it != m_programIds.end()) return it->second;
+
+    uint32_t programId = (uint32_t)m_programs.size();
+    m_programIds[key] = programId;
+
+    DX11ShaderProgram program;
+    program.Name = key;
+    program.Source.VertexShaderPath = pass.GetVertexShaderPath();
+    program.Source.VertexShaderEntryPoint = pass.GetVertexShaderEntryPoint();
+    program.Source.PixelShaderPath = pass.GetPixelShaderPath();
+    program.Source.PixelShaderEntryPoint = pass.GetPixelShaderEntryPoint();
+    program.Source.FeatureDefines = pass.GetFeatureDefines();
+    m_programs.push_back(std::move(program));
+    return programId;
+}
+
+const DX11PassBindings* BackendDX11::GetPassBindings(const ShaderPass& pass) {
+    DX11CompiledPass& compiled = GetCompiledPass(pass);
+    ShaderPermutationKey permutation = pass.GetPermutation();
+    if (compiled.Last && compiled.LastPermutation == permutation) return compiled.Last;
+
+    auto it = compiled.Variants.find(permutation);
+    if (it == compiled.Variants.end()) {
+        DX11ShaderProgram& program = m_programs[compiled.ProgramId];
+        auto variant = program.Variants.find(permutation);
+        if (variant == program.Variants.end()) {
+            // Не скомпилировавшийся вариант не ставится в очередь снова, рисуется запасной проход
+            if (!program.Failed.count(permutation)) QueueShaderVariant(compiled.ProgramId, permutation);
+            return nullptr;
+        }
+        it = compiled.Variants.emplace(permutation, BuildPassBindings(pass, variant->second)).first;
+    }
+
+    compiled.Last = &it->second;
+    compiled.LastPermutation = permutation;
+    return compiled.Last;
+}
+
+DX11PassBindings BackendDX11::BuildPassBindings(const ShaderPass& pass, DX11ShaderWrapper& shader) {
+    DX11PassBindings bindings;
+    bindings.Shader = &shader;
+
+    // Поиск по именам в рефлексии - один раз здесь, а не на каждом SetShaderPass
+    const DX11ReflectionData* reflection[2] = { &shader.ReflectionVS, &shader.ReflectionPS };
+    for (int stage = 0; stage < 2; ++stage) {
+        const auto& textureSlots = reflection[stage]->TextureSlots;
+        auto addTexture = [&](const std::string& name, TextureType type, const void* source) {
+            auto slot = textureSlots.find(name);
+            if (slot != textureSlots.end()) bindings.Textures[stage].push_back({ slot->second, type, source });
+        };
+
+        for (const auto& tex : pass.GetTextures()) addTexture(tex.first, TextureType::Tex2D, tex.second);
+        for (const auto& tex : pass.GetTextures3D()) addTexture(tex.first, TextureType::Tex3D, tex.second);
+        for (const auto& tex : pass.GetTexturesCube()) addTexture(tex.first, TextureType::TexCube, tex.second);
+
+        const auto& samplerSlots = reflection[stage]->SamplerSlots;
+        for (const auto& smp : pass.GetSamplers()) {
+            auto slot = samplerSlots.find(smp.first);
+            if (slot != samplerSlots.end()) bindings.Samplers[stage].push_back({ slot->second, smp.second });
+        }
+    }
+
+    return bindings;
+}
+
+TextureHandle BackendDX11::GetBindingHandle(const DX11TextureBinding& binding) {
+    switch (binding.Type) {
+    case TextureType::Tex3D:
+        return static_cast<const Texture3D*>(binding.Source)->GetHandle();
+    case TextureType::TexCube:
+        return static_cast<const TextureCube*>(binding.Source)->GetHandle();
+    default:
+        return static_cast<const Texture*>(binding.Source)->GetHandle();
+    }
+}
+
+CompiledShaderPass BackendDX11::CompileShaderPass(const DX11ShaderSource& source, ShaderPermutationKey permutation) {
+    ShaderDefines defines;
+    for (size_t i = 0; i < source.FeatureDefines.size(); ++i) {
+        if (permutation & (1u << i)) defines.push_back({ source.FeatureDefines[i], "1" });
+    }
+
+    CompiledShaderPass compiled;
+    compiled.Permutation = permutation;
+    compiled.HasVS = CompileShader(source.VertexShaderPath, source.VertexShaderEntryPoint, "vs_5_0", defines, compiled.VS);
+    compiled.HasPS = CompileShader(source.PixelShaderPath, source.PixelShaderEntryPoint, "ps_5_0", defines, compiled.PS);
+    return compiled;
+}
+
+void BackendDX11::InstallShaderPass(DX11ShaderProgram& program, const CompiledShaderPass& compiled) {
     DX11ShaderWrapper sw;
-    ID3DBlob* vsBlob = nullptr;
-    ID3DBlob* psBlob = nullptr;
+
+    // Вариант без одного из шейдеров не ставится: иначе проход считался бы готовым
+    // и рисовал с пустым VS/PS вместо запасного прохода
+    bool created = compiled.HasVS && compiled.HasPS;
+    if (created) {
+        created = SUCCEEDED(m_device->CreateVertexShader(compiled.VS.Bytecode.data(), compiled.VS.Bytecode.size(), nullptr, sw.VertexShader.GetAddressOf())) &&
+            SUCCEEDED(m_device->CreatePixelShader(compiled.PS.Bytecode.data(), compiled.PS.Bytecode.size(), nullptr, sw.PixelShader.GetAddressOf()));
+    }
+    if (!created) {
+        LogDebug("[BackendDX11] Error: Shader Pass %s [%08X] failed to compile (VS: %s, PS: %s), drawing with the fallback pass",
+            program.Name.c_str(), compiled.Permutation, compiled.HasVS ? "ok" : "failed", compiled.HasPS ? "ok" : "failed");
+        program.Failed.insert(compiled.Permutation);
+        return;
+    }
 
     // --- VERTEX SHADER ---
-    if (CompileShader(pass.VertexShaderPath, pass.VertexShaderEntryPoint, "vs_5_0", &vsBlob)) {
-        m_device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, sw.VertexShader.GetAddressOf());
-        sw.ReflectionVS = ReflectShader(vsBlob);
+    {
+        const ShaderCacheEntry& vs = compiled.VS;
+        sw.ReflectionVS = BuildReflection(vs);
 
         // Создаем буферы для VS
         for (auto& cb : sw.ReflectionVS.Buffers) {
@@ -804,16 +1253,15 @@ void BackendDX11::PrepareShaderPass(const ShaderPass& pass) {
             cb.ShadowData.resize(bd.ByteWidth, 0);
         }
 
-        std::vector<char> bytecode((char*)vsBlob->GetBufferPointer(), (char*)vsBlob->GetBufferPointer() + vsBlob->GetBufferSize());
-        CreateInputLayoutFromShader(bytecode, sw.InputLayout.GetAddressOf());
-
-        vsBlob->Release();
+        for (int layout = 0; layout < VertexLayoutCount; ++layout) {
+            CreateInputLayoutFromShader(vs, (VertexLayout)layout, sw.InputLayouts[layout].GetAddressOf());
+        }
     }
 
     // --- PIXEL SHADER ---
-    if (CompileShader(pass.PixelShaderPath, pass.PixelShaderEntryPoint, "ps_5_0", &psBlob)) {
-        m_device->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, sw.PixelShader.GetAddressOf());
-        sw.ReflectionPS = ReflectShader(psBlob);
+    {
+        const ShaderCacheEntry& ps = compiled.PS;
+        sw.ReflectionPS = BuildReflection(ps);
 
         for (auto& cb : sw.ReflectionPS.Buffers) {
             D3D11_BUFFER_DESC bd = {};
@@ -824,211 +1272,403 @@ void BackendDX11::PrepareShaderPass(const ShaderPass& pass) {
             m_device->CreateBuffer(&bd, nullptr, cb.HardwareBuffer.GetAddressOf());
             cb.ShadowData.resize(bd.ByteWidth, 0);
         }
-
-        psBlob->Release();
     }
 
-    m_shaderCache[key] = sw;
+    program.Variants[compiled.Permutation] = sw;
 }
 
-void BackendDX11::SetShaderPass(const ShaderPass& pass) {
-    // 1. Генерируем ключ для поиска в кэше
-    std::string key = pass.VertexShaderPath + ":" + pass.VertexShaderEntryPoint + "|" +
-        pass.PixelShaderPath + ":" + pass.PixelShaderEntryPoint;
+void BackendDX11::PrepareShaderPass(const ShaderPass& pass) {
+    DX11ShaderProgram& program = m_programs[ResolveProgram(pass)];
+    ShaderPermutationKey permutation = pass.GetPermutation();
+    if (program.Variants.find(permutation) != program.Variants.end() || program.Failed.count(permutation)) return;
 
-    // Если шейдер не скомпилирован или не найден — выходим
-    if (m_shaderCache.find(key) == m_shaderCache.end()) return;
+    // Если вариант уже компилируется в фоне, фоновый результат потом просто отбросится
+    LogDebug("[BackendDX11] Compiling Shader Pass: %s [%08X]", program.Name.c_str(), permutation);
+    InstallShaderPass(program, CompileShaderPass(program.Source, permutation));
+}
 
-    // Устанавливаем активный шейдер
-    m_activeShader = &m_shaderCache[key];
+void BackendDX11::PrepareShaderPassAsync(const ShaderPass& pass) {
+    uint32_t programId = ResolveProgram(pass);
+    QueueShaderVariant(programId, pass.GetPermutation());
+}
 
-    // 2. Устанавливаем пайплайн (InputLayout, VS, PS)
-    m_context->IASetInputLayout(m_activeShader->InputLayout.Get());
-    m_context->VSSetShader(m_activeShader->VertexShader.Get(), nullptr, 0);
-    m_context->PSSetShader(m_activeShader->PixelShader.Get(), nullptr, 0);
-
-    // 3. Привязка 2D Текстур по имени (используя данные рефлексии)
-    for (const auto& texPair : pass.GetTextures()) {
-        const std::string& name = texPair.first;
-        const Texture* texturePtr = texPair.second;
-
-        // Получаем внутренний хендл
-        auto* tex = (DX11TextureWrapper*)texturePtr->GetHandle();
-
-        if (tex) {
-            // Если текстура используется в Pixel Shader
-            if (m_activeShader->ReflectionPS.TextureSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionPS.TextureSlots[name];
-                m_context->PSSetShaderResources(slot, 1, tex->SRV.GetAddressOf());
-            }
-            // Если текстура используется в Vertex Shader
-            if (m_activeShader->ReflectionVS.TextureSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionVS.TextureSlots[name];
-                m_context->VSSetShaderResources(slot, 1, tex->SRV.GetAddressOf());
-            }
-        }
+void BackendDX11::PrepareShaderVariants(const ShaderPass& pass, bool immediate) {
+    uint32_t programId = ResolveProgram(pass);
+    QueueShaderVariant(programId, pass.GetPermutation());
+    for (ShaderPermutationKey permutation : pass.GetDeclaredVariants()) {
+        QueueShaderVariant(programId, permutation);
     }
 
-    // 4. Привязка 3D Текстур по имени
-    for (const auto& tex3DPair : pass.GetTextures3D()) {
-        const std::string& name = tex3DPair.first;
-        const Texture3D* texturePtr = tex3DPair.second;
-        auto* tex = (DX11TextureWrapper*)texturePtr->GetHandle();
+    // Варианты компилируются параллельно на воркерах, здесь только ждем и ставим их
+    if (immediate) {
+        m_compileQueue.WaitIdle();
+        InstallCompiledShaders();
+    }
+}
 
-        if (tex && tex->SRV) {
-            // Проверка для Pixel Shader (PS)
-            if (m_activeShader->ReflectionPS.TextureSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionPS.TextureSlots[name];
-                m_context->PSSetShaderResources(slot, 1, tex->SRV.GetAddressOf());
-            }
+void BackendDX11::QueueShaderVariant(uint32_t programId, ShaderPermutationKey permutation) {
+    DX11ShaderProgram& program = m_programs[programId];
+    if (program.Variants.find(permutation) != program.Variants.end() || program.Pending.count(permutation) ||
+        program.Failed.count(permutation)) return;
 
-            // Проверка для Vertex Shader (VS)
-            if (m_activeShader->ReflectionVS.TextureSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionVS.TextureSlots[name];
-                m_context->VSSetShaderResources(slot, 1, tex->SRV.GetAddressOf());
-            }
-        }
+    if (!m_compileQueue.IsRunning()) {
+        uint32_t cores = std::thread::hardware_concurrency();
+        m_compileQueue.Start(std::max(1u, std::min(ShaderCompileThreads, cores / 2)));
     }
 
-    // 5. Привязка Семплеров по имени
-    for (const auto& sampPair : pass.GetSamplers()) {
-        const std::string& name = sampPair.first;
-        const Sampler* samplerPtr = sampPair.second;
-        auto* smp = (DX11SamplerWrapper*)samplerPtr->GetHandle();
+    LogDebug("[BackendDX11] Queued Shader Pass: %s [%08X]", program.Name.c_str(), permutation);
+    program.Pending.insert(permutation);
+    ++m_pendingVariantCount;
 
-        if (smp) {
-            // Pixel Shader
-            if (m_activeShader->ReflectionPS.SamplerSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionPS.SamplerSlots[name];
-                m_context->PSSetSamplers(slot, 1, smp->State.GetAddressOf());
-            }
-            // Vertex Shader
-            if (m_activeShader->ReflectionVS.SamplerSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionVS.SamplerSlots[name];
-                m_context->VSSetSamplers(slot, 1, smp->State.GetAddressOf());
-            }
+    // Источник копируется: воркер не должен читать программу, которую меняет поток рендера
+    m_compileQueue.Enqueue([this, programId, permutation, source = program.Source]() {
+        CompiledShaderPass compiled = CompileShaderPass(source, permutation);
+        compiled.ProgramId = programId;
+        return compiled;
+    });
+}
+
+bool BackendDX11::IsShaderPassReady(const ShaderPass& pass) {
+    const DX11ShaderProgram& program = m_programs[ResolveProgram(pass)];
+    return program.Variants.find(pass.GetPermutation()) != program.Variants.end();
+}
+
+void BackendDX11::SetFallbackShaderPass(const ShaderPass* pass) {
+    // Запасной проход должен быть готов всегда, поэтому компилируем его сразу
+    if (pass) PrepareShaderPass(*pass);
+    m_fallbackPass = pass;
+}
+
+void BackendDX11::InstallCompiledShaders() {
+    if (m_pendingVariantCount == 0) return;
+
+    m_compileQueue.TakeCompleted(m_compiledShaders);
+    for (const auto& compiled : m_compiledShaders) {
+        DX11ShaderProgram& program = m_programs[compiled.ProgramId];
+        program.Pending.erase(compiled.Permutation);
+        --m_pendingVariantCount;
+        // Уже скомпилирован синхронно через PrepareShaderPass
+        if (program.Variants.find(compiled.Permutation) != program.Variants.end()) continue;
+
+        LogDebug("[BackendDX11] Installing Shader Pass: %s [%08X]", program.Name.c_str(), compiled.Permutation);
+        InstallShaderPass(program, compiled);
+    }
+    m_compiledShaders.clear();
+}
+
+bool BackendDX11::CanDrawWithActiveShader() {
+    if (m_activePassPending) {
+        if (!m_activeShader) {
+            ++m_frameStats.ShaderDrawsSkipped;
+            return false;
         }
+        ++m_frameStats.ShaderDrawsWithFallback;
     }
+    return m_activeShader != nullptr;
+}
 
-    // 6. Привязка TextureCube (Cubemaps)
-    for (const auto& texCubePair : pass.GetTexturesCube()) {
-        const std::string& name = texCubePair.first;
-        const TextureCube* texturePtr = texCubePair.second;
-        auto* tex = (DX11TextureWrapper*)texturePtr->GetHandle();
+void BackendDX11::SetShaderPass(const ShaderPass& pass) {
+    // 1. Скомпилированный проход: вариант шейдера и заранее найденные слоты ресурсов
+    const DX11PassBindings* bindings = GetPassBindings(pass);
+
+    // Вариант еще не готов (GetPassBindings поставил его в фоновую компиляцию): биндим запасной
+    // проход, а без него отрисовки пропускаются
+    if (!bindings) {
+        m_activeShader = nullptr;
+        if (m_fallbackPass && m_fallbackPass != &pass) SetShaderPass(*m_fallbackPass);
+        m_activePassPending = true;
+        return;
+    }
 
-        if (tex && tex->SRV && tex->Type == TextureType::TexCube) {
-            // Pixel Shader
-            if (m_activeShader->ReflectionPS.TextureSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionPS.TextureSlots[name];
-                m_context->PSSetShaderResources(slot, 1, tex->SRV.GetAddressOf());
-            }
-            // Vertex Shader
-            if (m_activeShader->ReflectionVS.TextureSlots.count(name)) {
-                UINT slot = m_activeShader->ReflectionVS.TextureSlots[name];
-                m_context->VSSetShaderResources(slot, 1, tex->SRV.GetAddressOf());
-            }
+    // Устанавливаем активный шейдер
+    m_activeShader = bindings->Shader;
+    m_activePassPending = false;
+
+    // 2. Устанавливаем пайплайн (InputLayout, VS, PS)
+    BindShaders(m_activeShader->InputLayouts[(int)VertexLayout::Standard].Get(), m_activeShader->VertexShader.Get(), m_activeShader->PixelShader.Get());
+
+    // 3. Текстуры и семплеры: [0] - Vertex Shader, [1] - Pixel Shader.
+    // Хендлы читаются из объектов при каждом бинде, текстуру можно пересоздать, не трогая проход
+    for (int stage = 0; stage < 2; ++stage) {
+        for (const auto& binding : bindings->Textures[stage]) {
+            auto* tex = m_textures.Get(GetBindingHandle(binding));
+            if (!tex) continue;
+            if (binding.Type == TextureType::Tex3D && !tex->SRV) continue;
+            if (binding.Type == TextureType::TexCube && (!tex->SRV || tex->Type != TextureType::TexCube)) continue;
+
+            BindShaderResource(stage, binding.Slot, tex->SRV.Get(), GetTextureResource(*tex));
         }
-    }
 
+        for (const auto& binding : bindings->Samplers[stage]) {
+            auto* smp = m_samplers.Get(binding.Source->GetHandle());
+            if (!smp) continue;
+
+            BindSampler(stage, binding.Slot, smp->State.Get());
+        }
+    }
 }
 
-void BackendDX11::UpdateConstantRaw(const std::string& name, const void* data, size_t size) {
-    std::vector<uint8_t> buffer(size);
-    memcpy(buffer.data(), data, size);
-    m_cpuConstantsStorage[name] = { buffer };
+void BackendDX11::UpdateConstantRaw(ConstantId id, const void* data, size_t size) {
+    m_constants.Set(id, data, size);
 }
 
 void BackendDX11::UploadConstants(DX11ReflectionData& reflectionData, ShaderType SType) {
     for (auto& cb : reflectionData.Buffers) {
         if (!cb.HardwareBuffer) continue;
 
-        bool isDirty = false;
+        uint8_t* shadow = cb.ShadowData.data();
+        size_t shadowSize = cb.ShadowData.size();
 
         // 1. Проверяем, обновил ли пользователь ВЕСЬ буфер целиком по имени
-        // (Например: UpdateConstantRaw("SSAOConfigBuffer", &data, size))
-        if (m_cpuConstantsStorage.count(cb.Name)) {
-            const auto& stored = m_cpuConstantsStorage[cb.Name];
-            if (stored.Data.size() <= cb.ShadowData.size()) {
-                memcpy(cb.ShadowData.data(), stored.Data.data(), stored.Data.size());
-                isDirty = true;
-                // Важно: Мы не удаляем данные из map, так как они могут понадобиться в следующем кадре,
-                // но можно оптимизировать флагами "dirty".
-            }
+        // (Например: SetCustomConstant("SSAOConfigBuffer", data)).
+        // Он затирает переменные, поэтому их нужно наложить заново
+        if (m_constants.Apply(cb.WholeBuffer, shadow, shadowSize)) {
+            ++cb.Version;
+            for (auto& var : cb.Variables) var.SeenVersion = 0;
         }
 
         // 2. Проверяем отдельные переменные внутри буфера
-        // (Например: SetConstant("World", ...))
-        for (const auto& var : cb.Variables) {
-            if (m_cpuConstantsStorage.count(var.Name)) {
-                const auto& stored = m_cpuConstantsStorage[var.Name];
-
-                // Проверка выхода за границы
-                if (var.Offset + var.Size <= cb.ShadowData.size() &&
-                    stored.Data.size() >= var.Size)
-                {
-                    // Копируем в теневой буфер
-                    memcpy(cb.ShadowData.data() + var.Offset, stored.Data.data(), var.Size);
-                    isDirty = true;
-                }
+        // (Например: SetConstant("World", ...)). Сравниваются только версии,
+        // в теневой буфер копируются лишь изменившиеся значения
+        bool changed = false;
+        for (auto& var : cb.Variables) {
+            if (m_constants.Apply(var, shadow, shadowSize)) changed = true;
+        }
+        if (changed) ++cb.Version;
+
+        // 3. Заливаем в GPU, только если содержимое изменилось с прошлой заливки.
+        // У каждого шейдера свой HardwareBuffer, а Dynamic буфер без Map сохраняет
+        // старое содержимое, так что пропуск безопасен
+        if (cb.Version != cb.UploadedVersion) {
+            D3D11_MAPPED_SUBRESOURCE map;
+            if (SUCCEEDED(m_context->Map(cb.HardwareBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map))) {
+                memcpy(map.pData, cb.ShadowData.data(), cb.ShadowData.size());
+                m_context->Unmap(cb.HardwareBuffer.Get(), 0);
+                cb.UploadedVersion = cb.Version;
+                m_frameStats.ConstantBytesUploaded += cb.ShadowData.size();
+                ++m_frameStats.ConstantBuffersUploaded;
             }
         }
+        else {
+            ++m_frameStats.ConstantUploadsSkipped;
+        }
 
-        // 3. Заливаем в GPU (Всегда заливаем всё, Map_DISCARD требует этого!)
-        // Даже если isDirty == false, данные могли быть нужны с прошлого кадра, 
-        // но DX11 требует, чтобы мы обновляли Dynamic буферы или не трогали их. 
-        // В нашем случае, так как мы используем одну карту storage на все шейдеры,
-        // лучше обновлять.
-
-        D3D11_MAPPED_SUBRESOURCE map;
-        if (SUCCEEDED(m_context->Map(cb.HardwareBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map))) {
-            memcpy(map.pData, cb.ShadowData.data(), cb.ShadowData.size());
-            m_context->Unmap(cb.HardwareBuffer.Get(), 0);
+        // 4. Биндим буфер, если в слоте сейчас не он
+        int stage = (SType == ShaderType::Vertex) ? 0 : 1;
+        ID3D11Buffer* buffer = cb.HardwareBuffer.Get();
+        if (cb.Slot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT) {
+            if (m_bindState.ConstantBuffers[stage][cb.Slot] == buffer) {
+                ++m_frameStats.ConstantBindsSkipped;
+                ++m_frameStats.BindCallsElided;
+                continue;
+            }
+            m_bindState.ConstantBuffers[stage][cb.Slot] = buffer;
         }
+        ++m_frameStats.BindCallsIssued;
 
-        // 4. Биндим буфер
         if (SType == ShaderType::Vertex) {
-            m_context->VSSetConstantBuffers(cb.Slot, 1, cb.HardwareBuffer.GetAddressOf());
+            m_context->VSSetConstantBuffers(cb.Slot, 1, &buffer);
         }
         else {
-            m_context->PSSetConstantBuffers(cb.Slot, 1, cb.HardwareBuffer.GetAddressOf());
+            m_context->PSSetConstantBuffers(cb.Slot, 1, &buffer);
         }
     }
 }
 
-void BackendDX11::UnbindResources() {
-    ID3D11ShaderResourceView* nullSRVs[16] = { nullptr };
+void BackendDX11::ResetBindingState() {
+    // 0xFF не совпадает ни с одним настоящим указателем/форматом, поэтому после сброса каждый
+    // первый вызов уходит в контекст. SRV же обнуляем по-настоящему: без знания о том,
+    // что висит в слотах, нельзя отследить конфликты с RTV. Цели рендера ставим только мы сами,
+    // поэтому их помним и дальше
+    ID3D11Resource* renderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    memcpy(renderTargets, m_bindState.RenderTargets, sizeof(renderTargets));
+    ID3D11Resource* depthTarget = m_bindState.DepthTarget;
+
+    memset(&m_bindState, 0xFF, sizeof(m_bindState));
+    memset(m_bindState.SRVs, 0, sizeof(m_bindState.SRVs));
+    memset(m_bindState.SRVResources, 0, sizeof(m_bindState.SRVResources));
+    memcpy(m_bindState.RenderTargets, renderTargets, sizeof(renderTargets));
+    m_bindState.DepthTarget = depthTarget;
 
     if (m_context) {
-        m_context->PSSetShaderResources(0, 16, nullSRVs);
-        m_context->VSSetShaderResources(0, 16, nullSRVs);
+        ID3D11ShaderResourceView* nullSRVs[DX11BindingState::SlotCount] = { nullptr };
+        m_context->VSSetShaderResources(0, DX11BindingState::SlotCount, nullSRVs);
+        m_context->PSSetShaderResources(0, DX11BindingState::SlotCount, nullSRVs);
     }
 }
 
-void BackendDX11::CreateInputLayoutFromShader(const std::vector<char>& shaderBytecode, ID3D11InputLayout** outLayout) {
-    ID3D11ShaderReflection* reflector = nullptr;
-    if (FAILED(D3DReflect(shaderBytecode.data(), shaderBytecode.size(), IID_ID3D11ShaderReflection, (void**)&reflector))) {
-        return;
+void BackendDX11::BindShaders(ID3D11InputLayout* layout, ID3D11VertexShader* vs, ID3D11PixelShader* ps) {
+    if (m_bindState.InputLayout != layout) {
+        m_context->IASetInputLayout(layout);
+        m_bindState.InputLayout = layout;
+        ++m_frameStats.BindCallsIssued;
     }
+    else ++m_frameStats.BindCallsElided;
 
-    D3D11_SHADER_DESC shaderDesc;
-    reflector->GetDesc(&shaderDesc);
+    if (m_bindState.VertexShader != vs) {
+        m_context->VSSetShader(vs, nullptr, 0);
+        m_bindState.VertexShader = vs;
+        ++m_frameStats.BindCallsIssued;
+    }
+    else ++m_frameStats.BindCallsElided;
 
-    std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
+    if (m_bindState.PixelShader != ps) {
+        m_context->PSSetShader(ps, nullptr, 0);
+        m_bindState.PixelShader = ps;
+        ++m_frameStats.BindCallsIssued;
+    }
+    else ++m_frameStats.BindCallsElided;
+}
+
+void BackendDX11::BindShaderResource(int stage, UINT slot, ID3D11ShaderResourceView* srv, ID3D11Resource* resource) {
+    // Текстура сейчас цель рендера: D3D все равно подставил бы null (с предупреждением)
+    if (resource && IsBoundAsRenderTarget(resource)) {
+        srv = nullptr;
+        resource = nullptr;
+        ++m_frameStats.HazardUnbinds;
+    }
+
+    if (slot < DX11BindingState::SlotCount) {
+        if (m_bindState.SRVs[stage][slot] == srv) {
+            ++m_frameStats.BindCallsElided;
+            return;
+        }
+        m_bindState.SRVs[stage][slot] = srv;
+        m_bindState.SRVResources[stage][slot] = resource;
+    }
+
+    if (stage == 0) m_context->VSSetShaderResources(slot, 1, &srv);
+    else m_context->PSSetShaderResources(slot, 1, &srv);
+    ++m_frameStats.BindCallsIssued;
+}
+
+void BackendDX11::BindSampler(int stage, UINT slot, ID3D11SamplerState* sampler) {
+    if (slot < DX11BindingState::SlotCount) {
+        if (m_bindState.Samplers[stage][slot] == sampler) {
+            ++m_frameStats.BindCallsElided;
+            return;
+        }
+        m_bindState.Samplers[stage][slot] = sampler;
+    }
+
+    if (stage == 0) m_context->VSSetSamplers(slot, 1, &sampler);
+    else m_context->PSSetSamplers(slot, 1, &sampler);
+    ++m_frameStats.BindCallsIssued;
+}
+
+void BackendDX11::SetVertexBufferConstants(const DX11BufferWrapper& vb) {
+    static constexpr ConstantId PositionScaleId("PositionScale");
+    static constexpr ConstantId PositionOffsetId("PositionOffset");
+    // Хранятся в буфере, а не ставятся из Mesh: так их получают и отрисовки, записанные
+    // в DrawQueue, RenderCommandBuffer и MeshBatcher. Остальным форматам они не нужны
+    if (vb.Layout != VertexLayout::Compact) return;
+    m_constants.Set(PositionScaleId, vb.Quantization.Scale, sizeof(vb.Quantization.Scale));
+    m_constants.Set(PositionOffsetId, vb.Quantization.Offset, sizeof(vb.Quantization.Offset));
+}
+
+bool BackendDX11::BindShadersForVertices(VertexLayout layout) {
+    ID3D11InputLayout* inputLayout = m_activeShader->InputLayouts[(int)layout].Get();
+    // Пустой стандартный layout - у шейдера нет вершинных входов, рисовать можно чем угодно
+    if (!inputLayout && m_activeShader->InputLayouts[(int)VertexLayout::Standard]) {
+        ++m_frameStats.VertexLayoutMismatches;
+        return false;
+    }
+    BindShaders(inputLayout, m_activeShader->VertexShader.Get(), m_activeShader->PixelShader.Get());
+    return true;
+}
+
+void BackendDX11::BindGeometry(UINT vertexBufferCount, ID3D11Buffer* const* vertexBuffers, const UINT* strides, ID3D11Buffer* indexBuffer, DXGI_FORMAT indexFormat) {
+    // Слоты вершинных буферов, которых нет в вызове, не трогаем: лишний буфер в слоте 1 безвреден
+    bool vertexBuffersChanged = false;
+    for (UINT i = 0; i < vertexBufferCount; ++i) {
+        if (m_bindState.VertexBuffers[i] != vertexBuffers[i] || m_bindState.VertexStrides[i] != strides[i] || m_bindState.VertexOffsets[i] != 0) {
+            vertexBuffersChanged = true;
+        }
+    }
+
+    if (vertexBuffersChanged) {
+        UINT offsets[DX11BindingState::VertexBufferCount] = {};
+        m_context->IASetVertexBuffers(0, vertexBufferCount, vertexBuffers, strides, offsets);
+        for (UINT i = 0; i < vertexBufferCount; ++i) {
+            m_bindState.VertexBuffers[i] = vertexBuffers[i];
+            m_bindState.VertexStrides[i] = strides[i];
+            m_bindState.VertexOffsets[i] = 0;
+        }
+        ++m_frameStats.BindCallsIssued;
+    }
+    else ++m_frameStats.BindCallsElided;
+
+    if (m_bindState.IndexBuffer != indexBuffer || m_bindState.IndexFormat != indexFormat) {
+        m_context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
+        m_bindState.IndexBuffer = indexBuffer;
+        m_bindState.IndexFormat = indexFormat;
+        ++m_frameStats.BindCallsIssued;
+    }
+    else ++m_frameStats.BindCallsElided;
+
+    if (m_bindState.Topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST) {
+        m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        m_bindState.Topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        ++m_frameStats.BindCallsIssued;
+    }
+    else ++m_frameStats.BindCallsElided;
+}
+
+bool BackendDX11::IsBoundAsRenderTarget(ID3D11Resource* resource) const {
+    if (resource == m_bindState.DepthTarget) return true;
+    for (ID3D11Resource* target : m_bindState.RenderTargets) {
+        if (target == resource) return true;
+    }
+    return false;
+}
+
+void BackendDX11::UnbindRenderTargetHazards(ID3D11Resource* const* resources, int count) {
+    // Снимаем SRV только с тех слотов, где висит текстура, в которую сейчас будем рисовать
+    for (int i = 0; i < count; ++i) {
+        if (!resources[i]) continue;
+        for (int stage = 0; stage < 2; ++stage) {
+            for (UINT slot = 0; slot < DX11BindingState::SlotCount; ++slot) {
+                if (m_bindState.SRVResources[stage][slot] != resources[i]) continue;
+
+                ID3D11ShaderResourceView* nullSRV = nullptr;
+                if (stage == 0) m_context->VSSetShaderResources(slot, 1, &nullSRV);
+                else m_context->PSSetShaderResources(slot, 1, &nullSRV);
+                m_bindState.SRVs[stage][slot] = nullptr;
+                m_bindState.SRVResources[stage][slot] = nullptr;
+                ++m_frameStats.HazardUnbinds;
+            }
+        }
+    }
+}
 
-    for (UINT i = 0; i < shaderDesc.InputParameters; i++) {
-        D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-        reflector->GetInputParameterDesc(i, &paramDesc);
+ID3D11Resource* BackendDX11::GetTextureResource(const DX11TextureWrapper& texture) {
+    if (texture.Texture) return texture.Texture.Get();
+    return texture.Texture3D.Get();
+}
 
+// Где лежит семантика в CompactVertex. Других вершинных входов у сжатого формата нет
+static bool GetCompactElement(const std::string& semantic, UINT semanticIndex, DXGI_FORMAT& format, UINT& offset) {
+    if (semanticIndex != 0) return false;
+    if (semantic == "POSITION") { format = DXGI_FORMAT_R16G16B16A16_SNORM; offset = offsetof(CompactVertex, Position); return true; }
+    if (semantic == "NORMAL") { format = DXGI_FORMAT_R16G16_SNORM; offset = offsetof(CompactVertex, Normal); return true; }
+    if (semantic == "TANGENT") { format = DXGI_FORMAT_R16G16_SNORM; offset = offsetof(CompactVertex, Tangent); return true; }
+    if (semantic == "TEXCOORD") { format = DXGI_FORMAT_R16G16_FLOAT; offset = offsetof(CompactVertex, UV); return true; }
+    return false;
+}
+
+void BackendDX11::CreateInputLayoutFromShader(const ShaderCacheEntry& shader, VertexLayout layout, ID3D11InputLayout** outLayout) {
+    std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
+
+    for (const auto& param : shader.InputElements) {
         D3D11_INPUT_ELEMENT_DESC element = {};
-        element.SemanticName = paramDesc.SemanticName;
-        element.SemanticIndex = paramDesc.SemanticIndex;
+        element.SemanticName = param.SemanticName.c_str();
+        element.SemanticIndex = param.SemanticIndex;
         element.Format = DXGI_FORMAT_UNKNOWN; // Будет определено ниже по маске
         element.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 
         // --- ЛОГИКА ИНСТАНСИНГА ---
-        std::string semanticName = paramDesc.SemanticName;
         // Если семантика начинается с "INSTANCE_", считаем это данными инстанса (Slot 1)
-        if (semanticName.rfind("INSTANCE_", 0) == 0) {
+        if (param.SemanticName.rfind("INSTANCE_", 0) == 0) {
             element.InputSlot = 1; // Instance Buffer Slot
             element.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
             element.InstanceDataStepRate = 1; // 1 шаг на 1 инстанс
@@ -1039,41 +1679,45 @@ void BackendDX11::CreateInputLayoutFromShader(const std::vector<char>& shaderByt
             element.InstanceDataStepRate = 0;
         }
 
+        // Сжатые вершины: форматы и смещения фиксированы. Шейдер, читающий то, чего в них нет
+        // (например BITANGENT), остается без такого layout
+        if (layout == VertexLayout::Compact && element.InputSlot == 0) {
+            if (!GetCompactElement(param.SemanticName, param.SemanticIndex, element.Format, element.AlignedByteOffset)) return;
+            inputLayoutDesc.push_back(element);
+            continue;
+        }
+
         // Определение формата (упрощенное, но рабочее для float)
-        if (paramDesc.Mask == 1) element.Format = DXGI_FORMAT_R32_FLOAT;
-        else if (paramDesc.Mask <= 3) element.Format = DXGI_FORMAT_R32G32_FLOAT;
-        else if (paramDesc.Mask <= 7) element.Format = DXGI_FORMAT_R32G32B32_FLOAT;
-        else if (paramDesc.Mask <= 15) element.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        if (param.Mask == 1) element.Format = DXGI_FORMAT_R32_FLOAT;
+        else if (param.Mask <= 3) element.Format = DXGI_FORMAT_R32G32_FLOAT;
+        else if (param.Mask <= 7) element.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+        else if (param.Mask <= 15) element.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 
         inputLayoutDesc.push_back(element);
     }
 
-    m_device->CreateInputLayout(inputLayoutDesc.data(), (UINT)inputLayoutDesc.size(), shaderBytecode.data(), shaderBytecode.size(), outLayout);
-    reflector->Release();
+    m_device->CreateInputLayout(inputLayoutDesc.data(), (UINT)inputLayoutDesc.size(), shader.Bytecode.data(), shader.Bytecode.size(), outLayout);
 }
 
 void BackendDX11::DrawFullScreenQuad() {
-    if (!m_activeShader) return;
+    if (!CanDrawWithActiveShader()) return;
 
     UploadConstants(m_activeShader->ReflectionVS, ShaderType::Vertex);
     UploadConstants(m_activeShader->ReflectionPS, ShaderType::Pixel);
 
+    // Перед этим могла рисоваться сетка другого формата
+    BindShadersForVertices(VertexLayout::Standard);
+
     UINT stride = sizeof(SimpleVertex);
-    UINT offset = 0;
-    m_context->IASetVertexBuffers(0, 1, m_quadVertexBuffer.GetAddressOf(), &stride, &offset);
-    m_context->IASetIndexBuffer(m_quadIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-    m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    BindGeometry(1, m_quadVertexBuffer.GetAddressOf(), &stride, m_quadIndexBuffer.Get(), DXGI_FORMAT_R16_UINT);
 
     m_context->DrawIndexed(6, 0, 0);
-
-    // Очистка SRV (чтобы можно было писать в эти текстуры на след. кадре)
-    ID3D11ShaderResourceView* nullSRVs[8] = { nullptr };
-    m_context->PSSetShaderResources(0, 8, nullSRVs);
 }
 
-void* BackendDX11::CreateBufferInternal(const void* data, size_t size, UINT bindFlags) {
-    auto* wrapper = new DX11BufferWrapper();
-    wrapper->Size = (UINT)size;
+BufferHandle BackendDX11::CreateBufferInternal(const void* data, size_t size, UINT bindFlags, UINT stride) {
+    DX11BufferWrapper wrapper = {};
+    wrapper.Size = (UINT)size;
+    wrapper.Stride = stride;
 
     D3D11_BUFFER_DESC bd = {};
     bd.Usage = D3D11_USAGE_DEFAULT;
@@ -1084,44 +1728,71 @@ void* BackendDX11::CreateBufferInternal(const void* data, size_t size, UINT bind
     D3D11_SUBRESOURCE_DATA initData = {};
     initData.pSysMem = data;
 
-    HRESULT hr = m_device->CreateBuffer(&bd, &initData, wrapper->Buffer.GetAddressOf());
+    HRESULT hr = m_device->CreateBuffer(&bd, &initData, wrapper.Buffer.GetAddressOf());
     if (FAILED(hr)) {
         LogDebug("[BackendDX11] Failed to create buffer. Hr: 0x%X", hr);
-        delete wrapper;
-        return nullptr;
+        return BufferHandle();
     }
-    return wrapper;
+    return m_buffers.Allocate(std::move(wrapper));
 }
 
-void* BackendDX11::CreateVertexBuffer(const void* data, size_t size, int stride) {
-    auto* w = (DX11BufferWrapper*)CreateBufferInternal(data, size, D3D11_BIND_VERTEX_BUFFER);
-
-    if (w) {
-        w->Stride = (UINT)stride;
+BufferHandle BackendDX11::CreateVertexBuffer(const void* data, size_t size, int stride, VertexLayout layout,
+    const PositionQuantization& quantization) {
+    BufferHandle handle = CreateBufferInternal(data, size, D3D11_BIND_VERTEX_BUFFER, (UINT)stride);
+    if (auto* buffer = m_buffers.Get(handle)) {
+        buffer->Layout = layout;
+        buffer->Quantization = quantization;
     }
+    return handle;
+}
 
-    return w;
+BufferHandle BackendDX11::CreateIndexBuffer(const void* data, size_t size, int indexSize) {
+    BufferHandle handle = CreateBufferInternal(data, size, D3D11_BIND_INDEX_BUFFER, (UINT)indexSize);
+    if (auto* buffer = m_buffers.Get(handle)) buffer->IndexFormat = indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    return handle;
 }
 
-void* BackendDX11::CreateIndexBuffer(const void* data, size_t size) {
-    return CreateBufferInternal(data, size, D3D11_BIND_INDEX_BUFFER);
+BufferHandle BackendDX11::CreateInstanceBuffer(const void* data, size_t size, int stride) {
+    return CreateBufferInternal(data, size, D3D11_BIND_VERTEX_BUFFER, (UINT)stride);
 }
 
-void* BackendDX11::CreateInstanceBuffer(const void* data, size_t size, int stride) {
-    auto* w = (DX11BufferWrapper*)CreateBufferInternal(data, size, D3D11_BIND_VERTEX_BUFFER);
-    if (w) {
-        w->Stride = (UINT)stride;
+BufferHandle BackendDX11::CreateDynamicBuffer(size_t size, int stride) {
+    DX11BufferWrapper wrapper = {};
+    wrapper.Size = (UINT)size;
+    wrapper.Stride = (UINT)stride;
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.ByteWidth = (UINT)size;
+    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    HRESULT hr = m_device->CreateBuffer(&bd, nullptr, wrapper.Buffer.GetAddressOf());
+    if (FAILED(hr)) {
+        LogDebug("[BackendDX11] Failed to create dynamic buffer. Hr: 0x%X", hr);
+        return BufferHandle();
     }
-    return w;
+    return m_buffers.Allocate(std::move(wrapper));
 }
 
-void BackendDX11::DrawMesh(void* vbHandle, void* ibHandle, int indexCount) {
-    // Базовые проверки
-    if (!m_activeShader || !vbHandle || !ibHandle) return;
+bool BackendDX11::UpdateDynamicBuffer(BufferHandle handle, const void* data, size_t size) {
+    auto* buffer = m_buffers.Get(handle);
+    if (!buffer || size > buffer->Size) return false;
 
-    // Приведение типов к нашим внутренним оберткам
-    auto* vb = (DX11BufferWrapper*)vbHandle;
-    auto* ib = (DX11BufferWrapper*)ibHandle;
+    // DISCARD: драйвер выдает новую память, GPU продолжает читать старое содержимое
+    D3D11_MAPPED_SUBRESOURCE map;
+    if (FAILED(m_context->Map(buffer->Buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map))) return false;
+    memcpy(map.pData, data, size);
+    m_context->Unmap(buffer->Buffer.Get(), 0);
+    return true;
+}
+
+void BackendDX11::DrawMesh(BufferHandle vbHandle, BufferHandle ibHandle, int indexCount) {
+    // Базовые проверки (устаревший хендл вернет nullptr)
+    auto* vb = m_buffers.Get(vbHandle);
+    auto* ib = m_buffers.Get(ibHandle);
+    if (!vb || !ib || !CanDrawWithActiveShader() || !BindShadersForVertices(vb->Layout)) return;
+    SetVertexBufferConstants(*vb);
 
     // 1. Обновляем и биндим константы для Vertex Shader (поддержка мульти-буферов)
     UploadConstants(m_activeShader->ReflectionVS, ShaderType::Vertex);
@@ -1133,36 +1804,67 @@ void BackendDX11::DrawMesh(void* vbHandle, void* ibHandle, int indexCount) {
     // 3. Установка геометрии (Input Assembler)
     // -----------------------------------------------------------
     UINT stride = vb->Stride; // Размер одной вершины (шаг)
-    UINT offset = 0;
-
-    // Устанавливаем Вершинный Буфер
-    m_context->IASetVertexBuffers(0, 1, vb->Buffer.GetAddressOf(), &stride, &offset);
-
-    // Устанавливаем Индексный Буфер (Формат R32_UINT означает unsigned int)
-    m_context->IASetIndexBuffer(ib->Buffer.Get(), DXGI_FORMAT_R32_UINT, 0);
 
-    // Указываем тип примитивов (список треугольников)
-    m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    // Вершинный и индексный (16 или 32 бита, как создан) буферы, список треугольников. Повторы отбрасываются
+    BindGeometry(1, vb->Buffer.GetAddressOf(), &stride, ib->Buffer.Get(), ib->IndexFormat);
 
     // -----------------------------------------------------------
     // 4. Отрисовка
     // -----------------------------------------------------------
     m_context->DrawIndexed(indexCount, 0, 0);
 
-    // -----------------------------------------------------------
-    // 5. Очистка ресурсов
-    // -----------------------------------------------------------
-    // Важно сбросить SRV, чтобы избежать конфликтов чтения/записи в следующих проходах
-    ID3D11ShaderResourceView* nullSRVs[8] = { nullptr };
-    m_context->PSSetShaderResources(0, 8, nullSRVs);
+    // SRV не сбрасываются после каждой отрисовки: конфликт с RTV снимается в SetRenderTarget,
+    // и только для тех текстур, которые действительно станут целью рендера
 }
 
-void BackendDX11::DrawMeshInstanced(void* vbHandle, void* ibHandle, int indexCount, void* instHandle, int instanceCount, int instanceStride) {
-    if (!m_activeShader || !vbHandle || !ibHandle || !instHandle) return;
+TransientAllocation BackendDX11::AllocateTransient(const void* data, size_t size, uint32_t alignment) {
+    TransientAllocation result;
+    if (!m_uploadBuffer.IsValid()) {
+        m_uploadBuffer = CreateDynamicBuffer(UploadRingSize, 0);
+        if (!m_uploadBuffer.IsValid()) return result;
+        m_uploadRing.Reset(UploadRingSize);
+    }
+    if (size > UploadRingSize) {
+        LogDebug("[BackendDX11] Transient allocation of %zu bytes exceeds the upload ring", size);
+        return result;
+    }
 
-    auto* vb = (DX11BufferWrapper*)vbHandle;
-    auto* ib = (DX11BufferWrapper*)ibHandle;
-    auto* instBuffer = (DX11BufferWrapper*)instHandle;
+    bool wrapped = false;
+    bool discard = false;
+    uint64_t offset = m_uploadRing.Allocate(size, alignment, wrapped);
+    if (offset == UploadRing::InvalidOffset) {
+        // Кольцо занято кадрами в полете. В DX11 DISCARD выдает новую память,
+        // а GPU дочитывает старую, поэтому можно начать с нуля, не дожидаясь его.
+        // Но DISCARD подменяет весь буфер, и срезы, выданные раньше в этом кадре, теряют данные
+        LogDebug("[BackendDX11] Upload ring overflow: %llu bytes in flight, earlier slices of this frame are invalidated",
+                 (unsigned long long)m_uploadRing.GetUsedBytes());
+        m_uploadRing.Reset(UploadRingSize);
+        offset = m_uploadRing.Allocate(size, alignment, wrapped);
+        discard = true;
+    }
+
+    // Обычный переход на начало тоже идет через NO_OVERWRITE: фенсы кадров гарантируют, что GPU
+    // уже не читает ту память, а содержимое остального буфера (срезы этого кадра) сохраняется
+    auto* buffer = m_buffers.Get(m_uploadBuffer);
+    D3D11_MAPPED_SUBRESOURCE map;
+    D3D11_MAP mapType = discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (!buffer || FAILED(m_context->Map(buffer->Buffer.Get(), 0, mapType, 0, &map))) return result;
+    memcpy((uint8_t*)map.pData + offset, data, size);
+    m_context->Unmap(buffer->Buffer.Get(), 0);
+
+    m_frameStats.TransientBytesUploaded += size;
+    result.Buffer = m_uploadBuffer;
+    result.Offset = (uint32_t)offset;
+    result.Size = (uint32_t)size;
+    return result;
+}
+
+void BackendDX11::DrawMeshInstanced(BufferHandle vbHandle, BufferHandle ibHandle, int indexCount, BufferHandle instHandle, int instanceCount, int instanceStride, int firstInstance) {
+    auto* vb = m_buffers.Get(vbHandle);
+    auto* ib = m_buffers.Get(ibHandle);
+    auto* instBuffer = m_buffers.Get(instHandle);
+    if (!vb || !ib || !instBuffer || !CanDrawWithActiveShader() || !BindShadersForVertices(vb->Layout)) return;
+    SetVertexBufferConstants(*vb);
 
     // 1. Константы
     UploadConstants(m_activeShader->ReflectionVS, ShaderType::Vertex);
@@ -1173,17 +1875,10 @@ void BackendDX11::DrawMeshInstanced(void* vbHandle, void* ibHandle, int indexCou
     // Slot 1: Инстанс данные (Transform matrix, color, id etc)
     ID3D11Buffer* vbs[] = { vb->Buffer.Get(), instBuffer->Buffer.Get() };
     UINT strides[] = { vb->Stride, (UINT)instanceStride };
-    UINT offsets[] = { 0, 0 };
 
     // Ставим сразу 2 буфера
-    m_context->IASetVertexBuffers(0, 2, vbs, strides, offsets);
-    m_context->IASetIndexBuffer(ib->Buffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-    m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    BindGeometry(2, vbs, strides, ib->Buffer.Get(), ib->IndexFormat);
 
     // 3. Рисуем
-    m_context->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
-
-    // 4. Очистка
-    ID3D11ShaderResourceView* nullSRVs[8] = { nullptr };
-    m_context->PSSetShaderResources(0, 8, nullSRVs);
+    m_context->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, (UINT)firstInstance);
 }
\ No newline at end of file
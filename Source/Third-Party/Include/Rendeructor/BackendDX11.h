@@ -1,5 +1,12 @@
 #pragma once
 #include "BackendInterface.h"
+#include "ResourcePool.h"
+#include "RendeructorUploadRing.h"
+#include "RendeructorShaderCache.h"
+#include "RendeructorCompileQueue.h"
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 
 using Microsoft::WRL::ComPtr;
 
@@ -8,6 +15,7 @@ struct DX11TextureWrapper {
     ComPtr<ID3D11Texture3D> Texture3D;
     ComPtr<ID3D11ShaderResourceView> SRV;
     ComPtr<ID3D11RenderTargetView> RTV;
+    ComPtr<ID3D11DepthStencilView> DSV; //   TextureFormat::Depth24Stencil8, RTV   
     int Width;
     int Height;
     int Depth;
@@ -18,19 +26,18 @@ struct DX11SamplerWrapper {
     ComPtr<ID3D11SamplerState> State;
 };
 
-struct ConstantBufferVariable {
-    std::string Name;
-    UINT Offset;
-    UINT Size;
-};
-
 struct ReflectedConstantBuffer {
     std::string Name;
     UINT Slot;
     UINT Size;
-    std::vector<ConstantBufferVariable> Variables;
+    ConstantBinding WholeBuffer; // SetCustomConstant   
+    std::vector<ConstantBinding> Variables;
     ComPtr<ID3D11Buffer> HardwareBuffer;
     std::vector<uint8_t> ShadowData;
+    // Version     ShadowData, UploadedVersion - ,   GPU.
+    //  "",    
+    uint32_t Version = 1;
+    uint32_t UploadedVersion = 0;
 };
 
 struct DX11ReflectionData {
@@ -42,15 +49,102 @@ struct DX11ReflectionData {
 struct DX11ShaderWrapper {
     ComPtr<ID3D11VertexShader> VertexShader;
     ComPtr<ID3D11PixelShader> PixelShader;
-    ComPtr<ID3D11InputLayout> InputLayout;
+    //    VertexLayout; ,      
+    ComPtr<ID3D11InputLayout> InputLayouts[VertexLayoutCount];
     DX11ReflectionData ReflectionVS;
     DX11ReflectionData ReflectionPS;
 };
 
+//  .     
+struct DX11ShaderSource {
+    std::string VertexShaderPath;
+    std::string VertexShaderEntryPoint;
+    std::string PixelShaderPath;
+    std::string PixelShaderEntryPoint;
+    std::vector<std::string> FeatureDefines;
+};
+
+//     . Variants - , Pending -   ,
+// Failed -  :     ,    
+struct DX11ShaderProgram {
+    std::string Name; //  
+    DX11ShaderSource Source;
+    std::unordered_map<ShaderPermutationKey, DX11ShaderWrapper> Variants;
+    std::unordered_set<ShaderPermutationKey> Pending;
+    std::unordered_set<ShaderPermutationKey> Failed;
+};
+
+//   .    ,  D3D    InstallShaderPass
+struct CompiledShaderPass {
+    uint32_t ProgramId = 0;
+    ShaderPermutationKey Permutation = 0;
+    ShaderCacheEntry VS;
+    ShaderCacheEntry PS;
+    bool HasVS = false;
+    bool HasPS = false;
+};
+
+struct DX11TextureBinding {
+    UINT Slot;
+    TextureType Type;
+    const void* Source; // Texture, Texture3D  TextureCube  ShaderPass ( Type)
+};
+
+struct DX11SamplerBinding {
+    UINT Slot;
+    const Sampler* Source;
+};
+
+//       .  : [0] - VS, [1] - PS
+struct DX11PassBindings {
+    DX11ShaderWrapper* Shader = nullptr;
+    std::vector<DX11TextureBinding> Textures[2];
+    std::vector<DX11SamplerBinding> Samplers[2];
+};
+
+//   ShaderPass,     (ShaderPass::GetBackendCache).
+// ,   ,    
+struct DX11CompiledPass {
+    const ShaderPass* Owner = nullptr;
+    uint32_t Generation = 0;
+    uint32_t PassVersion = 0;
+    uint32_t ProgramId = 0;
+    std::unordered_map<ShaderPermutationKey, DX11PassBindings> Variants;
+    DX11PassBindings* Last = nullptr;
+    ShaderPermutationKey LastPermutation = 0;
+};
+
+//   ,    .    
+//   SRV   ,     .
+//  : 0 - VS, 1 - PS
+struct DX11BindingState {
+    static constexpr UINT SlotCount = 16;
+    static constexpr UINT VertexBufferCount = 2;
+
+    ID3D11InputLayout* InputLayout;
+    ID3D11VertexShader* VertexShader;
+    ID3D11PixelShader* PixelShader;
+    ID3D11ShaderResourceView* SRVs[2][SlotCount];
+    ID3D11Resource* SRVResources[2][SlotCount];
+    ID3D11SamplerState* Samplers[2][SlotCount];
+    ID3D11Buffer* ConstantBuffers[2][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+    ID3D11Buffer* VertexBuffers[VertexBufferCount];
+    UINT VertexStrides[VertexBufferCount];
+    UINT VertexOffsets[VertexBufferCount];
+    ID3D11Buffer* IndexBuffer;
+    DXGI_FORMAT IndexFormat;
+    D3D11_PRIMITIVE_TOPOLOGY Topology;
+    ID3D11Resource* RenderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT]; // nullptr - back buffer  
+    ID3D11Resource* DepthTarget; // nullptr -   
+};
+
 struct DX11BufferWrapper {
     ComPtr<ID3D11Buffer> Buffer;
     UINT Size; //   
     UINT Stride; //    ( VB)
+    VertexLayout Layout = VertexLayout::Standard; //   ( VB)
+    PositionQuantization Quantization; //   ( Compact VB)
+    DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT; // R16_UINT  R32_UINT ( IB)
 };
 
 class BackendDX11 : public BackendInterface {
@@ -72,41 +166,84 @@ public:
 	{
 		return m_context.Get();
 	}
+    BackendFrameStats GetFrameStats() const override
+    {
+        return m_lastFrameStats;
+    }
 
     void SetPipelineState(const PipelineState& state) override;
     void SetScissorRect(int x, int y, int width, int height);
 
-    void* CreateTextureResource(int width, int height, int format, const void* initialData) override;
-    void* CreateTexture3DResource(int width, int height, int depth, int format, const void* initialData) override;
-    void* CreateTextureCubeResource(int width, int height, int format, const void** initialData) override;
-    void* CreateSamplerResource(const std::string& filterMode) override;
-    void CopyTexture(void* dstHandle, void* srcHandle) override;
-    void SetRenderTarget(void* target1, void* target2 = nullptr, void* target3 = nullptr, void* target4 = nullptr) override;
+    TextureHandle CreateTextureResource(int width, int height, int format, const void* initialData) override;
+    TextureHandle CreateSampledTexture(int width, int height, int format, const void* const* mipData, int mipCount, bool cube = false) override;
+    TextureHandle CreateTextureFromMips(TextureHandle source, int firstMip) override;
+    TextureHandle CreateTexture3DResource(int width, int height, int depth, int format, const void* initialData) override;
+    TextureHandle CreateTextureCubeResource(int width, int height, int format, const void** initialData) override;
+    SamplerHandle CreateSamplerResource(const std::string& filterMode) override;
+    void DestroyTexture(TextureHandle handle, uint32_t framesToWait = 0) override;
+    void DestroyBuffer(BufferHandle handle, uint32_t framesToWait = 0) override;
+    void DestroySampler(SamplerHandle handle, uint32_t framesToWait = 0) override;
+    void CopyTexture(TextureHandle dstHandle, TextureHandle srcHandle) override;
+    void SetRenderTarget(TextureHandle target1, TextureHandle target2 = TextureHandle(), TextureHandle target3 = TextureHandle(), TextureHandle target4 = TextureHandle()) override;
+    void SetRenderTargets(const TextureHandle* targets, int count, TextureHandle depth) override;
     void Clear(float r, float g, float b, float a) override;
-    void ClearTexture(void* textureHandle, float r, float g, float b, float a) override;
+    void ClearTexture(TextureHandle textureHandle, float r, float g, float b, float a) override;
     void ClearDepth(float depth, int stencil) override;
     void PrepareShaderPass(const ShaderPass& pass) override;
+    void PrepareShaderPassAsync(const ShaderPass& pass) override;
+    void PrepareShaderVariants(const ShaderPass& pass, bool immediate) override;
+    bool IsShaderPassReady(const ShaderPass& pass) override;
+    void SetFallbackShaderPass(const ShaderPass* pass) override;
     void SetShaderPass(const ShaderPass& pass) override;
-    void UpdateConstantRaw(const std::string& name, const void* data, size_t size) override;
+    void UpdateConstantRaw(ConstantId id, const void* data, size_t size) override;
     void UploadConstants(DX11ReflectionData& reflectionData, ShaderType SType);
     void DrawFullScreenQuad() override;
-    void* CreateVertexBuffer(const void* data, size_t size, int stride) override;
-    void* CreateIndexBuffer(const void* data, size_t size) override;
-    void* CreateInstanceBuffer(const void* data, size_t size, int stride) override;
-    void DrawMeshInstanced(void* vbHandle, void* ibHandle, int indexCount, void* instHandle, int instanceCount, int instanceStride) override;
-    void DrawMesh(void* vbHandle, void* ibHandle, int indexCount) override;
+    BufferHandle CreateVertexBuffer(const void* data, size_t size, int stride, VertexLayout layout = VertexLayout::Standard,
+                                    const PositionQuantization& quantization = PositionQuantization()) override;
+    BufferHandle CreateIndexBuffer(const void* data, size_t size, int indexSize = 4) override;
+    BufferHandle CreateInstanceBuffer(const void* data, size_t size, int stride) override;
+    BufferHandle CreateDynamicBuffer(size_t size, int stride) override;
+    bool UpdateDynamicBuffer(BufferHandle handle, const void* data, size_t size) override;
+    TransientAllocation AllocateTransient(const void* data, size_t size, uint32_t alignment = 16) override;
+    void DrawMeshInstanced(BufferHandle vbHandle, BufferHandle ibHandle, int indexCount, BufferHandle instHandle, int instanceCount, int instanceStride, int firstInstance = 0) override;
+    void DrawMesh(BufferHandle vbHandle, BufferHandle ibHandle, int indexCount) override;
 
 private:
     bool InitD3D(const BackendConfig& config);
     void InitQuadGeometry();
-    bool CompileShader(const std::string& path, const std::string& entry, const std::string& profile, ID3DBlob** outBlob);
-    DX11ReflectionData ReflectShader(ID3DBlob* blob);
-    void* CreateBufferInternal(const void* data, size_t size, UINT bindFlags);
+    //          
+    bool CompileShader(const std::string& path, const std::string& entry, const std::string& profile, const ShaderDefines& defines, ShaderCacheEntry& outShader);
+    void ReflectShader(ShaderCacheEntry& shader);
+    DX11ReflectionData BuildReflection(const ShaderCacheEntry& shader);
+    DX11CompiledPass& GetCompiledPass(const ShaderPass& pass);
+    uint32_t ResolveProgram(const ShaderPass& pass);
+    uint32_t FindOrCreateProgram(const ShaderPass& pass);
+    const DX11PassBindings* GetPassBindings(const ShaderPass& pass);
+    DX11PassBindings BuildPassBindings(const ShaderPass& pass, DX11ShaderWrapper& shader);
+    static TextureHandle GetBindingHandle(const DX11TextureBinding& binding);
+    CompiledShaderPass CompileShaderPass(const DX11ShaderSource& source, ShaderPermutationKey permutation);
+    void InstallShaderPass(DX11ShaderProgram& program, const CompiledShaderPass& compiled);
+    void QueueShaderVariant(uint32_t programId, ShaderPermutationKey permutation);
+    void InstallCompiledShaders();
+    bool CanDrawWithActiveShader();
+    BufferHandle CreateBufferInternal(const void* data, size_t size, UINT bindFlags, UINT stride);
     void CreateDepthResources(int width, int height);
-    void CreateInputLayoutFromShader(const std::vector<char>& shaderBytecode, ID3D11InputLayout** outLayout);
-    void SetRenderTargetsInternal(ID3D11RenderTargetView* rtvs[], int count);
+    void CreateInputLayoutFromShader(const ShaderCacheEntry& shader, VertexLayout layout, ID3D11InputLayout** outLayout);
+    //      layout   ; false -     
+    bool BindShadersForVertices(VertexLayout layout);
+    // PositionScale/PositionOffset   -     
+    void SetVertexBufferConstants(const DX11BufferWrapper& vb);
+    void SetRenderTargetsInternal(ID3D11RenderTargetView* rtvs[], ID3D11Resource* resources[], int count,
+        ID3D11DepthStencilView* depth = nullptr, ID3D11Texture2D* depthResource = nullptr);
     void ClearRTV(ID3D11RenderTargetView* rtv, float r, float g, float b, float a);
-    void UnbindResources();
+    void ResetBindingState();
+    void BindShaders(ID3D11InputLayout* layout, ID3D11VertexShader* vs, ID3D11PixelShader* ps);
+    void BindShaderResource(int stage, UINT slot, ID3D11ShaderResourceView* srv, ID3D11Resource* resource);
+    void BindSampler(int stage, UINT slot, ID3D11SamplerState* sampler);
+    void BindGeometry(UINT vertexBufferCount, ID3D11Buffer* const* vertexBuffers, const UINT* strides, ID3D11Buffer* indexBuffer, DXGI_FORMAT indexFormat);
+    bool IsBoundAsRenderTarget(ID3D11Resource* resource) const;
+    void UnbindRenderTargetHazards(ID3D11Resource* const* resources, int count);
+    static ID3D11Resource* GetTextureResource(const DX11TextureWrapper& texture);
     void InitRenderStates();
     ID3D11DepthStencilState* GetDepthState(CompareFunc func, bool write);
 
@@ -121,13 +258,40 @@ private:
     ComPtr<ID3D11Buffer> m_quadVertexBuffer;
     ComPtr<ID3D11Buffer> m_quadIndexBuffer;
 
-    std::vector<DX11TextureWrapper*> m_textures;
-    std::vector<DX11SamplerWrapper*> m_samplers;
-    std::map<std::string, DX11ShaderWrapper> m_shaderCache;
+    ResourcePool<DX11TextureWrapper, TextureHandle> m_textures;
+    ResourcePool<DX11BufferWrapper, BufferHandle> m_buffers;
+    ResourcePool<DX11SamplerWrapper, SamplerHandle> m_samplers;
+    //   EndFrame,     
+    uint64_t m_frameIndex = 0;
+
+    //     .    GPU 
+    // UploadFramesInFlight  (   DXGI  )
+    static constexpr uint64_t UploadRingSize = 8 * 1024 * 1024;
+    static constexpr uint64_t UploadFramesInFlight = 3;
+    UploadRing m_uploadRing;
+    BufferHandle m_uploadBuffer;
+    //   ;        .
+    // deque:       (DX11PassBindings::Shader),
+    //        
+    std::deque<DX11ShaderProgram> m_programs;
+    std::map<std::string, uint32_t> m_programIds;
+    uint32_t m_programGeneration = 0;
+    //    ,  ShaderCache   exe
+    ShaderCache m_shaderDiskCache;
+    //  .       EndFrame
+    static constexpr uint32_t ShaderCompileThreads = 4;
+    BackgroundCompileQueue<CompiledShaderPass> m_compileQueue;
+    std::vector<CompiledShaderPass> m_compiledShaders;
+    uint32_t m_pendingVariantCount = 0;
+    const ShaderPass* m_fallbackPass = nullptr;
+    bool m_activePassPending = false; //    , m_activeShader -   nullptr
     DX11ShaderWrapper* m_activeShader = nullptr;
 
-    struct StoredConstant { std::vector<uint8_t> Data; };
-    std::map<std::string, StoredConstant> m_cpuConstantsStorage;
+    ConstantStore m_constants;
+    //     ,    *Set* .   
+    DX11BindingState m_bindState = {};
+    BackendFrameStats m_frameStats;
+    BackendFrameStats m_lastFrameStats;
     ComPtr<ID3D11Buffer> m_cbVS;
     ComPtr<ID3D11Buffer> m_cbPS;
     size_t m_cbVSSize = 0;
@@ -164,8 +328,12 @@ private:
     struct DepthBufferCacheItem {
         ComPtr<ID3D11Texture2D> Texture;
         ComPtr<ID3D11DepthStencilView> DSV;
+        uint64_t LastUsedFrame = 0;
     };
 
+    //   ,      ,   EndFrame
+    static constexpr uint64_t DepthCacheKeepFrames = 120;
+
     // map   ,      
     std::map<uint64_t, DepthBufferCacheItem> m_depthCache;
 
@@ -1,5 +1,16 @@
 #pragma once
 #include "RendeructorDefines.h"
+#include "RendeructorVertexPacking.h"
+
+// Slice of the backend's per-frame upload ring
+struct TransientAllocation
+{
+    BufferHandle Buffer;
+    uint32_t Offset = 0;
+    uint32_t Size = 0;
+
+    bool IsValid() const { return Buffer.IsValid(); }
+};
 
 class BackendInterface
 {
@@ -15,31 +26,78 @@ public:
     virtual void* GetDevice() = 0;
 	virtual void* GetContext() = 0;
 
+    // Counters of the last presented frame
+    virtual BackendFrameStats GetFrameStats() const = 0;
+
     // State Management
     virtual void SetPipelineState(const PipelineState& state) = 0;
     virtual void SetScissorRect(int x, int y, int width, int height) = 0;
 
     // Resources
-    virtual void* CreateTextureResource(int width, int height, int format, const void* initialData) = 0;
-    virtual void* CreateSamplerResource(const std::string& filterMode) = 0;
-    virtual void* CreateTexture3DResource(int width, int height, int depth, int format, const void* initialData) = 0;
-    virtual void* CreateTextureCubeResource(int width, int height, int format, const void** initialData) = 0;
-    virtual void* CreateVertexBuffer(const void* data, size_t size, int stride) = 0;
-    virtual void* CreateIndexBuffer(const void* data, size_t size) = 0;
-    virtual void* CreateInstanceBuffer(const void* data, size_t size, int stride) = 0;
+    // Render target (and shader resource), a single mip level
+    virtual TextureHandle CreateTextureResource(int width, int height, int format, const void* initialData) = 0;
+    // Immutable shader-resource-only texture with mipCount levels, mipData[i] is level i packed
+    // tightly (row pitch = level width * pixel size, or a row of 4x4 blocks for BC formats).
+    // cube = 6 faces, mipData holds face 0 mips, then face 1 mips and so on. Can't be rendered
+    // to or copied into
+    virtual TextureHandle CreateSampledTexture(int width, int height, int format, const void* const* mipData, int mipCount, bool cube = false) = 0;
+    // Sampled 2D texture made of levels firstMip..last of source, copied on the GPU (no CPU data
+    // needed). Shader-read-only like CreateSampledTexture, but not immutable
+    virtual TextureHandle CreateTextureFromMips(TextureHandle source, int firstMip) = 0;
+    virtual SamplerHandle CreateSamplerResource(const std::string& filterMode) = 0;
+    virtual TextureHandle CreateTexture3DResource(int width, int height, int depth, int format, const void* initialData) = 0;
+    virtual TextureHandle CreateTextureCubeResource(int width, int height, int format, const void** initialData) = 0;
+    // layout tells the backend how to build input layouts for the buffer. A Compact buffer keeps
+    // its quantization: every draw from it sets PositionScale/PositionOffset, recorded ones too
+    virtual BufferHandle CreateVertexBuffer(const void* data, size_t size, int stride, VertexLayout layout = VertexLayout::Standard,
+                                            const PositionQuantization& quantization = PositionQuantization()) = 0;
+    // indexSize = 2 (uint16) or 4 (uint32) bytes per index
+    virtual BufferHandle CreateIndexBuffer(const void* data, size_t size, int indexSize = 4) = 0;
+    virtual BufferHandle CreateInstanceBuffer(const void* data, size_t size, int stride) = 0;
+    // CPU-writable vertex/instance buffer, refilled with UpdateDynamicBuffer (whole contents are replaced)
+    virtual BufferHandle CreateDynamicBuffer(size_t size, int stride) = 0;
+    virtual bool UpdateDynamicBuffer(BufferHandle handle, const void* data, size_t size) = 0;
+    // Copies data into the shared upload ring (vertex/instance data that lives for one frame).
+    // Offset is a multiple of alignment, so with alignment = stride it maps to firstInstance.
+    // The slice stays valid for draws issued this frame. Only an overflow (more than the whole
+    // ring in flight) renames the buffer memory and loses the slices handed out before it
+    virtual TransientAllocation AllocateTransient(const void* data, size_t size, uint32_t alignment = 16) = 0;
+
+    // framesToWait = 0 destroys immediately, otherwise the resource stays usable
+    // until that many frames have been presented
+    virtual void DestroyTexture(TextureHandle handle, uint32_t framesToWait = 0) = 0;
+    virtual void DestroyBuffer(BufferHandle handle, uint32_t framesToWait = 0) = 0;
+    virtual void DestroySampler(SamplerHandle handle, uint32_t framesToWait = 0) = 0;
 
     // Operations
-    virtual void CopyTexture(void* dstHandle, void* srcHandle) = 0;
-    virtual void SetRenderTarget(void* target1, void* target2 = nullptr, void* target3 = nullptr, void* target4 = nullptr) = 0;
+    virtual void CopyTexture(TextureHandle dstHandle, TextureHandle srcHandle) = 0;
+    virtual void SetRenderTarget(TextureHandle target1, TextureHandle target2 = TextureHandle(), TextureHandle target3 = TextureHandle(), TextureHandle target4 = TextureHandle()) = 0;
+    // Up to 4 color targets and an explicit depth texture (TextureFormat::Depth24Stencil8).
+    // count = 0 with a depth texture is a depth-only pass; an invalid depth picks the automatic one
+    virtual void SetRenderTargets(const TextureHandle* targets, int count, TextureHandle depth) = 0;
     virtual void Clear(float r, float g, float b, float a) = 0;
-    virtual void ClearTexture(void* textureHandle, float r, float g, float b, float a) = 0;
+    virtual void ClearTexture(TextureHandle textureHandle, float r, float g, float b, float a) = 0;
     virtual void ClearDepth(float depth, int stencil) = 0;
 
+    // Passes are looked up by the program index cached in the ShaderPass and the permutation key.
+    // Compiles on the calling thread (or loads from the shader cache) and installs the pass
     virtual void PrepareShaderPass(const ShaderPass& pass) = 0;
+    // Queues compilation on background threads and returns at once. The pass is installed at
+    // the end of a frame; until then SetShaderPass binds the fallback pass, or draws are skipped
+    virtual void PrepareShaderPassAsync(const ShaderPass& pass) = 0;
+    // The current permutation plus every ShaderPass::DeclareVariant one, compiled in parallel on
+    // the background threads. immediate = wait for them and install them before returning
+    virtual void PrepareShaderVariants(const ShaderPass& pass, bool immediate) = 0;
+    virtual bool IsShaderPassReady(const ShaderPass& pass) = 0;
+    // Compiled immediately and must stay alive while set. nullptr = skip draws of pending passes
+    virtual void SetFallbackShaderPass(const ShaderPass* pass) = 0;
+    // A variant that isn't compiled yet is queued like PrepareShaderPassAsync
     virtual void SetShaderPass(const ShaderPass& pass) = 0;
-    virtual void UpdateConstantRaw(const std::string& name, const void* data, size_t size) = 0;
+    // id is the name of a shader variable, or of a whole constant buffer
+    virtual void UpdateConstantRaw(ConstantId id, const void* data, size_t size) = 0;
 
     virtual void DrawFullScreenQuad() = 0;
-    virtual void DrawMesh(void* vbHandle, void* ibHandle, int indexCount) = 0;
-    virtual void DrawMeshInstanced(void* vbHandle, void* ibHandle, int indexCount, void* instHandle, int instanceCount, int instanceStride) = 0;
+    virtual void DrawMesh(BufferHandle vbHandle, BufferHandle ibHandle, int indexCount) = 0;
+    // firstInstance: index of the first element read from the instance buffer
+    virtual void DrawMeshInstanced(BufferHandle vbHandle, BufferHandle ibHandle, int indexCount, BufferHandle instHandle, int instanceCount, int instanceStride, int firstInstance = 0) = 0;
 };
@@ -1,7 +1,7 @@
 #pragma once
 #include "framework.h"
 
-void LogDebug(const char* format, ...) {
+inline void LogDebug(const char* format, ...) {
     char buffer[1024];
     va_list args;
     va_start(args, format);
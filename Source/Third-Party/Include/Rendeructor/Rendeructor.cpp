@@ -30,6 +30,7 @@ bool Rendeructor::Create(const BackendConfig& config) {
 }
 
 void Rendeructor::Destroy() {
+    ReleaseGraphTextures();
     if (m_backend) {
         m_backend->Shutdown();
         delete m_backend;
@@ -85,18 +86,31 @@ void Rendeructor::SetScissor(int x, int y, int width, int height) {
 }
 
 void Rendeructor::SetShaderPass(ShaderPass& pass) {
-    if (m_backend) {
-        m_backend->PrepareShaderPass(pass);
-        m_backend->SetShaderPass(pass);
-    }
+    if (m_backend) m_backend->SetShaderPass(pass);
 }
 
 void Rendeructor::CompilePass(ShaderPass& pass) {
+    if (m_backend) m_backend->PrepareShaderPassAsync(pass);
+}
+
+void Rendeructor::CompilePassImmediate(ShaderPass& pass) {
     if (m_backend) m_backend->PrepareShaderPass(pass);
 }
 
-void Rendeructor::SetCustomConstant(const std::string& bufferName, const void* data, size_t size) {
-    if (m_backend) m_backend->UpdateConstantRaw(bufferName, data, size);
+void Rendeructor::CompileVariants(ShaderPass& pass, bool waitForCompletion) {
+    if (m_backend) m_backend->PrepareShaderVariants(pass, waitForCompletion);
+}
+
+bool Rendeructor::IsPassReady(const ShaderPass& pass) const {
+    return m_backend && m_backend->IsShaderPassReady(pass);
+}
+
+void Rendeructor::SetFallbackPass(ShaderPass* pass) {
+    if (m_backend) m_backend->SetFallbackShaderPass(pass);
+}
+
+void Rendeructor::SetCustomConstant(ConstantId bufferId, const void* data, size_t size) {
+    if (m_backend) m_backend->UpdateConstantRaw(bufferId, data, size);
 }
 
 void Rendeructor::SetRenderTarget(const Texture& target1, const Texture& target2,
@@ -111,6 +125,14 @@ void Rendeructor::SetRenderTarget(const Texture& target1, const Texture& target2
     }
 }
 
+void Rendeructor::SetRenderTargetWithDepth(const Texture& depth, const Texture& target1,
+    const Texture& target2, const Texture& target3, const Texture& target4) {
+    if (m_backend) {
+        TextureHandle targets[4] = { target1.GetHandle(), target2.GetHandle(), target3.GetHandle(), target4.GetHandle() };
+        m_backend->SetRenderTargets(targets, 4, depth.GetHandle());
+    }
+}
+
 void Rendeructor::RenderPassToTexture(const Texture& target) {
     if (m_backend) {
         m_backend->SetRenderTarget(target.GetHandle());
@@ -120,7 +142,7 @@ void Rendeructor::RenderPassToTexture(const Texture& target) {
 
 void Rendeructor::RenderPassToScreen() {
     if (m_backend) {
-        m_backend->SetRenderTarget(nullptr, nullptr, nullptr, nullptr);
+        m_backend->SetRenderTarget(TextureHandle());
         m_backend->DrawFullScreenQuad();
     }
 }
@@ -166,7 +188,8 @@ void Rendeructor::DrawMeshInstanced(const Mesh& mesh, const InstanceBuffer& inst
             mesh.GetIndexCount(),
             instances.GetHandle(),
             instances.GetCount(),
-            instances.GetStride()
+            instances.GetStride(),
+            instances.GetFirstInstance()
         );
     }
 }
@@ -175,6 +198,85 @@ void Rendeructor::DrawFullScreenQuad() {
     if (m_backend) m_backend->DrawFullScreenQuad();
 }
 
+void Rendeructor::Submit(const RenderCommandBuffer& commands) {
+    if (m_backend) commands.Replay(*m_backend);
+}
+
+void Rendeructor::Submit(const RenderCommandBuffer* const* buffers, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (buffers[i]) Submit(*buffers[i]);
+    }
+}
+
+DrawQueueStats Rendeructor::Submit(const DrawQueue& queue) {
+    if (!m_backend) return DrawQueueStats();
+
+    DrawQueueStats stats = queue.Execute(*m_backend);
+    //      ,   
+    if (stats.FinalState) m_currentState = *stats.FinalState;
+    return stats;
+}
+
+RenderGraphTextureDesc Rendeructor::DescribeGraphTexture(int width, int height, TextureFormat format) {
+    RenderGraphTextureDesc desc;
+    desc.Width = width;
+    desc.Height = height;
+    desc.Format = (int)format;
+    switch (format) {
+    case TextureFormat::R8: desc.BytesPerPixel = 1; break;
+    case TextureFormat::R16F: desc.BytesPerPixel = 2; break;
+    case TextureFormat::RGBA16F: desc.BytesPerPixel = 8; break;
+    case TextureFormat::RGBA32F: desc.BytesPerPixel = 16; break;
+    default: desc.BytesPerPixel = 4; break;
+    }
+    return desc;
+}
+
+RenderGraphStats Rendeructor::Execute(RenderGraph<Texture>& graph) {
+    if (!m_backend) return RenderGraphStats();
+
+    //            .
+    //      LastUsed == m_graphExecutions
+    ++m_graphExecutions;
+    graph.Execute([this](const RenderGraphTextureDesc& desc) -> const Texture* {
+        for (auto& entry : m_graphTextures) {
+            if (entry->LastUsed != m_graphExecutions && entry->Desc == desc) {
+                entry->LastUsed = m_graphExecutions;
+                return &entry->Object;
+            }
+        }
+
+        auto entry = std::make_unique<GraphTexture>();
+        entry->Object.Create(desc.Width, desc.Height, (TextureFormat)desc.Format);
+        entry->Desc = desc;
+        entry->LastUsed = m_graphExecutions;
+        m_graphTextures.push_back(std::move(entry));
+        return &m_graphTextures.back()->Object;
+    });
+
+    // ,      ( ,  )
+    for (size_t i = 0; i < m_graphTextures.size();) {
+        if (m_graphExecutions - m_graphTextures[i]->LastUsed > GraphTextureKeepExecutions) {
+            m_graphTextures[i]->Object.Release();
+            m_graphTextures.erase(m_graphTextures.begin() + i);
+        }
+        else ++i;
+    }
+
+    return graph.GetStats();
+}
+
+uint64_t Rendeructor::GetGraphTextureBytes() const {
+    uint64_t bytes = 0;
+    for (const auto& entry : m_graphTextures) bytes += entry->Desc.GetSizeBytes();
+    return bytes;
+}
+
+void Rendeructor::ReleaseGraphTextures() {
+    for (auto& entry : m_graphTextures) entry->Object.Release();
+    m_graphTextures.clear();
+}
+
 void Rendeructor::Present() {
     if (m_backend) {
         m_backend->EndFrame();
@@ -1,6 +1,11 @@
 #pragma once
 #include "RendeructorDefines.h"
 #include "BackendInterface.h"
+#include "RendeructorCommandBuffer.h"
+#include "RendeructorDrawQueue.h"
+#include "RendeructorBatcher.h"
+#include "RendeructorRenderGraph.h"
+#include "RendeructorStreamer.h"
 
 class RENDER_API Rendeructor {
 public:
@@ -20,10 +25,20 @@ public:
 		return m_backend ? m_backend->GetContext() : nullptr;
 	}
 
+    // A pass that is not compiled yet is queued for background compilation; until it is
+    // ready (see IsPassReady) draws use the fallback pass, or are skipped without one
     void SetShaderPass(ShaderPass& pass);
     void CompilePass(ShaderPass& pass);
+    // Blocks until the pass is compiled, for loading screens and passes needed right away
+    void CompilePassImmediate(ShaderPass& pass);
+    // Batch-compiles every declared permutation of the pass (see ShaderPass::DeclareVariant).
+    // Run it at load time (or once in a build step) and the variants come from the shader cache
+    void CompileVariants(ShaderPass& pass, bool waitForCompletion = false);
+    bool IsPassReady(const ShaderPass& pass) const;
+    void SetFallbackPass(ShaderPass* pass);
 
     PipelineState GetPipelineState() const { return m_currentState; }
+    BackendFrameStats GetFrameStats() const { return m_backend ? m_backend->GetFrameStats() : BackendFrameStats(); }
     void SetPipelineState(const PipelineState& state);
     void SetCullMode(CullMode mode);
     void SetBlendMode(BlendMode mode);
@@ -31,20 +46,27 @@ public:
     void SetScissorEnabled(bool enabled);
     void SetScissor(int x, int y, int width, int height);
 
+    // Hot paths should pass a constexpr ConstantId, string names are hashed on every call
     template<typename T>
-    void SetConstant(const std::string& name, const T& value) {
-        if (m_backend) m_backend->UpdateConstantRaw(name, &value, sizeof(T));
+    void SetConstant(ConstantId id, const T& value) {
+        if (m_backend) m_backend->UpdateConstantRaw(id, &value, sizeof(T));
     }
-    void SetCustomConstant(const std::string& bufferName, const void* data, size_t size);
+    void SetCustomConstant(ConstantId bufferId, const void* data, size_t size);
     template <typename T>
-    void SetCustomConstant(const std::string& bufferName, const T& dataStructure) {
-        SetCustomConstant(bufferName, &dataStructure, sizeof(T));
+    void SetCustomConstant(ConstantId bufferId, const T& dataStructure) {
+        SetCustomConstant(bufferId, &dataStructure, sizeof(T));
     }
 
     void SetRenderTarget(const Texture& target1 = Texture(),
                          const Texture& target2 = Texture(),
                          const Texture& target3 = Texture(),
                          const Texture& target4 = Texture());
+    // depth is a TextureFormat::Depth24Stencil8 texture; without color targets it is a depth-only pass
+    void SetRenderTargetWithDepth(const Texture& depth,
+                                  const Texture& target1 = Texture(),
+                                  const Texture& target2 = Texture(),
+                                  const Texture& target3 = Texture(),
+                                  const Texture& target4 = Texture());
     void RenderPassToTexture(const Texture& target);
     void RenderPassToScreen();
     void Clear(float r, float g, float b, float a = 1.0f);
@@ -54,15 +76,43 @@ public:
     void ClearDepth(float depth = 1.0f, int stencil = 0);
 
     void DrawFullScreenQuad();
+    // One draw per call with the constants set so far; repeated meshes are merged by MeshBatcher
     void DrawMesh(const Mesh& mesh);
     void DrawMeshInstanced(const Mesh& mesh, const InstanceBuffer& instances);
+
+    // Replays recorded command buffers on the render thread. Buffers are executed in array
+    // order, so per-thread recordings come out the same no matter which thread finished first
+    void Submit(const RenderCommandBuffer& commands);
+    void Submit(const RenderCommandBuffer* const* buffers, size_t count);
+    // Executes a draw queue (sorted or not) with redundant pass/state changes removed
+    DrawQueueStats Submit(const DrawQueue& queue);
+
+    static RenderGraphTextureDesc DescribeGraphTexture(int width, int height, TextureFormat format);
+    // Compiles the graph if needed and runs its passes. Physical textures come from a pool kept
+    // between executions: a frame with the same graph creates nothing, and pooled textures no
+    // execution asked for in a while are released
+    RenderGraphStats Execute(RenderGraph<Texture>& graph);
+    // Memory held by the render graph texture pool right now
+    uint64_t GetGraphTextureBytes() const;
+
     void Present();
 
     static Rendeructor* GetCurrent();
     BackendInterface* GetBackendAPI() { return m_backend; }
 
 private:
+    struct GraphTexture {
+        Texture Object;
+        RenderGraphTextureDesc Desc;
+        uint64_t LastUsed = 0;
+    };
+    static constexpr uint64_t GraphTextureKeepExecutions = 120;
+
+    void ReleaseGraphTextures();
+
     BackendInterface* m_backend = nullptr;
+    std::vector<std::unique_ptr<GraphTexture>> m_graphTextures;
+    uint64_t m_graphExecutions = 0;
     PipelineState m_currentState;
     BackendConfig m_currentConfig;
     static Rendeructor* s_instance;
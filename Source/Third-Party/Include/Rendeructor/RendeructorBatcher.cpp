@@ -0,0 +1,115 @@
+﻿#include "pch.h"
+#include "RendeructorBatcher.h"
+#include "Rendeructor.h"
+#include "Log.h"
+
+size_t MeshBatcher::BatchKeyHash::operator()(const BatchKey& key) const {
+    size_t hash = std::hash<const void*>()(key.Pass);
+    auto combine = [&hash](size_t value) {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+    combine((size_t)(((uint64_t)key.VertexBuffer.Index << 32) | key.VertexBuffer.Generation));
+    combine((size_t)(((uint64_t)key.IndexBuffer.Index << 32) | key.IndexBuffer.Generation));
+    combine((size_t)key.IndexCount);
+    combine((size_t)key.MaterialId);
+    return hash;
+}
+
+void MeshBatcher::Add(const Mesh& mesh, ShaderPass& pass, const Math::float4x4& world, uint32_t materialId) {
+    BatchKey key = { mesh.GetVB(), mesh.GetIB(), mesh.GetIndexCount(), &pass, materialId };
+
+    auto it = m_batchIndex.find(key);
+    if (it == m_batchIndex.end()) {
+        it = m_batchIndex.emplace(key, (uint32_t)m_batches.size()).first;
+        m_batches.push_back({ key, {} });
+    }
+    m_batches[it->second].Instances.push_back(world);
+}
+
+void MeshBatcher::Flush(Rendeructor& renderer) {
+    m_lastDrawCalls = 0;
+    m_lastInstances = 0;
+
+    BackendInterface* backend = renderer.GetBackendAPI();
+    if (!backend || m_batches.empty()) {
+        m_batches.clear();
+        m_batchIndex.clear();
+        return;
+    }
+
+    // 1. Группируем батчи по шейдеру и материалу, чтобы переключать их как можно реже
+    std::sort(m_batches.begin(), m_batches.end(), [](const Batch& a, const Batch& b) {
+        if (a.Key.Pass != b.Key.Pass) return a.Key.Pass < b.Key.Pass;
+        return a.Key.MaterialId < b.Key.MaterialId;
+    });
+
+    // 2. Пакуем матрицы всех батчей подряд и копируем одним куском в кольцо бэкенда.
+    // Выравнивание по размеру матрицы, чтобы смещение переводилось в firstInstance
+    m_packed.clear();
+    for (const auto& batch : m_batches) {
+        m_packed.insert(m_packed.end(), batch.Instances.begin(), batch.Instances.end());
+    }
+
+    TransientAllocation slice = backend->AllocateTransient(m_packed.data(),
+        m_packed.size() * sizeof(Math::float4x4), sizeof(Math::float4x4));
+    if (!slice.IsValid()) {
+        // Одним куском не влезло (больше кольца): грузим каждый батч отдельно, делим при необходимости
+        LogDebug("[MeshBatcher] %zu instances don't fit one upload, drawing them in parts", m_packed.size());
+    }
+
+    // 3. Один DrawIndexedInstanced на батч, каждый читает свой участок буфера через firstInstance
+    ShaderPass* lastPass = nullptr;
+    uint32_t lastMaterial = 0xFFFFFFFFu;
+    int firstInstance = (int)(slice.Offset / sizeof(Math::float4x4));
+
+    for (const auto& batch : m_batches) {
+        int count = (int)batch.Instances.size();
+
+        if (batch.Key.Pass != lastPass) {
+            renderer.SetShaderPass(*batch.Key.Pass);
+            lastPass = batch.Key.Pass;
+            lastMaterial = 0xFFFFFFFFu;
+        }
+        if (m_materialBinder && batch.Key.MaterialId != lastMaterial) {
+            m_materialBinder(renderer, batch.Key.MaterialId);
+            lastMaterial = batch.Key.MaterialId;
+        }
+
+        if (!slice.IsValid()) {
+            if (!DrawSplit(*backend, batch, 0, batch.Instances.size())) {
+                LogDebug("[MeshBatcher] Instance upload failed, %zu instances of this frame are not drawn",
+                    m_packed.size() - m_lastInstances);
+                break;
+            }
+            continue;
+        }
+
+        backend->DrawMeshInstanced(batch.Key.VertexBuffer, batch.Key.IndexBuffer, batch.Key.IndexCount,
+            slice.Buffer, count, (int)sizeof(Math::float4x4), firstInstance);
+
+        firstInstance += count;
+        m_lastInstances += count;
+        ++m_lastDrawCalls;
+    }
+
+    m_batches.clear();
+    m_batchIndex.clear();
+}
+
+bool MeshBatcher::DrawSplit(BackendInterface& backend, const Batch& batch, size_t first, size_t count) {
+    TransientAllocation slice = backend.AllocateTransient(batch.Instances.data() + first,
+        count * sizeof(Math::float4x4), sizeof(Math::float4x4));
+    if (slice.IsValid()) {
+        // Рисуем сразу: следующая загрузка может переполнить кольцо и подменить его память,
+        // а уже выданная отрисовка читает старую
+        backend.DrawMeshInstanced(batch.Key.VertexBuffer, batch.Key.IndexBuffer, batch.Key.IndexCount,
+            slice.Buffer, (int)count, (int)sizeof(Math::float4x4), (int)(slice.Offset / sizeof(Math::float4x4)));
+        m_lastInstances += (uint32_t)count;
+        ++m_lastDrawCalls;
+        return true;
+    }
+    if (count <= 1) return false;
+
+    size_t half = count / 2;
+    return DrawSplit(backend, batch, first, half) && DrawSplit(backend, batch, first + half, count - half);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "RendeructorDefines.h"
+#include <functional>
+#include <unordered_map>
+
+class Rendeructor;
+class BackendInterface;
+
+// Collects DrawMesh calls over a frame and merges the ones that share mesh buffers, shader
+// pass and material into a single DrawIndexedInstanced. World matrices of a batch are packed
+// into one slice of the backend's upload ring (AllocateTransient) once per Flush().
+//
+// The pass must read the matrix from the instance stream: four float4 rows with semantics
+// INSTANCE_WORLD0..INSTANCE_WORLD3, in the same memory layout as SetConstant("World", m).
+//
+// Batching is explicit rather than done inside Rendeructor::DrawMesh: DrawMesh draws with
+// whatever constants were set before it (World included) and with a pass that reads them from
+// constant buffers, so merging those calls would need a copy of every constant per draw and a
+// different shader. Add() takes the world matrix as data and the pass is chosen for instancing.
+class RENDER_API MeshBatcher
+{
+  public:
+	MeshBatcher() = default;
+
+	// pass and mesh must stay alive until Flush()
+	void Add(const Mesh& mesh, ShaderPass& pass, const Math::float4x4& world, uint32_t materialId = 0);
+
+	// Called before the first batch of each material, to set its constants/textures
+	void SetMaterialBinder(std::function<void(Rendeructor&, uint32_t)> binder)
+	{
+		m_materialBinder = std::move(binder);
+	}
+
+	// Uploads all instances and issues one instanced draw per batch, then clears the batches.
+	// Instances that don't fit one upload ring slice are uploaded and drawn in parts
+	void Flush(Rendeructor& renderer);
+
+	uint32_t GetLastDrawCallCount() const
+	{
+		return m_lastDrawCalls;
+	}
+	uint32_t GetLastInstanceCount() const
+	{
+		return m_lastInstances;
+	}
+
+  private:
+	struct BatchKey
+	{
+		BufferHandle VertexBuffer;
+		BufferHandle IndexBuffer;
+		int IndexCount;
+		ShaderPass* Pass;
+		uint32_t MaterialId;
+
+		bool operator==(const BatchKey& other) const
+		{
+			return VertexBuffer == other.VertexBuffer && IndexBuffer == other.IndexBuffer &&
+				   IndexCount == other.IndexCount && Pass == other.Pass && MaterialId == other.MaterialId;
+		}
+	};
+
+	struct BatchKeyHash
+	{
+		size_t operator()(const BatchKey& key) const;
+	};
+
+	struct Batch
+	{
+		BatchKey Key;
+		std::vector<Math::float4x4> Instances;
+	};
+
+	// Draws instances [first, first + count) of a batch from their own slice, halving the range
+	// while it doesn't fit. false if not even one matrix could be uploaded
+	bool DrawSplit(BackendInterface& backend, const Batch& batch, size_t first, size_t count);
+
+	std::unordered_map<BatchKey, uint32_t, BatchKeyHash> m_batchIndex;
+	std::vector<Batch> m_batches;
+	std::vector<Math::float4x4> m_packed;
+	std::function<void(Rendeructor&, uint32_t)> m_materialBinder;
+
+	uint32_t m_lastDrawCalls = 0;
+	uint32_t m_lastInstances = 0;
+};
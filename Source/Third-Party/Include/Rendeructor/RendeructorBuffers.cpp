@@ -3,9 +3,34 @@
 #include "BackendDX11.h"
 
 void InstanceBuffer::Create(const void* data, int count, int stride) {
+    Release();
     m_count = count;
     m_stride = stride;
     if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
         m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateInstanceBuffer(data, count * stride, stride);
     }
 }
+
+void InstanceBuffer::CreateTransient(const void* data, int count, int stride) {
+    Release();
+    m_count = count;
+    m_stride = stride;
+    if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        TransientAllocation slice = Rendeructor::GetCurrent()->GetBackendAPI()->AllocateTransient(data, (size_t)count * stride, stride);
+        if (slice.IsValid()) {
+            m_backendHandle = slice.Buffer;
+            m_firstInstance = (int)(slice.Offset / stride);
+            m_transient = true;
+        }
+    }
+}
+
+void InstanceBuffer::Release(uint32_t framesToWait) {
+    // The ring buffer belongs to the backend, a transient slice just expires with the frame
+    if (!m_transient && m_backendHandle.IsValid() && Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        Rendeructor::GetCurrent()->GetBackendAPI()->DestroyBuffer(m_backendHandle, framesToWait);
+    }
+    m_backendHandle = BufferHandle();
+    m_firstInstance = 0;
+    m_transient = false;
+}
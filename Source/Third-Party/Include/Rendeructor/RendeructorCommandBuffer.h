@@ -0,0 +1,282 @@
+#pragma once
+
+#include "RendeructorConstants.h"
+#include "RendeructorHandles.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+class ShaderPass;
+
+enum class RenderCommandType : uint32_t
+{
+	SetPass,
+	SetConstants,
+	SetRenderTarget,
+	Clear,
+	ClearDepth,
+	Draw,
+	DrawInstanced,
+	DrawFullScreenQuad
+};
+
+// Command payloads. Everything is POD so a command is a plain byte copy on record and replay.
+namespace RenderCommands
+{
+	struct SetPass
+	{
+		const ShaderPass* Pass; // Must stay alive until the buffer is submitted
+	};
+
+	// Followed by Size bytes of constant data
+	struct SetConstants
+	{
+		uint32_t NameHash;
+		uint32_t Size;
+	};
+
+	struct SetRenderTarget
+	{
+		TextureHandle Targets[4]; // Targets[0] invalid = back buffer
+	};
+
+	struct Clear
+	{
+		TextureHandle Target; // Invalid = current render target
+		float Color[4];
+	};
+
+	struct ClearDepth
+	{
+		float Depth;
+		int Stencil;
+	};
+
+	struct Draw
+	{
+		BufferHandle VertexBuffer;
+		BufferHandle IndexBuffer;
+		int IndexCount;
+	};
+
+	struct DrawInstanced
+	{
+		BufferHandle VertexBuffer;
+		BufferHandle IndexBuffer;
+		BufferHandle InstanceBuffer;
+		int IndexCount;
+		int InstanceCount;
+		int InstanceStride;
+		int FirstInstance;
+	};
+
+	struct DrawFullScreenQuad
+	{
+	};
+} // namespace RenderCommands
+
+// Linear, backend-agnostic list of render commands. A buffer is owned by one thread while
+// recording, so workers record into their own buffers without locks; the render thread then
+// submits them (Rendeructor::Submit) in a fixed order, which keeps the result deterministic
+// regardless of which worker finished first.
+class RenderCommandBuffer
+{
+  public:
+	struct CommandHeader
+	{
+		RenderCommandType Type;
+		uint32_t Size; // Header + payload, rounded up to CommandAlignment
+	};
+
+	static constexpr size_t CommandAlignment = 8;
+
+	void SetPass(const ShaderPass& pass)
+	{
+		RenderCommands::SetPass cmd = {&pass};
+		Push(RenderCommandType::SetPass, cmd);
+	}
+
+	// Same semantics as Rendeructor::SetConstant / SetCustomConstant, the value is copied now
+	void SetConstants(ConstantId id, const void* data, size_t size)
+	{
+		RenderCommands::SetConstants cmd = {id.Hash, (uint32_t)size};
+		Push(RenderCommandType::SetConstants, cmd, data, size);
+	}
+	template <typename T>
+	void SetConstant(ConstantId id, const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Constants are copied as raw bytes");
+		SetConstants(id, &value, sizeof(T));
+	}
+
+	void SetRenderTarget(TextureHandle target1, TextureHandle target2 = TextureHandle(),
+						 TextureHandle target3 = TextureHandle(), TextureHandle target4 = TextureHandle())
+	{
+		RenderCommands::SetRenderTarget cmd = {{target1, target2, target3, target4}};
+		Push(RenderCommandType::SetRenderTarget, cmd);
+	}
+
+	void Clear(float r, float g, float b, float a = 1.0f)
+	{
+		ClearTexture(TextureHandle(), r, g, b, a);
+	}
+	void ClearTexture(TextureHandle target, float r, float g, float b, float a = 1.0f)
+	{
+		RenderCommands::Clear cmd = {target, {r, g, b, a}};
+		Push(RenderCommandType::Clear, cmd);
+	}
+	void ClearDepth(float depth = 1.0f, int stencil = 0)
+	{
+		RenderCommands::ClearDepth cmd = {depth, stencil};
+		Push(RenderCommandType::ClearDepth, cmd);
+	}
+
+	void DrawMesh(BufferHandle vertexBuffer, BufferHandle indexBuffer, int indexCount)
+	{
+		RenderCommands::Draw cmd = {vertexBuffer, indexBuffer, indexCount};
+		Push(RenderCommandType::Draw, cmd);
+	}
+	void DrawMeshInstanced(BufferHandle vertexBuffer, BufferHandle indexBuffer, int indexCount,
+						   BufferHandle instanceBuffer, int instanceCount, int instanceStride, int firstInstance = 0)
+	{
+		RenderCommands::DrawInstanced cmd = {vertexBuffer, indexBuffer, instanceBuffer,
+											 indexCount, instanceCount, instanceStride, firstInstance};
+		Push(RenderCommandType::DrawInstanced, cmd);
+	}
+	void DrawFullScreenQuad()
+	{
+		Push(RenderCommandType::DrawFullScreenQuad, RenderCommands::DrawFullScreenQuad());
+	}
+
+	// Appends all commands of another buffer (merging per-thread buffers into one)
+	void Append(const RenderCommandBuffer& other)
+	{
+		m_data.insert(m_data.end(), other.m_data.begin(), other.m_data.end());
+		m_commandCount += other.m_commandCount;
+	}
+
+	// Drops the commands but keeps the memory, so a buffer reused every frame stops allocating
+	void Reset()
+	{
+		m_data.clear();
+		m_commandCount = 0;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_commandCount == 0;
+	}
+	size_t GetCommandCount() const
+	{
+		return m_commandCount;
+	}
+	size_t GetSizeBytes() const
+	{
+		return m_data.size();
+	}
+	size_t GetCapacityBytes() const
+	{
+		return m_data.capacity();
+	}
+
+	// Issues every command on the backend in recording order. TBackend is BackendInterface
+	// in the renderer; any type with the same methods works, e.g. a recording mock in tests.
+	template <typename TBackend>
+	void Replay(TBackend& backend) const
+	{
+		const uint8_t* cursor = m_data.data();
+		const uint8_t* end = cursor + m_data.size();
+		while (cursor < end)
+		{
+			CommandHeader header;
+			memcpy(&header, cursor, sizeof(header));
+			const uint8_t* payload = cursor + sizeof(CommandHeader);
+
+			switch (header.Type)
+			{
+			case RenderCommandType::SetPass: {
+				auto cmd = Read<RenderCommands::SetPass>(payload);
+				backend.SetShaderPass(*cmd.Pass);
+				break;
+			}
+			case RenderCommandType::SetConstants: {
+				auto cmd = Read<RenderCommands::SetConstants>(payload);
+				ConstantId id;
+				id.Hash = cmd.NameHash;
+				backend.UpdateConstantRaw(id, payload + sizeof(cmd), cmd.Size);
+				break;
+			}
+			case RenderCommandType::SetRenderTarget: {
+				auto cmd = Read<RenderCommands::SetRenderTarget>(payload);
+				backend.SetRenderTarget(cmd.Targets[0], cmd.Targets[1], cmd.Targets[2], cmd.Targets[3]);
+				break;
+			}
+			case RenderCommandType::Clear: {
+				auto cmd = Read<RenderCommands::Clear>(payload);
+				if (cmd.Target.IsValid())
+					backend.ClearTexture(cmd.Target, cmd.Color[0], cmd.Color[1], cmd.Color[2], cmd.Color[3]);
+				else
+					backend.Clear(cmd.Color[0], cmd.Color[1], cmd.Color[2], cmd.Color[3]);
+				break;
+			}
+			case RenderCommandType::ClearDepth: {
+				auto cmd = Read<RenderCommands::ClearDepth>(payload);
+				backend.ClearDepth(cmd.Depth, cmd.Stencil);
+				break;
+			}
+			case RenderCommandType::Draw: {
+				auto cmd = Read<RenderCommands::Draw>(payload);
+				backend.DrawMesh(cmd.VertexBuffer, cmd.IndexBuffer, cmd.IndexCount);
+				break;
+			}
+			case RenderCommandType::DrawInstanced: {
+				auto cmd = Read<RenderCommands::DrawInstanced>(payload);
+				backend.DrawMeshInstanced(cmd.VertexBuffer, cmd.IndexBuffer, cmd.IndexCount, cmd.InstanceBuffer,
+										  cmd.InstanceCount, cmd.InstanceStride, cmd.FirstInstance);
+				break;
+			}
+			case RenderCommandType::DrawFullScreenQuad:
+				backend.DrawFullScreenQuad();
+				break;
+			}
+
+			cursor += header.Size;
+		}
+	}
+
+  private:
+	template <typename T>
+	void Push(RenderCommandType type, const T& command, const void* extra = nullptr, size_t extraSize = 0)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Render commands must be POD");
+
+		size_t payloadSize = std::is_empty_v<T> ? 0 : sizeof(T);
+		size_t size = sizeof(CommandHeader) + payloadSize + extraSize;
+		size = (size + CommandAlignment - 1) & ~(CommandAlignment - 1);
+
+		size_t offset = m_data.size();
+		m_data.resize(offset + size);
+		uint8_t* dst = m_data.data() + offset;
+
+		CommandHeader header = {type, (uint32_t)size};
+		memcpy(dst, &header, sizeof(header));
+		if (payloadSize)
+			memcpy(dst + sizeof(header), &command, payloadSize);
+		if (extraSize)
+			memcpy(dst + sizeof(header) + payloadSize, extra, extraSize);
+		++m_commandCount;
+	}
+
+	template <typename T>
+	static T Read(const uint8_t* payload)
+	{
+		T value;
+		memcpy(&value, payload, sizeof(T));
+		return value;
+	}
+
+	std::vector<uint8_t> m_data;
+	size_t m_commandCount = 0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small worker pool for slow jobs whose results must be consumed on one thread, e.g. shader
+// compilation: jobs run on the workers, results wait in a list until the owner collects them
+// at a point where installing them is safe (a frame boundary). A result should identify its
+// job. Knows nothing about the graphics API.
+template <typename TResult>
+class BackgroundCompileQueue
+{
+  public:
+	using Job = std::function<TResult()>;
+
+	BackgroundCompileQueue() = default;
+	BackgroundCompileQueue(const BackgroundCompileQueue&) = delete;
+	BackgroundCompileQueue& operator=(const BackgroundCompileQueue&) = delete;
+
+	~BackgroundCompileQueue()
+	{
+		Stop();
+	}
+
+	void Start(uint32_t threadCount)
+	{
+		if (!m_workers.empty())
+			return;
+		if (threadCount == 0)
+			threadCount = 1;
+
+		m_stopping = false;
+		for (uint32_t i = 0; i < threadCount; ++i)
+			m_workers.emplace_back([this]() { WorkerLoop(); });
+	}
+
+	// Jobs that haven't started are dropped, running ones are waited for. Results not yet
+	// collected are dropped too.
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+			m_jobs.clear();
+		}
+		m_wakeUp.notify_all();
+		m_idle.notify_all();
+		for (auto& worker : m_workers)
+			worker.join();
+		m_workers.clear();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_completed.clear();
+		m_running = 0;
+	}
+
+	bool IsRunning() const
+	{
+		return !m_workers.empty();
+	}
+
+	void Enqueue(Job job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(std::move(job));
+		}
+		m_wakeUp.notify_one();
+	}
+
+	// Moves out everything finished since the last call, in completion order
+	void TakeCompleted(std::vector<TResult>& out)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& result : m_completed)
+			out.push_back(std::move(result));
+		m_completed.clear();
+	}
+
+	// Jobs queued or running (finished but not collected ones are not counted)
+	size_t GetInFlightCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_jobs.size() + m_running;
+	}
+
+	// Blocks until every queued job has finished; results still have to be collected
+	void WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle.wait(lock, [this]() { return (m_jobs.empty() && m_running == 0) || m_stopping; });
+	}
+
+	// Blocks until a result is waiting to be collected or nothing is left to run, so the owner
+	// can consume results while later jobs are still running
+	void WaitForResults()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle.wait(lock, [this]() { return !m_completed.empty() || (m_jobs.empty() && m_running == 0) || m_stopping; });
+	}
+
+  private:
+	void WorkerLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			m_wakeUp.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+			if (m_stopping)
+				return;
+
+			Job job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			++m_running;
+
+			lock.unlock();
+			TResult result = job();
+			lock.lock();
+
+			--m_running;
+			m_completed.push_back(std::move(result));
+			m_idle.notify_all();
+		}
+	}
+
+	std::vector<std::thread> m_workers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_idle;
+	std::deque<Job> m_jobs;
+	std::vector<TResult> m_completed;
+	size_t m_running = 0;
+	bool m_stopping = false;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Name of a shader constant or constant buffer, stored as its 32-bit FNV-1a hash.
+// Literals are hashed at compile time: constexpr ConstantId WorldId("World");
+struct ConstantId
+{
+	static constexpr uint32_t FnvOffsetBasis = 2166136261u;
+	static constexpr uint32_t FnvPrime = 16777619u;
+
+	uint32_t Hash = 0;
+
+	constexpr ConstantId() = default;
+	constexpr ConstantId(const char* name) : Hash(HashName(name))
+	{
+	}
+	ConstantId(const std::string& name) : Hash(HashName(name))
+	{
+	}
+
+	static constexpr uint32_t HashName(std::string_view name)
+	{
+		uint32_t hash = FnvOffsetBasis;
+		for (char c : name)
+		{
+			hash ^= (uint8_t)c;
+			hash *= FnvPrime;
+		}
+		return hash;
+	}
+
+	bool operator==(const ConstantId& other) const
+	{
+		return Hash == other.Hash;
+	}
+	bool operator!=(const ConstantId& other) const
+	{
+		return Hash != other.Hash;
+	}
+};
+
+// A reflected variable (or a whole constant buffer) resolved to its range in the shadow buffer.
+// ValueSlot is looked up in the ConstantStore on first use and cached, SeenVersion is the
+// version of the value last copied into the shadow buffer.
+struct ConstantBinding
+{
+	uint32_t NameHash = 0;
+	uint32_t Offset = 0;
+	uint32_t Size = 0;
+	uint32_t ValueSlot = 0xFFFFFFFFu;
+	uint32_t SeenVersion = 0;
+};
+
+// Latest value of every constant set by the application, keyed by name hash.
+// Values live in one arena: after the first Set() of a name, setting it again is
+// a hash lookup plus a memcpy, with no allocation.
+class ConstantStore
+{
+  public:
+	static constexpr uint32_t InvalidSlot = 0xFFFFFFFFu;
+
+	void Set(ConstantId id, const void* data, size_t size)
+	{
+		uint32_t slotIndex;
+		auto it = m_slotByHash.find(id.Hash);
+		if (it != m_slotByHash.end())
+		{
+			slotIndex = it->second;
+		}
+		else
+		{
+			slotIndex = (uint32_t)m_slots.size();
+			m_slots.emplace_back();
+			m_slotByHash.emplace(id.Hash, slotIndex);
+		}
+
+		Slot& slot = m_slots[slotIndex];
+		if (size > slot.Capacity)
+		{
+			// Grown values get a fresh range, the old one is abandoned (rare: a name changed type)
+			slot.Offset = (uint32_t)m_data.size();
+			slot.Capacity = (uint32_t)size;
+			m_data.resize(m_data.size() + size);
+		}
+		memcpy(m_data.data() + slot.Offset, data, size);
+		slot.Size = (uint32_t)size;
+		// 0 is reserved for "never seen" in ConstantBinding
+		if (++slot.Version == 0)
+			slot.Version = 1;
+	}
+
+	uint32_t FindSlot(uint32_t nameHash) const
+	{
+		auto it = m_slotByHash.find(nameHash);
+		return it != m_slotByHash.end() ? it->second : InvalidSlot;
+	}
+
+	// Copies the value into the shadow buffer if it changed since the binding last saw it.
+	// Returns true if the shadow buffer was modified.
+	bool Apply(ConstantBinding& binding, uint8_t* shadowData, size_t shadowSize)
+	{
+		if (binding.ValueSlot == InvalidSlot)
+		{
+			binding.ValueSlot = FindSlot(binding.NameHash);
+			if (binding.ValueSlot == InvalidSlot)
+				return false;
+		}
+
+		const Slot& slot = m_slots[binding.ValueSlot];
+		if (slot.Version == binding.SeenVersion)
+			return false;
+		binding.SeenVersion = slot.Version;
+
+		size_t copySize = slot.Size < binding.Size ? slot.Size : binding.Size;
+		if (binding.Offset + copySize > shadowSize)
+			return false;
+
+		memcpy(shadowData + binding.Offset, m_data.data() + slot.Offset, copySize);
+		return true;
+	}
+
+	void Clear()
+	{
+		m_slotByHash.clear();
+		m_slots.clear();
+		m_data.clear();
+	}
+
+	size_t GetCount() const
+	{
+		return m_slots.size();
+	}
+
+  private:
+	struct Slot
+	{
+		uint32_t Offset = 0;
+		uint32_t Capacity = 0;
+		uint32_t Size = 0;
+		uint32_t Version = 0;
+	};
+
+	std::unordered_map<uint32_t, uint32_t> m_slotByHash;
+	std::vector<Slot> m_slots;
+	std::vector<uint8_t> m_data;
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Pixel formats a DDS file can be uploaded in as-is. _SRGB variants map to the same value with
+// DdsImage::Srgb set
+enum class DdsFormat
+{
+	Unknown,
+	RGBA8,
+	BGRA8,
+	BGRX8,
+	RGBA16F,
+	RGBA32F,
+	BC1,
+	BC2,
+	BC3,
+	BC4,
+	BC5,
+	BC6H,
+	BC7
+};
+
+// One mip level of one array slice (cube face). Data points into the parsed file buffer
+struct DdsSubresource
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	uint32_t RowPitch = 0; // Bytes per row of pixels, or per row of 4x4 blocks
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+};
+
+struct DdsImage
+{
+	DdsFormat Format = DdsFormat::Unknown;
+	bool Srgb = false;
+	bool IsCube = false;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 0;
+	uint32_t ArraySize = 0; // Slices; a cube has 6 per element
+	// Slice-major, mip-minor: the subresource order of D3D
+	std::vector<DdsSubresource> Subresources;
+
+	const DdsSubresource& Get(uint32_t slice, uint32_t mip) const
+	{
+		return Subresources[slice * MipCount + mip];
+	}
+};
+
+// DDS container parser: legacy headers (DXT1-5, ATI1/ATI2, 32-bit RGB masks) and the DX10
+// extension (DXGI format, arrays, cubes). Block-compressed data is left compressed, the
+// caller uploads the subresources directly. Volume textures are rejected.
+class DdsParser
+{
+  public:
+	static bool IsBlockCompressed(DdsFormat format)
+	{
+		return format >= DdsFormat::BC1;
+	}
+
+	// Bytes per 4x4 block for BC formats, per pixel otherwise
+	static uint32_t GetElementBytes(DdsFormat format)
+	{
+		switch (format)
+		{
+		case DdsFormat::BC1:
+		case DdsFormat::BC4:
+			return 8;
+		case DdsFormat::BC2:
+		case DdsFormat::BC3:
+		case DdsFormat::BC5:
+		case DdsFormat::BC6H:
+		case DdsFormat::BC7:
+			return 16;
+		case DdsFormat::RGBA16F:
+			return 8;
+		case DdsFormat::RGBA32F:
+			return 16;
+		case DdsFormat::Unknown:
+			return 0;
+		default:
+			return 4;
+		}
+	}
+
+	static uint32_t GetRowPitch(DdsFormat format, uint32_t width)
+	{
+		if (IsBlockCompressed(format))
+			return BlockCount(width) * GetElementBytes(format);
+		return width * GetElementBytes(format);
+	}
+
+	static uint32_t GetRowCount(DdsFormat format, uint32_t height)
+	{
+		return IsBlockCompressed(format) ? BlockCount(height) : height;
+	}
+
+	// data must outlive the image, subresources point into it
+	static bool Parse(const uint8_t* data, size_t size, DdsImage& image, std::string* error = nullptr)
+	{
+		image = DdsImage();
+		if (!data || size < 4 + HeaderSize || Read32(data) != Magic)
+			return Fail(error, "not a DDS file");
+
+		const uint8_t* header = data + 4;
+		uint32_t flags = Read32(header + 4);
+		uint32_t height = Read32(header + 8);
+		uint32_t width = Read32(header + 12);
+		uint32_t mipCount = Read32(header + 24);
+		const uint8_t* pixelFormat = header + 72;
+		uint32_t pfFlags = Read32(pixelFormat + 4);
+		uint32_t fourCC = Read32(pixelFormat + 8);
+		uint32_t caps2 = Read32(header + 108);
+
+		if (width == 0 || height == 0 || width > MaxDimension || height > MaxDimension)
+			return Fail(error, "bad size");
+		if ((flags & FlagDepth) && (caps2 & Caps2Volume))
+			return Fail(error, "volume textures are not supported");
+		if (!(flags & FlagMipCount) || mipCount == 0)
+			mipCount = 1;
+		if (mipCount > 32)
+			return Fail(error, "bad mip count");
+
+		size_t offset = 4 + HeaderSize;
+		uint32_t arraySize = 1;
+
+		if ((pfFlags & PfFourCC) && fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			if (size < offset + Dx10HeaderSize)
+				return Fail(error, "truncated DX10 header");
+			const uint8_t* dx10 = data + offset;
+			uint32_t dxgiFormat = Read32(dx10);
+			uint32_t dimension = Read32(dx10 + 4);
+			uint32_t miscFlag = Read32(dx10 + 8);
+			arraySize = Read32(dx10 + 12);
+			offset += Dx10HeaderSize;
+
+			if (dimension != Dx10Texture2D)
+				return Fail(error, "only 2D textures are supported");
+			if (arraySize == 0 || arraySize > MaxArraySize)
+				return Fail(error, "bad array size");
+			if (!FromDxgi(dxgiFormat, image.Format, image.Srgb))
+				return Fail(error, "unsupported DXGI format " + std::to_string(dxgiFormat));
+			if (miscFlag & Dx10MiscCube)
+			{
+				image.IsCube = true;
+				arraySize *= 6;
+			}
+		}
+		else
+		{
+			image.Format = FromLegacy(pixelFormat);
+			if (image.Format == DdsFormat::Unknown)
+				return Fail(error, "unsupported legacy pixel format");
+			if (caps2 & Caps2Cube)
+			{
+				if ((caps2 & Caps2AllFaces) != Caps2AllFaces)
+					return Fail(error, "partial cube maps are not supported");
+				image.IsCube = true;
+				arraySize = 6;
+			}
+		}
+
+		if (image.IsCube && width != height)
+			return Fail(error, "cube faces must be square");
+
+		image.Width = width;
+		image.Height = height;
+		image.MipCount = mipCount;
+		image.ArraySize = arraySize;
+		image.Subresources.reserve((size_t)arraySize * mipCount);
+
+		for (uint32_t slice = 0; slice < arraySize; ++slice)
+		{
+			uint32_t w = width, h = height;
+			for (uint32_t mip = 0; mip < mipCount; ++mip)
+			{
+				DdsSubresource sub;
+				sub.Width = w;
+				sub.Height = h;
+				sub.RowPitch = GetRowPitch(image.Format, w);
+				sub.Size = (size_t)sub.RowPitch * GetRowCount(image.Format, h);
+				if (offset + sub.Size > size)
+					return Fail(error, "truncated pixel data");
+				sub.Data = data + offset;
+				offset += sub.Size;
+				image.Subresources.push_back(sub);
+
+				w = w > 1 ? w / 2 : 1;
+				h = h > 1 ? h / 2 : 1;
+			}
+		}
+		return true;
+	}
+
+  private:
+	static constexpr uint32_t Magic = 0x20534444; // "DDS "
+	static constexpr size_t HeaderSize = 124;
+	static constexpr size_t Dx10HeaderSize = 20;
+	static constexpr uint32_t MaxDimension = 16384; // D3D11 limits, also keep the size math in range
+	static constexpr uint32_t MaxArraySize = 2048;
+	static constexpr uint32_t FlagMipCount = 0x20000;
+	static constexpr uint32_t FlagDepth = 0x800000;
+	static constexpr uint32_t PfAlphaPixels = 0x1;
+	static constexpr uint32_t PfFourCC = 0x4;
+	static constexpr uint32_t PfRGB = 0x40;
+	static constexpr uint32_t Caps2Cube = 0x200;
+	static constexpr uint32_t Caps2AllFaces = 0xFC00;
+	static constexpr uint32_t Caps2Volume = 0x200000;
+	static constexpr uint32_t Dx10Texture2D = 3;
+	static constexpr uint32_t Dx10MiscCube = 0x4;
+
+	static constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	static uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	static uint32_t BlockCount(uint32_t pixels)
+	{
+		return pixels > 0 ? (pixels + 3) / 4 : 1;
+	}
+
+	static bool Fail(std::string* error, const std::string& message)
+	{
+		if (error)
+			*error = message;
+		return false;
+	}
+
+	static DdsFormat FromLegacy(const uint8_t* pixelFormat)
+	{
+		uint32_t flags = Read32(pixelFormat + 4);
+		if (flags & PfFourCC)
+		{
+			uint32_t fourCC = Read32(pixelFormat + 8);
+			if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+				return DdsFormat::BC1;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '2') || fourCC == MakeFourCC('D', 'X', 'T', '3'))
+				return DdsFormat::BC2;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '4') || fourCC == MakeFourCC('D', 'X', 'T', '5'))
+				return DdsFormat::BC3;
+			if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+				return DdsFormat::BC4;
+			if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+				return DdsFormat::BC5;
+			if (fourCC == 113) // D3DFMT_A16B16G16R16F
+				return DdsFormat::RGBA16F;
+			if (fourCC == 116) // D3DFMT_A32B32G32R32F
+				return DdsFormat::RGBA32F;
+			return DdsFormat::Unknown;
+		}
+
+		if ((flags & PfRGB) && Read32(pixelFormat + 12) == 32)
+		{
+			uint32_t r = Read32(pixelFormat + 16);
+			uint32_t g = Read32(pixelFormat + 20);
+			uint32_t b = Read32(pixelFormat + 24);
+			uint32_t a = (flags & PfAlphaPixels) ? Read32(pixelFormat + 28) : 0;
+			if (r == 0x00FF0000 && g == 0x0000FF00 && b == 0x000000FF)
+				return a == 0xFF000000 ? DdsFormat::BGRA8 : DdsFormat::BGRX8;
+			if (r == 0x000000FF && g == 0x0000FF00 && b == 0x00FF0000 && a == 0xFF000000)
+				return DdsFormat::RGBA8;
+		}
+		return DdsFormat::Unknown;
+	}
+
+	static bool FromDxgi(uint32_t dxgiFormat, DdsFormat& format, bool& srgb)
+	{
+		srgb = false;
+		switch (dxgiFormat)
+		{
+		case 2: format = DdsFormat::RGBA32F; return true;
+		case 10: format = DdsFormat::RGBA16F; return true;
+		case 29: srgb = true; [[fallthrough]];
+		case 28: format = DdsFormat::RGBA8; return true;
+		case 72: srgb = true; [[fallthrough]];
+		case 71: format = DdsFormat::BC1; return true;
+		case 75: srgb = true; [[fallthrough]];
+		case 74: format = DdsFormat::BC2; return true;
+		case 78: srgb = true; [[fallthrough]];
+		case 77: format = DdsFormat::BC3; return true;
+		case 80: format = DdsFormat::BC4; return true;
+		case 83: format = DdsFormat::BC5; return true;
+		case 87: format = DdsFormat::BGRA8; return true;
+		case 88: format = DdsFormat::BGRX8; return true;
+		case 91: format = DdsFormat::BGRA8; srgb = true; return true;
+		case 93: format = DdsFormat::BGRX8; srgb = true; return true;
+		case 95: format = DdsFormat::BC6H; return true;
+		case 99: srgb = true; [[fallthrough]];
+		case 98: format = DdsFormat::BC7; return true;
+		default: return false; // Signed BC4/BC5/BC6H and everything else
+		}
+	}
+};
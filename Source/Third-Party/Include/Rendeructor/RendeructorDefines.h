@@ -1,9 +1,13 @@
 #pragma once
 
 #include "RendeructorAPI.h"
+#include "RendeructorHandles.h"
+#include "RendeructorConstants.h"
+#include "RendeructorMeshOptimizer.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <MathAPI/MathAPI.h>
 
 enum class ScreenMode
@@ -26,7 +30,18 @@ enum class TextureFormat
 	RGBA16F,
 	RGBA32F,
 	R16F,
-	R32F
+	R32F,
+	Depth24Stencil8, // Depth buffer (Rendeructor::SetRenderTargetWithDepth), sampled as R24 in shaders
+	// Loaded from DDS files as stored (Texture::LoadFromDisk), can't be render targets
+	BGRA8,
+	BGRX8,
+	BC1,
+	BC2,
+	BC3,
+	BC4,
+	BC5,
+	BC6H,
+	BC7
 };
 
 enum class CullMode
@@ -81,6 +96,23 @@ struct RENDER_API BackendConfig
 	void* WindowHandle = nullptr;
 };
 
+//      
+struct RENDER_API BackendFrameStats
+{
+	uint64_t ConstantBytesUploaded = 0;
+	uint32_t ConstantBuffersUploaded = 0;
+	uint32_t ConstantUploadsSkipped = 0;
+	uint32_t ConstantBindsSkipped = 0;
+	uint64_t TransientBytesUploaded = 0;
+	uint32_t ShaderDrawsWithFallback = 0; //   ,  
+	uint32_t ShaderDrawsSkipped = 0;	  //   ,  
+	uint32_t ShaderPassesPending = 0;
+	uint32_t BindCallsIssued = 0; //  *Set* (, SRV, , CB, IA),   
+	uint32_t BindCallsElided = 0; // :       
+	uint32_t HazardUnbinds = 0;	  // SRV,  - ,     
+	uint32_t VertexLayoutMismatches = 0; //  :      
+};
+
 struct Vertex
 {
 	Math::float3 Position;
@@ -100,6 +132,14 @@ struct Vertex
 	}
 };
 
+// Vertex buffer format of a Mesh
+enum class VertexLayout
+{
+	Standard, // Vertex as is, 56 bytes; the input layout follows the shader's input signature
+	Compact	  // CompactVertex, 20 bytes: quantized position, octahedral normal/tangent, half uv
+};
+static constexpr int VertexLayoutCount = 2;
+
 struct RENDER_API PipelineState
 {
 	CullMode Cull = CullMode::Back;
@@ -109,16 +149,49 @@ struct RENDER_API PipelineState
 	bool ScissorTest = false;
 };
 
+struct DdsImage;
+struct DecodedImage;
+class Texture;
+
+struct TextureLoadRequest
+{
+	Texture* Target = nullptr;
+	std::string Path;
+	bool Srgb = true;
+	bool GenerateMips = true;
+};
+
+struct TextureBatchStats
+{
+	uint32_t Threads = 0;
+	uint32_t Loaded = 0;
+	uint32_t Failed = 0;
+	double DecodeMs = 0.0; // Summed over the workers: file read, decode, mip generation
+	double UploadMs = 0.0; // On the calling thread
+	double TotalMs = 0.0;  // Wall clock of the whole batch
+};
+
 class RENDER_API Texture
 {
   public:
 	Texture() = default;
 
 	void Create(int width, int height, TextureFormat format, const void* data = nullptr);
-	bool LoadFromDisk(const std::string& path);
+	// Loads with the full mip chain into an immutable, shader-read-only texture (no rendering or
+	// copying into it). srgb = color data such as albedo, mips are averaged in linear light;
+	// pass false for normal maps, masks and other non-color data.
+	// .dds files keep their format (BCn stays compressed) and their own mips; mips are only
+	// generated for uncompressed DDS files that have none
+	bool LoadFromDisk(const std::string& path, bool srgb = true, bool generateMips = true);
+	// Same as LoadFromDisk for many files: decoding and mip generation run on threadCount
+	// worker threads (0 = one per core), textures are created on the calling thread as the
+	// files finish. Files that can't be read or decoded leave their target untouched
+	static TextureBatchStats LoadBatch(const std::vector<TextureLoadRequest>& requests, uint32_t threadCount = 0);
 	void Copy(const Texture& source);
+	// Copies of this object share the handle and see it as stale afterwards
+	void Release(uint32_t framesToWait = 0);
 
-	void* GetHandle() const
+	TextureHandle GetHandle() const
 	{
 		return m_backendHandle;
 	}
@@ -136,7 +209,17 @@ class RENDER_API Texture
 	}
 
   private:
-	void* m_backendHandle = nullptr;
+	friend class TextureStreamer;
+
+	bool Upload(const DecodedImage& image, bool srgb, bool generateMips);
+	// Uploads levels firstMip..last of the first slice; the texture takes the size of firstMip
+	bool CreateFromDds(const DdsImage& image, uint32_t firstMip, bool srgb, bool generateMips);
+	// Levels firstMip..last of another texture, copied on the GPU; source stays as it is
+	bool CreateFromMips(const Texture& source, uint32_t firstMip);
+	// Whole file into memory, the image points into it
+	static bool ReadDds(const std::string& path, std::vector<uint8_t>& file, DdsImage& image);
+
+	TextureHandle m_backendHandle;
 	int m_width = 0;
 	int m_height = 0;
 	TextureFormat m_format = TextureFormat::RGBA8;
@@ -147,13 +230,14 @@ class RENDER_API Texture3D
   public:
 	Texture3D() = default;
 	void Create(int width, int height, int depth, const void* data);
-	void* GetHandle() const
+	void Release(uint32_t framesToWait = 0);
+	TextureHandle GetHandle() const
 	{
 		return m_backendHandle;
 	}
 
   private:
-	void* m_backendHandle = nullptr;
+	TextureHandle m_backendHandle;
 };
 
 class RENDER_API TextureCube
@@ -163,36 +247,106 @@ class RENDER_API TextureCube
 
 	// +X (Right), -X (Left), +Y (Top), -Y (Bottom), +Z (Front), -Z (Back)
 	bool LoadFromFiles(const std::vector<std::string>& filepaths);
+	// Cube map DDS file with all six faces, uploaded with its mips and compression as stored
+	bool LoadFromDisk(const std::string& path);
+	void Release(uint32_t framesToWait = 0);
 
-	void* GetHandle() const
+	TextureHandle GetHandle() const
 	{
 		return m_backendHandle;
 	}
 
   private:
-	void* m_backendHandle = nullptr;
+	TextureHandle m_backendHandle;
 };
 
 class RENDER_API Sampler
 {
   public:
 	void Create(const std::string& filterName = "Linear");
-	void* GetHandle() const
+	void Release(uint32_t framesToWait = 0);
+	SamplerHandle GetHandle() const
 	{
 		return m_backendHandle;
 	}
 
   private:
-	void* m_backendHandle = nullptr;
+	SamplerHandle m_backendHandle;
 };
 
+// Bit mask of enabled shader features, see ShaderPass::AddFeature
+using ShaderPermutationKey = uint32_t;
+
 class RENDER_API ShaderPass
 {
   public:
-	std::string PixelShaderPath;
-	std::string PixelShaderEntryPoint = "main";
-	std::string VertexShaderPath;
-	std::string VertexShaderEntryPoint = "main";
+	static constexpr uint32_t MaxFeatures = 32;
+
+	void SetVertexShader(const std::string& path, const std::string& entryPoint = "main");
+	void SetPixelShader(const std::string& path, const std::string& entryPoint = "main");
+
+	const std::string& GetVertexShaderPath() const
+	{
+		return m_vertexShaderPath;
+	}
+	const std::string& GetVertexShaderEntryPoint() const
+	{
+		return m_vertexShaderEntryPoint;
+	}
+	const std::string& GetPixelShaderPath() const
+	{
+		return m_pixelShaderPath;
+	}
+	const std::string& GetPixelShaderEntryPoint() const
+	{
+		return m_pixelShaderEntryPoint;
+	}
+
+	// Permutations. Bit i of a key compiles both shaders with "#define FeatureDefines[i] 1".
+	// Returns the bit of the feature (an already added define returns its old bit), 0 if all
+	// MaxFeatures bits are taken
+	ShaderPermutationKey AddFeature(const std::string& define);
+	void SetFeature(ShaderPermutationKey feature, bool enabled)
+	{
+		m_permutation = enabled ? (m_permutation | feature) : (m_permutation & ~feature);
+	}
+	// Switching permutations is an integer lookup at bind time, nothing is rebuilt
+	void SetPermutation(ShaderPermutationKey key)
+	{
+		m_permutation = key;
+	}
+	ShaderPermutationKey GetPermutation() const
+	{
+		return m_permutation;
+	}
+	const std::vector<std::string>& GetFeatureDefines() const
+	{
+		return m_featureDefines;
+	}
+
+	// Variants compiled together by Rendeructor::CompileVariants, ahead of their first use
+	void DeclareVariant(ShaderPermutationKey key);
+	const std::vector<ShaderPermutationKey>& GetDeclaredVariants() const
+	{
+		return m_declaredVariants;
+	}
+
+	// Incremented by every edit: shaders, features, textures, samplers
+	uint32_t GetVersion() const
+	{
+		return m_version;
+	}
+
+	// Backend-owned compiled form of the pass (resolved shader program, per-stage arrays of
+	// bound slots). The backend rebuilds it when the version changes, the pass only keeps it alive
+	const std::shared_ptr<void>& GetBackendCache() const
+	{
+		return m_backendCache;
+	}
+	void SetBackendCache(std::shared_ptr<void> cache) const
+	{
+		m_backendCache = std::move(cache);
+	}
 
 	void AddTexture(const std::string& name, const Texture& texture);
 	void AddTexture(const std::string& name, const Texture3D& texture);
@@ -217,6 +371,18 @@ class RENDER_API ShaderPass
 	}
 
   private:
+	std::string m_vertexShaderPath;
+	std::string m_vertexShaderEntryPoint = "main";
+	std::string m_pixelShaderPath;
+	std::string m_pixelShaderEntryPoint = "main";
+
+	std::vector<std::string> m_featureDefines;
+	std::vector<ShaderPermutationKey> m_declaredVariants;
+	ShaderPermutationKey m_permutation = 0;
+
+	uint32_t m_version = 0;
+	mutable std::shared_ptr<void> m_backendCache;
+
 	std::map<std::string, const Texture*> m_textures;
 	std::map<std::string, const Texture3D*> m_textures3D;
 	std::map<std::string, const TextureCube*> m_texturesCube;
@@ -271,8 +437,36 @@ class RENDER_API Mesh
 	Mesh() = default;
 	void Create(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
 
+	// Format used by the following Create/LoadFromOBJ/Generate* calls. Compact meshes need a
+	// vertex shader that decodes them (see RendeructorVertexPacking.h); its PositionScale and
+	// PositionOffset come with the vertex buffer, so every draw of the mesh sets them, also
+	// through DrawQueue, RenderCommandBuffer and MeshBatcher. Recreate the mesh after a change
+	void SetVertexLayout(VertexLayout layout)
+	{
+		m_vertexLayout = layout;
+	}
+	VertexLayout GetVertexLayout() const
+	{
+		return m_vertexLayout;
+	}
+	Math::float3 GetPositionScale() const
+	{
+		return m_positionScale;
+	}
+	Math::float3 GetPositionOffset() const
+	{
+		return m_positionOffset;
+	}
+
+	// optimize: reorders triangles for the vertex cache and overdraw and vertices for fetch
+	// order (see RendeructorMeshOptimizer.h), per submesh
 	bool LoadFromOBJ(const std::string& filepath, const std::string& mtlBaseDir,
-					 std::vector<RenderMaterial>& outMaterials);
+					 std::vector<RenderMaterial>& outMaterials, bool optimize = true);
+	// ACMR/ATVR before and after the last LoadFromOBJ optimization, zero if it didn't run
+	const MeshOptimizationStats& GetOptimizationStats() const
+	{
+		return m_optimizationStats;
+	}
 
 	static void GenerateCube(Mesh& outMesh, float size = 1.0f);
 	static void GeneratePlane(Mesh& outMesh, float width = 10.0f, float depth = 10.0f);
@@ -283,11 +477,13 @@ class RENDER_API Mesh
 	static void GenerateDisc(Mesh& outMesh, float radius = 1.0f, int segments = 32);
 	static void GenerateTriangle(Mesh& outMesh, float size = 1.0f);
 
-	void* GetVB() const
+	void Release(uint32_t framesToWait = 0);
+
+	BufferHandle GetVB() const
 	{
 		return m_vbHandle;
 	}
-	void* GetIB() const
+	BufferHandle GetIB() const
 	{
 		return m_ibHandle;
 	}
@@ -318,12 +514,16 @@ class RENDER_API Mesh
 	}
 
   private:
-	void* m_vbHandle = nullptr;
-	void* m_ibHandle = nullptr;
+	BufferHandle m_vbHandle;
+	BufferHandle m_ibHandle;
 	int m_indexCount = 0;
 	std::vector<SubMesh> m_SubMeshes;
 	Math::float3 m_MinBound = Math::float3(FLT_MAX);
 	Math::float3 m_MaxBound = Math::float3(-FLT_MAX);
+	VertexLayout m_vertexLayout = VertexLayout::Standard;
+	Math::float3 m_positionScale = Math::float3(1.0f);
+	Math::float3 m_positionOffset = Math::float3(0.0f);
+	MeshOptimizationStats m_optimizationStats;
 };
 
 class RENDER_API InstanceBuffer
@@ -332,8 +532,11 @@ class RENDER_API InstanceBuffer
 	InstanceBuffer() = default;
 
 	void Create(const void* data, int count, int stride);
+	//    :    ,    
+	void CreateTransient(const void* data, int count, int stride);
+	void Release(uint32_t framesToWait = 0);
 
-	void* GetHandle() const
+	BufferHandle GetHandle() const
 	{
 		return m_backendHandle;
 	}
@@ -345,9 +548,15 @@ class RENDER_API InstanceBuffer
 	{
 		return m_stride;
 	}
+	int GetFirstInstance() const
+	{
+		return m_firstInstance;
+	}
 
   private:
-	void* m_backendHandle = nullptr;
+	BufferHandle m_backendHandle;
 	int m_count = 0;
 	int m_stride = 0;
+	int m_firstInstance = 0;
+	bool m_transient = false;
 };
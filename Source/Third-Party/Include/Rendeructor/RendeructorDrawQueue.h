@@ -0,0 +1,275 @@
+#pragma once
+
+#include "RendeructorConstants.h"
+#include "RendeructorHandles.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+class ShaderPass;
+struct PipelineState;
+
+// 64-bit draw sort key, most significant field first:
+// layer (4) | pass (8) | shader (16) | material (20) | depth bucket (16).
+// Sorting by the key groups draws by layer and pass, then by shader and material, so state
+// changes happen only at group boundaries. Depth orders draws inside a group.
+struct DrawSortKey
+{
+	static constexpr uint32_t LayerBits = 4;
+	static constexpr uint32_t PassBits = 8;
+	static constexpr uint32_t ShaderBits = 16;
+	static constexpr uint32_t MaterialBits = 20;
+	static constexpr uint32_t DepthBits = 16;
+
+	static constexpr uint32_t DepthShift = 0;
+	static constexpr uint32_t MaterialShift = DepthShift + DepthBits;
+	static constexpr uint32_t ShaderShift = MaterialShift + MaterialBits;
+	static constexpr uint32_t PassShift = ShaderShift + ShaderBits;
+	static constexpr uint32_t LayerShift = PassShift + PassBits;
+
+	static constexpr uint64_t Make(uint32_t layer, uint32_t pass, uint32_t shader, uint32_t material, uint32_t depthBucket)
+	{
+		return (Field(layer, LayerBits) << LayerShift) | (Field(pass, PassBits) << PassShift) |
+			   (Field(shader, ShaderBits) << ShaderShift) | (Field(material, MaterialBits) << MaterialShift) |
+			   (Field(depthBucket, DepthBits) << DepthShift);
+	}
+
+	// Quantizes view depth into the depth field. Opaque draws go front to back (early-z),
+	// transparent ones back to front (blending order).
+	static uint32_t DepthBucket(float viewDepth, float nearZ, float farZ, bool backToFront)
+	{
+		float t = (viewDepth - nearZ) / (farZ - nearZ);
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		uint32_t bucket = (uint32_t)(t * (float)((1u << DepthBits) - 1));
+		return backToFront ? ((1u << DepthBits) - 1) - bucket : bucket;
+	}
+
+  private:
+	static constexpr uint64_t Field(uint32_t value, uint32_t bits)
+	{
+		return (uint64_t)value & ((1ull << bits) - 1);
+	}
+};
+
+// One draw call with everything needed to issue it. PassId and StateId index the queue's
+// pass/state tables (see DrawQueue::RegisterPass/RegisterState), so items stay POD.
+struct DrawItem
+{
+	uint64_t SortKey = 0;
+	uint16_t PassId = 0;
+	uint16_t StateId = 0;
+	BufferHandle VertexBuffer;
+	BufferHandle IndexBuffer;
+	BufferHandle InstanceBuffer; // Invalid = not instanced
+	int IndexCount = 0;
+	int InstanceCount = 0;
+	int InstanceStride = 0;
+	int FirstInstance = 0;
+	// Per-draw constants (e.g. World), stored in the queue's arena
+	uint32_t ConstantsHash = 0;
+	uint32_t ConstantsOffset = 0;
+	uint32_t ConstantsSize = 0;
+};
+
+struct DrawQueueStats
+{
+	uint32_t Draws = 0;
+	uint32_t PassChanges = 0;
+	uint32_t StateChanges = 0;
+	const PipelineState* FinalState = nullptr; // Last state set, nullptr if none
+};
+
+// Per-frame list of draws that is sorted by key and then executed with redundant
+// SetShaderPass/SetPipelineState calls removed.
+class DrawQueue
+{
+  public:
+	struct SortEntry
+	{
+		uint64_t Key;
+		uint32_t Index;
+	};
+
+	// Pass and state objects must stay alive until Execute(); ids are stable until Reset()
+	uint16_t RegisterPass(const ShaderPass* pass)
+	{
+		return Register(m_passes, m_passIds, pass);
+	}
+	uint16_t RegisterState(const PipelineState* state)
+	{
+		return Register(m_states, m_stateIds, state);
+	}
+
+	void Add(const DrawItem& item)
+	{
+		m_items.push_back(item);
+		m_sorted = false;
+	}
+	void Add(DrawItem item, ConstantId constantsId, const void* data, size_t size)
+	{
+		item.ConstantsHash = constantsId.Hash;
+		item.ConstantsOffset = (uint32_t)m_constantData.size();
+		item.ConstantsSize = (uint32_t)size;
+		m_constantData.insert(m_constantData.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+		Add(item);
+	}
+
+	void Sort()
+	{
+		m_order.resize(m_items.size());
+		for (uint32_t i = 0; i < (uint32_t)m_items.size(); ++i)
+			m_order[i] = {m_items[i].SortKey, i};
+		RadixSort(m_order, m_scratch);
+		m_sorted = true;
+	}
+
+	// Issues the draws in sorted order (insertion order if Sort() was not called)
+	template <typename TBackend>
+	DrawQueueStats Execute(TBackend& backend) const
+	{
+		DrawQueueStats stats;
+		uint32_t lastPass = InvalidId;
+		uint32_t lastState = InvalidId;
+
+		for (size_t i = 0; i < m_items.size(); ++i)
+		{
+			const DrawItem& item = m_items[m_sorted ? m_order[i].Index : i];
+
+			if (item.PassId != lastPass && item.PassId < m_passes.size())
+			{
+				backend.SetShaderPass(*m_passes[item.PassId]);
+				lastPass = item.PassId;
+				++stats.PassChanges;
+			}
+			if (item.StateId != lastState && item.StateId < m_states.size())
+			{
+				stats.FinalState = m_states[item.StateId];
+				backend.SetPipelineState(*stats.FinalState);
+				lastState = item.StateId;
+				++stats.StateChanges;
+			}
+			if (item.ConstantsSize)
+			{
+				ConstantId id;
+				id.Hash = item.ConstantsHash;
+				backend.UpdateConstantRaw(id, m_constantData.data() + item.ConstantsOffset, item.ConstantsSize);
+			}
+
+			if (item.InstanceBuffer.IsValid())
+				backend.DrawMeshInstanced(item.VertexBuffer, item.IndexBuffer, item.IndexCount, item.InstanceBuffer,
+										  item.InstanceCount, item.InstanceStride, item.FirstInstance);
+			else
+				backend.DrawMesh(item.VertexBuffer, item.IndexBuffer, item.IndexCount);
+			++stats.Draws;
+		}
+		return stats;
+	}
+
+	// Pass/state changes Execute() would issue, without a backend
+	DrawQueueStats CountStateChanges(bool sorted) const
+	{
+		DrawQueueStats stats;
+		uint32_t lastPass = InvalidId;
+		uint32_t lastState = InvalidId;
+		for (size_t i = 0; i < m_items.size(); ++i)
+		{
+			const DrawItem& item = m_items[sorted && m_sorted ? m_order[i].Index : i];
+			if (item.PassId != lastPass)
+			{
+				lastPass = item.PassId;
+				++stats.PassChanges;
+			}
+			if (item.StateId != lastState)
+			{
+				lastState = item.StateId;
+				++stats.StateChanges;
+			}
+			++stats.Draws;
+		}
+		return stats;
+	}
+
+	// Keeps the memory, the queue is meant to be refilled every frame
+	void Reset()
+	{
+		m_items.clear();
+		m_order.clear();
+		m_constantData.clear();
+		m_passes.clear();
+		m_passIds.clear();
+		m_states.clear();
+		m_stateIds.clear();
+		m_sorted = false;
+	}
+
+	size_t GetCount() const
+	{
+		return m_items.size();
+	}
+
+	// Stable LSD radix sort, 8 bits per pass. Passes where every key has the same byte are
+	// skipped, so keys that only use a few fields cost only a few passes.
+	static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+	{
+		const size_t count = entries.size();
+		if (count < 2)
+			return;
+		scratch.resize(count);
+
+		SortEntry* src = entries.data();
+		SortEntry* dst = scratch.data();
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			size_t histogram[256] = {};
+			for (size_t i = 0; i < count; ++i)
+				++histogram[(src[i].Key >> shift) & 0xFF];
+
+			if (histogram[(src[0].Key >> shift) & 0xFF] == count)
+				continue;
+
+			size_t offset = 0;
+			for (size_t& bucket : histogram)
+			{
+				size_t bucketSize = bucket;
+				bucket = offset;
+				offset += bucketSize;
+			}
+			for (size_t i = 0; i < count; ++i)
+				dst[histogram[(src[i].Key >> shift) & 0xFF]++] = src[i];
+
+			SortEntry* temp = src;
+			src = dst;
+			dst = temp;
+		}
+
+		if (src != entries.data())
+			memcpy(entries.data(), src, count * sizeof(SortEntry));
+	}
+
+  private:
+	static constexpr uint32_t InvalidId = 0xFFFFFFFFu;
+
+	template <typename T>
+	static uint16_t Register(std::vector<const T*>& table, std::unordered_map<const T*, uint16_t>& ids, const T* object)
+	{
+		auto it = ids.find(object);
+		if (it != ids.end())
+			return it->second;
+		uint16_t id = (uint16_t)table.size();
+		table.push_back(object);
+		ids.emplace(object, id);
+		return id;
+	}
+
+	std::vector<DrawItem> m_items;
+	std::vector<SortEntry> m_order;
+	std::vector<SortEntry> m_scratch;
+	std::vector<uint8_t> m_constantData;
+	std::vector<const ShaderPass*> m_passes;
+	std::unordered_map<const ShaderPass*, uint16_t> m_passIds;
+	std::vector<const PipelineState*> m_states;
+	std::unordered_map<const PipelineState*, uint16_t> m_stateIds;
+	bool m_sorted = false;
+};
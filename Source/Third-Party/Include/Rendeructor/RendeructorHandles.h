@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+// Typed handle to a backend resource. Index selects the slot in the backend's pool,
+// Generation must match the slot's current generation, so a handle to a destroyed
+// (and possibly reused) slot is detected in O(1).
+template <typename Tag>
+struct ResourceHandle
+{
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+	uint32_t Index = InvalidIndex;
+	uint32_t Generation = 0;
+
+	bool IsValid() const
+	{
+		return Index != InvalidIndex;
+	}
+
+	bool operator==(const ResourceHandle& other) const
+	{
+		return Index == other.Index && Generation == other.Generation;
+	}
+	bool operator!=(const ResourceHandle& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+struct TextureHandleTag;
+struct BufferHandleTag;
+struct SamplerHandleTag;
+
+using TextureHandle = ResourceHandle<TextureHandleTag>;
+using BufferHandle = ResourceHandle<BufferHandleTag>;
+using SamplerHandle = ResourceHandle<SamplerHandleTag>;
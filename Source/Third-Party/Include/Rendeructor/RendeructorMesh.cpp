@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "Rendeructor.h"
 #include "BackendDX11.h"
+#include "RendeructorVertexPacking.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <TinyObjLoader/TinyObjLoader.h>
@@ -31,22 +32,94 @@ struct VertexEqual
 	}
 };
 
+//  :      ,   -  Position.w
+static std::vector<CompactVertex> PackVertices(const std::vector<Vertex>& vertices, PositionQuantization& quantization)
+{
+	float boundsMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+	float boundsMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (const auto& v : vertices)
+	{
+		const float position[3] = {v.Position.x, v.Position.y, v.Position.z};
+		for (int i = 0; i < 3; ++i)
+		{
+			boundsMin[i] = std::min(boundsMin[i], position[i]);
+			boundsMax[i] = std::max(boundsMax[i], position[i]);
+		}
+	}
+	quantization = vertices.empty() ? PositionQuantization() : VertexPacking::QuantizationFromBounds(boundsMin, boundsMax);
+
+	std::vector<CompactVertex> packed;
+	packed.reserve(vertices.size());
+	for (const auto& v : vertices)
+	{
+		const float position[3] = {v.Position.x, v.Position.y, v.Position.z};
+		const float normal[3] = {v.Normal.x, v.Normal.y, v.Normal.z};
+		const float tangent[3] = {v.Tangent.x, v.Tangent.y, v.Tangent.z};
+		const float uv[2] = {v.UV.x, v.UV.y};
+		Math::float3 cross = Math::float3::cross(v.Normal, v.Tangent);
+		float sign = Math::float3::dot(cross, v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+		packed.push_back(VertexPacking::Pack(position, normal, tangent, sign, uv, quantization));
+	}
+	return packed;
+}
+
 void Mesh::Create(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
 {
+	Release();
+	m_positionScale = Math::float3(1.0f);
+	m_positionOffset = Math::float3(0.0f);
 	if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI())
 	{
-		m_vbHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateVertexBuffer(
-			vertices.data(), vertices.size() * sizeof(Vertex), sizeof(Vertex));
+		if (m_vertexLayout == VertexLayout::Compact)
+		{
+			PositionQuantization quantization;
+			std::vector<CompactVertex> packed = PackVertices(vertices, quantization);
+			m_positionScale = Math::float3(quantization.Scale[0], quantization.Scale[1], quantization.Scale[2]);
+			m_positionOffset = Math::float3(quantization.Offset[0], quantization.Offset[1], quantization.Offset[2]);
+			m_vbHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateVertexBuffer(
+				packed.data(), packed.size() * sizeof(CompactVertex), sizeof(CompactVertex), VertexLayout::Compact, quantization);
+		}
+		else
+		{
+			m_vbHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateVertexBuffer(
+				vertices.data(), vertices.size() * sizeof(Vertex), sizeof(Vertex));
+		}
 
-		m_ibHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateIndexBuffer(
-			indices.data(), indices.size() * sizeof(unsigned int));
+		//   16 ,      :     
+		if (vertices.size() <= 65535)
+		{
+			std::vector<uint16_t> shortIndices(indices.size());
+			for (size_t i = 0; i < indices.size(); ++i)
+				shortIndices[i] = (uint16_t)indices[i];
+			m_ibHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateIndexBuffer(
+				shortIndices.data(), shortIndices.size() * sizeof(uint16_t), sizeof(uint16_t));
+		}
+		else
+		{
+			m_ibHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateIndexBuffer(
+				indices.data(), indices.size() * sizeof(unsigned int), sizeof(unsigned int));
+		}
 
 		m_indexCount = (int)indices.size();
 	}
 }
 
+void Mesh::Release(uint32_t framesToWait)
+{
+	if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI())
+	{
+		if (m_vbHandle.IsValid())
+			Rendeructor::GetCurrent()->GetBackendAPI()->DestroyBuffer(m_vbHandle, framesToWait);
+		if (m_ibHandle.IsValid())
+			Rendeructor::GetCurrent()->GetBackendAPI()->DestroyBuffer(m_ibHandle, framesToWait);
+	}
+	m_vbHandle = BufferHandle();
+	m_ibHandle = BufferHandle();
+	m_indexCount = 0;
+}
+
 bool Mesh::LoadFromOBJ(const std::string& filepath, const std::string& mtlBaseDir,
-					   std::vector<RenderMaterial>& outMaterials)
+					   std::vector<RenderMaterial>& outMaterials, bool optimize)
 {
 	tinyobj::ObjReaderConfig reader_config;
 	reader_config.mtl_search_path = mtlBaseDir;
@@ -194,6 +267,7 @@ bool Mesh::LoadFromOBJ(const std::string& filepath, const std::string& mtlBaseDi
 	m_MinBound = Math::float3(FLT_MAX);
 	m_MaxBound = Math::float3(-FLT_MAX);
 	m_SubMeshes.clear();
+	m_optimizationStats = MeshOptimizationStats();
 
 	//  
 	std::vector<Vertex> finalVertices;
@@ -316,6 +390,19 @@ bool Mesh::LoadFromOBJ(const std::string& filepath, const std::string& mtlBaseDi
 		m_SubMeshes.push_back(subMesh);
 	}
 
+	// ---------------------------------------------------------
+	// 3.  ( , overdraw,  )
+	// ---------------------------------------------------------
+	//      , IndexStart/IndexCount  
+	if (optimize)
+	{
+		std::vector<MeshIndexRange> ranges;
+		for (const SubMesh& subMesh : m_SubMeshes)
+			ranges.push_back({subMesh.IndexStart, subMesh.IndexCount});
+
+		m_optimizationStats = MeshOptimizer::Optimize(finalVertices, finalIndices, ranges, offsetof(Vertex, Position));
+	}
+
 	//   GPU
 	Create(finalVertices, finalIndices);
 
@@ -0,0 +1,452 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Post-transform vertex cache efficiency of an index buffer, measured with a FIFO cache.
+// ACMR = vertices transformed per triangle (0.5 is the limit for big regular grids, 3 the
+// worst), ATVR = vertices transformed per vertex used (1 is perfect)
+struct VertexCacheStats
+{
+	float Acmr = 0.0f;
+	float Atvr = 0.0f;
+};
+
+struct MeshOptimizationStats
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+	uint32_t VerticesBefore = 0;
+	uint32_t VerticesAfter = 0; // Unreferenced vertices are dropped by the fetch remap
+};
+
+// Part of an index buffer that is drawn on its own (a submesh): triangles are only reordered
+// inside their range
+struct MeshIndexRange
+{
+	size_t Start = 0;
+	size_t Count = 0;
+};
+
+// CPU mesh optimization for import and tools, no graphics API involved:
+//  1. OptimizeVertexCache - triangle order for the post-transform cache (Forsyth's linear-speed
+//     algorithm, scores from a 32-entry LRU model, works for any real cache size)
+//  2. OptimizeOverdraw - splits that order into clusters that keep the cache efficiency within
+//     a threshold and sorts the clusters so outward-facing ones come first, which lets the
+//     depth test reject more of what's drawn later
+//  3. vertex fetch remap - vertices renumbered in first-use order, so fetches walk memory forward
+// Optimize() runs the three over a vertex/index buffer pair.
+class MeshOptimizer
+{
+  public:
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+	static constexpr uint32_t AnalysisCacheSize = 16;
+
+	static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+											   uint32_t cacheSize = AnalysisCacheSize)
+	{
+		VertexCacheStats stats;
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return stats;
+
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		std::vector<bool> used(vertexCount, false);
+		uint32_t time = cacheSize + 1;
+		size_t misses = 0, usedCount = 0;
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+		{
+			uint32_t v = indices[i];
+			if (v >= vertexCount)
+				continue;
+			if (time - timestamps[v] > cacheSize)
+			{
+				timestamps[v] = time++;
+				++misses;
+			}
+			if (!used[v])
+			{
+				used[v] = true;
+				++usedCount;
+			}
+		}
+
+		stats.Acmr = (float)misses / (float)triangleCount;
+		stats.Atvr = usedCount ? (float)misses / (float)usedCount : 0.0f;
+		return stats;
+	}
+
+	// Reorders the triangles of indices[0..indexCount) in place
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+	{
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+			return;
+
+		// Triangles of every vertex, as one array with per-vertex offsets
+		std::vector<uint32_t> valence(vertexCount, 0);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			++valence[indices[i]];
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+			offsets[v + 1] = offsets[v] + valence[v];
+		std::vector<uint32_t> adjacency(offsets[vertexCount]);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+				adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+		}
+
+		// valence now counts triangles not yet emitted
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+			vertexScore[v] = VertexScore(-1, valence[v]);
+
+		std::vector<float> triangleScore(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		for (size_t t = 0; t < triangleCount; ++t)
+			triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+		std::vector<uint32_t> output(triangleCount * 3);
+		uint32_t cache[CacheSize + 3];
+		uint32_t newCache[CacheSize + 3];
+		size_t cacheCount = 0;
+		size_t inputCursor = 0;
+
+		uint32_t current = 0;
+		for (size_t t = 1; t < triangleCount; ++t)
+		{
+			if (triangleScore[t] > triangleScore[current])
+				current = (uint32_t)t;
+		}
+
+		for (size_t written = 0; written < triangleCount; ++written)
+		{
+			const uint32_t* triangle = indices + (size_t)current * 3;
+			memcpy(&output[written * 3], triangle, 3 * sizeof(uint32_t));
+			emitted[current] = true;
+
+			// The triangle's vertices go to the front of the LRU cache
+			size_t newCount = 0;
+			for (int k = 0; k < 3; ++k)
+				newCache[newCount++] = triangle[k];
+			for (size_t i = 0; i < cacheCount; ++i)
+			{
+				uint32_t v = cache[i];
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+					newCache[newCount++] = v;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = triangle[k];
+				--valence[v];
+				uint32_t* begin = &adjacency[offsets[v]];
+				uint32_t* end = begin + valence[v] + 1;
+				*std::find(begin, end, current) = *(end - 1); // Keep live triangles packed in front
+			}
+
+			// Entries pushed past the cache get their position dropped, the rest are rescored
+			for (size_t i = 0; i < newCount; ++i)
+			{
+				uint32_t v = newCache[i];
+				cachePosition[v] = i < CacheSize ? (int)i : -1;
+				vertexScore[v] = VertexScore(cachePosition[v], valence[v]);
+			}
+
+			// Best triangle among the ones touching the cache
+			int best = -1;
+			float bestScore = -1.0f;
+			for (size_t i = 0; i < newCount; ++i)
+			{
+				uint32_t v = newCache[i];
+				for (uint32_t j = offsets[v]; j < offsets[v] + valence[v]; ++j)
+				{
+					uint32_t t = adjacency[j];
+					const uint32_t* tri = indices + (size_t)t * 3;
+					float score = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+					triangleScore[t] = score;
+					if (score > bestScore)
+					{
+						bestScore = score;
+						best = (int)t;
+					}
+				}
+			}
+
+			cacheCount = std::min(newCount, (size_t)CacheSize);
+			memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+			// Nothing adjacent left: continue with the next triangle in input order
+			if (best < 0)
+			{
+				while (inputCursor < triangleCount && emitted[inputCursor])
+					++inputCursor;
+				if (inputCursor == triangleCount)
+					break;
+				best = (int)inputCursor;
+			}
+			current = (uint32_t)best;
+		}
+
+		memcpy(indices, output.data(), triangleCount * 3 * sizeof(uint32_t));
+	}
+
+	// Run after OptimizeVertexCache. positions: x, y, z floats of vertex i at
+	// (const uint8_t*)positions + i * positionStride. threshold = how much worse than the
+	// incoming order the ACMR of a cluster may get (1.05 = 5%)
+	static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride,
+								 size_t vertexCount, float threshold = 1.05f)
+	{
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+			return;
+
+		std::vector<uint32_t> clusters = BuildClusters(indices, triangleCount, vertexCount, threshold);
+		size_t clusterCount = clusters.size();
+		clusters.push_back((uint32_t)triangleCount);
+
+		auto position = [positions, positionStride](uint32_t v) {
+			return (const float*)((const uint8_t*)positions + (size_t)v * positionStride);
+		};
+
+		// Area-weighted centroid and normal of each cluster and of the whole range
+		std::vector<float> sortKey(clusterCount);
+		std::vector<float> centroids(clusterCount * 3), normals(clusterCount * 3);
+		float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+		float meshArea = 0.0f;
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			float centroid[3] = {0.0f, 0.0f, 0.0f}, normal[3] = {0.0f, 0.0f, 0.0f}, area = 0.0f;
+			for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+			{
+				const float* a = position(indices[t * 3]);
+				const float* b = position(indices[t * 3 + 1]);
+				const float* d = position(indices[t * 3 + 2]);
+				float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+				float e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+				float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+				float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for (int k = 0; k < 3; ++k)
+				{
+					centroid[k] += (a[k] + b[k] + d[k]) * (triangleArea / 3.0f);
+					normal[k] += n[k];
+				}
+				area += triangleArea;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				meshCentroid[k] += centroid[k];
+				centroids[c * 3 + k] = area > 0.0f ? centroid[k] / area : 0.0f;
+				normals[c * 3 + k] = normal[k];
+			}
+			meshArea += area;
+		}
+		for (int k = 0; k < 3; ++k)
+			meshCentroid[k] = meshArea > 0.0f ? meshCentroid[k] / meshArea : 0.0f;
+
+		// Clusters facing away from the center are in front of the others from most directions
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			const float* n = &normals[c * 3];
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			float dot = 0.0f;
+			for (int k = 0; k < 3; ++k)
+				dot += (centroids[c * 3 + k] - meshCentroid[k]) * n[k];
+			sortKey[c] = length > 0.0f ? dot / length : 0.0f;
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c)
+			order[c] = (uint32_t)c;
+		std::stable_sort(order.begin(), order.end(), [&sortKey](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+		std::vector<uint32_t> output;
+		output.reserve(triangleCount * 3);
+		for (uint32_t c : order)
+			output.insert(output.end(), indices + (size_t)clusters[c] * 3, indices + (size_t)clusters[c + 1] * 3);
+		memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+	}
+
+	// remap[old] = new index in first-use order, InvalidIndex for vertices no triangle uses.
+	// Returns the number of vertices that remain
+	static size_t BuildVertexFetchRemap(const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap)
+	{
+		remap.assign(vertexCount, InvalidIndex);
+		uint32_t next = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t v = indices[i];
+			if (v < vertexCount && remap[v] == InvalidIndex)
+				remap[v] = next++;
+		}
+		return next;
+	}
+
+	// Whole pipeline; every range is reordered on its own, the remap covers the whole buffer.
+	// positionOffset = byte offset of the float x, y, z position inside TVertex
+	template <typename TVertex>
+	static MeshOptimizationStats Optimize(std::vector<TVertex>& vertices, std::vector<uint32_t>& indices,
+										  const std::vector<MeshIndexRange>& ranges, size_t positionOffset, float overdrawThreshold = 1.05f)
+	{
+		MeshOptimizationStats stats;
+		stats.VerticesBefore = (uint32_t)vertices.size();
+		stats.Before = AnalyzeRanges(indices, ranges, vertices.size());
+
+		const float* positions = (const float*)((const uint8_t*)vertices.data() + positionOffset);
+		for (const MeshIndexRange& range : ranges)
+		{
+			if (range.Start + range.Count > indices.size())
+				continue;
+			uint32_t* rangeIndices = indices.data() + range.Start;
+			OptimizeVertexCache(rangeIndices, range.Count, vertices.size());
+			OptimizeOverdraw(rangeIndices, range.Count, positions, sizeof(TVertex), vertices.size(), overdrawThreshold);
+		}
+
+		std::vector<uint32_t> remap;
+		size_t remaining = BuildVertexFetchRemap(indices.data(), indices.size(), vertices.size(), remap);
+		std::vector<TVertex> remapped(remaining);
+		for (size_t v = 0; v < vertices.size(); ++v)
+		{
+			if (remap[v] != InvalidIndex)
+				remapped[remap[v]] = vertices[v];
+		}
+		vertices.swap(remapped);
+		for (uint32_t& index : indices)
+			index = remap[index];
+
+		stats.VerticesAfter = (uint32_t)vertices.size();
+		stats.After = AnalyzeRanges(indices, ranges, vertices.size());
+		return stats;
+	}
+
+  private:
+	// LRU model the scores are tuned for
+	static constexpr uint32_t CacheSize = 32;
+
+	static float VertexScore(int cachePosition, uint32_t liveTriangles)
+	{
+		if (liveTriangles == 0)
+			return -1.0f; // Nothing left to draw with it
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The last triangle's vertices get a fixed score, so the next triangle doesn't
+			// simply reuse its newest edge and produce long thin strips
+			if (cachePosition < 3)
+				score = 0.75f;
+			else
+				score = std::pow(1.0f - (cachePosition - 3) * (1.0f / (CacheSize - 3)), 1.5f);
+		}
+		// Vertices with few triangles left are finished off first, they won't come back
+		score += 2.0f / std::sqrt((float)liveTriangles);
+		return score;
+	}
+
+	static VertexCacheStats AnalyzeRanges(const std::vector<uint32_t>& indices, const std::vector<MeshIndexRange>& ranges, size_t vertexCount)
+	{
+		// A range is drawn by its own draw call, the cache doesn't carry over
+		size_t misses = 0, triangles = 0, used = 0;
+		std::vector<bool> seen(vertexCount, false);
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = AnalysisCacheSize + 1;
+		for (const MeshIndexRange& range : ranges)
+		{
+			if (range.Start + range.Count > indices.size())
+				continue;
+			time += AnalysisCacheSize + 1;
+			triangles += range.Count / 3;
+			for (size_t i = range.Start; i < range.Start + range.Count / 3 * 3; ++i)
+			{
+				uint32_t v = indices[i];
+				if (v >= vertexCount)
+					continue;
+				if (time - timestamps[v] > AnalysisCacheSize)
+				{
+					timestamps[v] = time++;
+					++misses;
+				}
+				if (!seen[v])
+				{
+					seen[v] = true;
+					++used;
+				}
+			}
+		}
+
+		VertexCacheStats stats;
+		stats.Acmr = triangles ? (float)misses / (float)triangles : 0.0f;
+		stats.Atvr = used ? (float)misses / (float)used : 0.0f;
+		return stats;
+	}
+
+	// First triangle of every cluster. Hard boundaries are where the order jumps (all three
+	// vertices miss the cache); hard clusters are then cut wherever the part since the last cut
+	// is already within threshold of the hard cluster's ACMR
+	static std::vector<uint32_t> BuildClusters(const uint32_t* indices, size_t triangleCount, size_t vertexCount, float threshold)
+	{
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = AnalysisCacheSize + 1;
+		auto simulate = [&](size_t triangle) {
+			uint32_t misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[triangle * 3 + k];
+				if (time - timestamps[v] > AnalysisCacheSize)
+				{
+					timestamps[v] = time++;
+					++misses;
+				}
+			}
+			return misses;
+		};
+		auto flush = [&]() { time += AnalysisCacheSize + 1; };
+
+		std::vector<uint32_t> hard;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (t == 0 || simulate(t) == 3)
+				hard.push_back((uint32_t)t);
+			if (t == 0)
+				simulate(t);
+		}
+		hard.push_back((uint32_t)triangleCount);
+
+		std::vector<uint32_t> clusters;
+		for (size_t h = 0; h + 1 < hard.size(); ++h)
+		{
+			size_t start = hard[h], end = hard[h + 1];
+
+			flush();
+			size_t clusterMisses = 0;
+			for (size_t t = start; t < end; ++t)
+				clusterMisses += simulate(t);
+			float clusterAcmr = (float)clusterMisses / (float)(end - start);
+
+			flush();
+			clusters.push_back((uint32_t)start);
+			size_t misses = 0, softStart = start;
+			for (size_t t = start; t < end; ++t)
+			{
+				misses += simulate(t);
+				size_t count = t + 1 - softStart;
+				if (t + 1 < end && (float)misses <= threshold * clusterAcmr * (float)count)
+				{
+					clusters.push_back((uint32_t)(t + 1));
+					softStart = t + 1;
+					misses = 0;
+					flush();
+				}
+			}
+		}
+		return clusters;
+	}
+};
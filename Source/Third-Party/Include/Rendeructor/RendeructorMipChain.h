@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Full mip chain of an 8-bit RGBA image, built on the CPU with a 2x2 box filter. Every level
+// is made from the previous one; odd sizes clamp the last row/column. Color channels of sRGB
+// images are averaged in linear light (decode table, exact nearest re-encode), alpha and
+// non-sRGB data (normal maps, masks) are averaged as stored. All levels live in one
+// allocation, tightly packed, in the order the graphics API uploads them.
+class MipChain
+{
+  public:
+	static constexpr int BytesPerPixel = 4;
+
+	static int GetLevelCount(int width, int height)
+	{
+		int levels = 1;
+		while (width > 1 || height > 1)
+		{
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+			++levels;
+		}
+		return levels;
+	}
+
+	// maxLevels = 0 builds the chain down to 1x1
+	void Generate(const uint8_t* rgba, int width, int height, bool srgb, int maxLevels = 0)
+	{
+		m_levels.clear();
+		m_data.clear();
+		if (!rgba || width <= 0 || height <= 0)
+			return;
+
+		int levelCount = GetLevelCount(width, height);
+		if (maxLevels > 0 && maxLevels < levelCount)
+			levelCount = maxLevels;
+
+		size_t total = 0;
+		int w = width, h = height;
+		for (int i = 0; i < levelCount; ++i)
+		{
+			m_levels.push_back({w, h, total});
+			total += (size_t)w * h * BytesPerPixel;
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+
+		m_data.resize(total);
+		memcpy(m_data.data(), rgba, (size_t)width * height * BytesPerPixel);
+		for (int i = 1; i < levelCount; ++i)
+		{
+			const Level& src = m_levels[i - 1];
+			const Level& dst = m_levels[i];
+			if (srgb)
+				DownsampleSrgb(m_data.data() + src.Offset, src.Width, src.Height, m_data.data() + dst.Offset, dst.Width, dst.Height);
+			else
+				DownsampleLinear(m_data.data() + src.Offset, src.Width, src.Height, m_data.data() + dst.Offset, dst.Width, dst.Height);
+		}
+	}
+
+	int GetLevelCount() const
+	{
+		return (int)m_levels.size();
+	}
+	int GetWidth(int level) const
+	{
+		return m_levels[level].Width;
+	}
+	int GetHeight(int level) const
+	{
+		return m_levels[level].Height;
+	}
+	const uint8_t* GetLevel(int level) const
+	{
+		return m_data.data() + m_levels[level].Offset;
+	}
+	size_t GetSizeBytes() const
+	{
+		return m_data.size();
+	}
+
+	// Pointers to every level, the form CreateSampledTexture takes
+	std::vector<const void*> GetLevelPointers() const
+	{
+		std::vector<const void*> levels;
+		for (const auto& level : m_levels)
+			levels.push_back(m_data.data() + level.Offset);
+		return levels;
+	}
+
+	// 2x2 average of the raw byte values, rounded. Plain integer loops the compiler vectorizes
+	static void DownsampleLinear(const uint8_t* src, int srcWidth, int srcHeight, uint8_t* dst, int dstWidth, int dstHeight)
+	{
+		for (int y = 0; y < dstHeight; ++y)
+		{
+			const uint8_t* row0 = src + (size_t)Clamp(y * 2, srcHeight) * srcWidth * BytesPerPixel;
+			const uint8_t* row1 = src + (size_t)Clamp(y * 2 + 1, srcHeight) * srcWidth * BytesPerPixel;
+			uint8_t* out = dst + (size_t)y * dstWidth * BytesPerPixel;
+
+			for (int x = 0; x < dstWidth; ++x)
+			{
+				int x0 = Clamp(x * 2, srcWidth) * BytesPerPixel;
+				int x1 = Clamp(x * 2 + 1, srcWidth) * BytesPerPixel;
+				for (int c = 0; c < BytesPerPixel; ++c)
+					out[x * BytesPerPixel + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+
+	static void DownsampleSrgb(const uint8_t* src, int srcWidth, int srcHeight, uint8_t* dst, int dstWidth, int dstHeight)
+	{
+		const SrgbTables& tables = GetSrgbTables();
+		for (int y = 0; y < dstHeight; ++y)
+		{
+			const uint8_t* row0 = src + (size_t)Clamp(y * 2, srcHeight) * srcWidth * BytesPerPixel;
+			const uint8_t* row1 = src + (size_t)Clamp(y * 2 + 1, srcHeight) * srcWidth * BytesPerPixel;
+			uint8_t* out = dst + (size_t)y * dstWidth * BytesPerPixel;
+
+			for (int x = 0; x < dstWidth; ++x)
+			{
+				int x0 = Clamp(x * 2, srcWidth) * BytesPerPixel;
+				int x1 = Clamp(x * 2 + 1, srcWidth) * BytesPerPixel;
+				for (int c = 0; c < 3; ++c)
+				{
+					float linear = tables.ToLinear[row0[x0 + c]] + tables.ToLinear[row0[x1 + c]] +
+								   tables.ToLinear[row1[x0 + c]] + tables.ToLinear[row1[x1 + c]];
+					out[x * BytesPerPixel + c] = tables.Encode(linear * 0.25f);
+				}
+				out[x * BytesPerPixel + 3] = (uint8_t)((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) >> 2);
+			}
+		}
+	}
+
+  private:
+	struct Level
+	{
+		int Width;
+		int Height;
+		size_t Offset;
+	};
+
+	// ToLinear decodes a byte; Encode returns the byte whose decoded value is nearest, found
+	// through the midpoints between neighbouring decoded values (exact, no pow per texel)
+	struct SrgbTables
+	{
+		float ToLinear[256];
+		float Midpoints[255];
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				float s = i / 255.0f;
+				ToLinear[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 255; ++i)
+				Midpoints[i] = (ToLinear[i] + ToLinear[i + 1]) * 0.5f;
+		}
+
+		uint8_t Encode(float linear) const
+		{
+			int low = 0, high = 255;
+			while (low < high)
+			{
+				int mid = (low + high) / 2;
+				if (linear < Midpoints[mid])
+					high = mid;
+				else
+					low = mid + 1;
+			}
+			return (uint8_t)low;
+		}
+	};
+
+	static const SrgbTables& GetSrgbTables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	static int Clamp(int value, int size)
+	{
+		return value < size ? value : size - 1;
+	}
+
+	std::vector<Level> m_levels;
+	std::vector<uint8_t> m_data;
+};
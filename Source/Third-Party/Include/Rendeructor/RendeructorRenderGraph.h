@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Index of a texture declared in a RenderGraph, valid until the graph is reset
+struct RenderGraphResource
+{
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+	uint32_t Index = InvalidIndex;
+
+	bool IsValid() const
+	{
+		return Index != InvalidIndex;
+	}
+};
+
+// Format is the renderer's texture format value; two transient textures can share one
+// physical texture only when their descriptions are equal
+struct RenderGraphTextureDesc
+{
+	int Width = 0;
+	int Height = 0;
+	int Format = 0;
+	uint32_t BytesPerPixel = 4;
+
+	uint64_t GetSizeBytes() const
+	{
+		return (uint64_t)Width * (uint64_t)Height * BytesPerPixel;
+	}
+
+	bool operator==(const RenderGraphTextureDesc& other) const
+	{
+		return Width == other.Width && Height == other.Height && Format == other.Format;
+	}
+	bool operator!=(const RenderGraphTextureDesc& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+struct RenderGraphStats
+{
+	uint32_t PassesDeclared = 0;
+	uint32_t PassesCulled = 0;
+	uint32_t TransientTextures = 0; // Used by passes that survived culling
+	uint32_t PhysicalTextures = 0;	// After aliasing
+	uint64_t TransientBytes = 0;	// What the transient textures would take without aliasing
+	uint64_t PhysicalBytes = 0;		// What the physical textures take
+	uint64_t PeakLiveBytes = 0;		// Largest sum of transient textures alive during one pass
+};
+
+// Frame graph: passes declare the textures they read and write, Compile() culls passes whose
+// results nobody uses, computes the lifetime of every transient texture and packs textures
+// with equal descriptions and disjoint lifetimes into the same physical texture. Passes run
+// in declaration order, which already respects the dependencies: a pass can only read what
+// earlier passes wrote. A transient texture holds garbage when its first pass starts (the
+// physical texture was used by someone else), so that pass must clear or overwrite it.
+//
+// Compilation is plain CPU code. Physical textures come from the acquire callback given to
+// Execute(), so TTexture is whatever the caller allocates (Texture in the renderer).
+template <typename TTexture>
+class RenderGraph
+{
+  public:
+	using ExecuteFn = std::function<void(const RenderGraph&)>;
+
+	class PassBuilder
+	{
+	  public:
+		PassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass)
+		{
+		}
+
+		PassBuilder& Read(RenderGraphResource resource)
+		{
+			if (resource.Index < m_graph.m_resources.size())
+				m_graph.m_passes[m_pass].Reads.push_back(resource.Index);
+			return *this;
+		}
+		PassBuilder& Write(RenderGraphResource resource)
+		{
+			if (resource.Index < m_graph.m_resources.size())
+				m_graph.m_passes[m_pass].Writes.push_back(resource.Index);
+			return *this;
+		}
+		// The pass is never culled (e.g. it writes to the back buffer or reads data back)
+		PassBuilder& SideEffects()
+		{
+			m_graph.m_passes[m_pass].SideEffects = true;
+			return *this;
+		}
+
+		uint32_t GetIndex() const
+		{
+			return m_pass;
+		}
+
+	  private:
+		RenderGraph& m_graph;
+		uint32_t m_pass;
+	};
+
+	RenderGraphResource CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc)
+	{
+		Resource resource;
+		resource.Name = name;
+		resource.Desc = desc;
+		m_resources.push_back(resource);
+		m_compiled = false;
+		return {(uint32_t)m_resources.size() - 1};
+	}
+
+	// Textures that live outside the graph are never aliased, and passes writing them are kept
+	RenderGraphResource ImportTexture(const std::string& name, const TTexture& texture, const RenderGraphTextureDesc& desc)
+	{
+		RenderGraphResource resource = CreateTexture(name, desc);
+		m_resources.back().Imported = &texture;
+		return resource;
+	}
+
+	PassBuilder AddPass(const std::string& name, ExecuteFn execute)
+	{
+		Pass pass;
+		pass.Name = name;
+		pass.Execute = std::move(execute);
+		m_passes.push_back(std::move(pass));
+		m_compiled = false;
+		return PassBuilder(*this, (uint32_t)m_passes.size() - 1);
+	}
+
+	void Compile()
+	{
+		m_stats = RenderGraphStats();
+		m_stats.PassesDeclared = (uint32_t)m_passes.size();
+		m_order.clear();
+		m_physical.clear();
+
+		CullPasses();
+		ComputeLifetimes();
+		AssignPhysicalTextures();
+		m_compiled = true;
+	}
+
+	// acquire(const RenderGraphTextureDesc&) -> const TTexture*, called once per physical
+	// texture. The returned textures must stay alive until the passes have run
+	template <typename TAcquire>
+	void Execute(TAcquire&& acquire)
+	{
+		if (!m_compiled)
+			Compile();
+
+		for (auto& physical : m_physical)
+			physical.Texture = acquire(physical.Desc);
+
+		for (uint32_t pass : m_order)
+		{
+			if (m_passes[pass].Execute)
+				m_passes[pass].Execute(*this);
+		}
+	}
+
+	// Valid inside pass callbacks. nullptr for textures of culled passes
+	const TTexture* GetTexture(RenderGraphResource resource) const
+	{
+		if (resource.Index >= m_resources.size())
+			return nullptr;
+		const Resource& entry = m_resources[resource.Index];
+		if (entry.Imported)
+			return entry.Imported;
+		if (entry.Physical == InvalidIndex)
+			return nullptr;
+		return m_physical[entry.Physical].Texture;
+	}
+
+	const RenderGraphTextureDesc& GetDesc(RenderGraphResource resource) const
+	{
+		return m_resources[resource.Index].Desc;
+	}
+
+	// Physical texture index after Compile(), InvalidIndex for imported or unused textures
+	uint32_t GetPhysicalIndex(RenderGraphResource resource) const
+	{
+		return resource.Index < m_resources.size() ? m_resources[resource.Index].Physical : InvalidIndex;
+	}
+
+	bool IsPassCulled(uint32_t pass) const
+	{
+		return pass < m_passes.size() && m_passes[pass].Culled;
+	}
+
+	// Indices of the passes that run, in order
+	const std::vector<uint32_t>& GetExecutionOrder() const
+	{
+		return m_order;
+	}
+
+	const RenderGraphStats& GetStats() const
+	{
+		return m_stats;
+	}
+
+	// Drops passes and textures but keeps the memory, the graph is meant to be rebuilt every frame
+	void Reset()
+	{
+		m_passes.clear();
+		m_resources.clear();
+		m_order.clear();
+		m_physical.clear();
+		m_stats = RenderGraphStats();
+		m_compiled = false;
+	}
+
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+  private:
+	struct Pass
+	{
+		std::string Name;
+		ExecuteFn Execute;
+		std::vector<uint32_t> Reads;
+		std::vector<uint32_t> Writes;
+		bool SideEffects = false;
+		bool Culled = false;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		RenderGraphTextureDesc Desc;
+		const TTexture* Imported = nullptr;
+		uint32_t FirstUse = InvalidIndex; // Positions in m_order
+		uint32_t LastUse = 0;
+		uint32_t Physical = InvalidIndex;
+	};
+
+	struct PhysicalTexture
+	{
+		RenderGraphTextureDesc Desc;
+		uint32_t LastUse = 0;
+		const TTexture* Texture = nullptr;
+	};
+
+	// Walks the passes backwards: a pass is needed if it has side effects, writes an imported
+	// texture or writes a texture some needed later pass reads. Earlier writers of a needed
+	// texture are kept too (clear, then draw on top)
+	void CullPasses()
+	{
+		std::vector<bool> needed(m_resources.size(), false);
+		for (size_t i = m_passes.size(); i-- > 0;)
+		{
+			Pass& pass = m_passes[i];
+			bool alive = pass.SideEffects;
+			for (uint32_t resource : pass.Writes)
+			{
+				if (m_resources[resource].Imported || needed[resource])
+					alive = true;
+			}
+
+			pass.Culled = !alive;
+			if (!alive)
+			{
+				++m_stats.PassesCulled;
+				continue;
+			}
+			for (uint32_t resource : pass.Reads)
+				needed[resource] = true;
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)m_passes.size(); ++i)
+		{
+			if (!m_passes[i].Culled)
+				m_order.push_back(i);
+		}
+	}
+
+	void ComputeLifetimes()
+	{
+		for (auto& resource : m_resources)
+		{
+			resource.FirstUse = InvalidIndex;
+			resource.LastUse = 0;
+			resource.Physical = InvalidIndex;
+		}
+
+		auto touch = [this](uint32_t index, uint32_t position) {
+			Resource& resource = m_resources[index];
+			if (resource.FirstUse == InvalidIndex)
+				resource.FirstUse = position;
+			resource.LastUse = position;
+		};
+
+		for (uint32_t position = 0; position < (uint32_t)m_order.size(); ++position)
+		{
+			const Pass& pass = m_passes[m_order[position]];
+			for (uint32_t resource : pass.Reads)
+				touch(resource, position);
+			for (uint32_t resource : pass.Writes)
+				touch(resource, position);
+		}
+	}
+
+	// Resources are visited by first use; each takes the first physical texture with the same
+	// description whose last user ran strictly before it, or a new one. Lifetimes include both
+	// ends, so two textures used by the same pass never share
+	void AssignPhysicalTextures()
+	{
+		std::vector<uint32_t> byFirstUse;
+		for (uint32_t i = 0; i < (uint32_t)m_resources.size(); ++i)
+		{
+			const Resource& resource = m_resources[i];
+			if (resource.Imported || resource.FirstUse == InvalidIndex)
+				continue;
+			byFirstUse.push_back(i);
+			++m_stats.TransientTextures;
+			m_stats.TransientBytes += resource.Desc.GetSizeBytes();
+		}
+		std::stable_sort(byFirstUse.begin(), byFirstUse.end(), [this](uint32_t a, uint32_t b) {
+			return m_resources[a].FirstUse < m_resources[b].FirstUse;
+		});
+
+		for (uint32_t index : byFirstUse)
+		{
+			Resource& resource = m_resources[index];
+			uint32_t chosen = InvalidIndex;
+			for (uint32_t p = 0; p < (uint32_t)m_physical.size(); ++p)
+			{
+				if (m_physical[p].Desc == resource.Desc && m_physical[p].LastUse < resource.FirstUse)
+				{
+					chosen = p;
+					break;
+				}
+			}
+			if (chosen == InvalidIndex)
+			{
+				chosen = (uint32_t)m_physical.size();
+				PhysicalTexture physical;
+				physical.Desc = resource.Desc;
+				m_physical.push_back(physical);
+				m_stats.PhysicalBytes += resource.Desc.GetSizeBytes();
+			}
+			m_physical[chosen].LastUse = resource.LastUse;
+			resource.Physical = chosen;
+		}
+		m_stats.PhysicalTextures = (uint32_t)m_physical.size();
+
+		for (uint32_t position = 0; position < (uint32_t)m_order.size(); ++position)
+		{
+			uint64_t live = 0;
+			for (uint32_t index : byFirstUse)
+			{
+				const Resource& resource = m_resources[index];
+				if (resource.FirstUse <= position && position <= resource.LastUse)
+					live += resource.Desc.GetSizeBytes();
+			}
+			if (live > m_stats.PeakLiveBytes)
+				m_stats.PeakLiveBytes = live;
+		}
+	}
+
+	std::vector<Pass> m_passes;
+	std::vector<Resource> m_resources;
+	std::vector<uint32_t> m_order;
+	std::vector<PhysicalTexture> m_physical;
+	RenderGraphStats m_stats;
+	bool m_compiled = false;
+};
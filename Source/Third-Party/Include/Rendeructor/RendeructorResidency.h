@@ -0,0 +1,425 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// What the streamer has to do after ResidencyPolicy::Update. Mip is the new most detailed
+// resident level: for StreamIn the level to load (one step up), for Evict the level to keep
+struct ResidencyOp
+{
+	enum class Type
+	{
+		StreamIn,
+		Evict
+	};
+
+	Type Kind = Type::StreamIn;
+	uint32_t Texture = 0;
+	uint32_t Mip = 0;
+};
+
+struct ResidencyStats
+{
+	uint64_t Budget = 0;
+	uint64_t ResidentBytes = 0;
+	uint64_t InFlightBytes = 0; // Reserved for stream-ins that haven't completed
+	uint64_t RetiringBytes = 0; // Replaced allocations not freed yet (see SetReleaseDelay)
+	uint64_t PeakBytes = 0;		// Max of resident + in flight + retiring seen after an update
+	uint32_t Textures = 0;
+	uint32_t Updates = 0;
+	uint32_t StreamIns = 0;
+	uint32_t Evictions = 0;
+	// Resident + in flight + retiring above the budget. Happens when the always-resident tails
+	// alone don't fit, and with a release delay right after an eviction: the smaller copy of a
+	// texture exists next to the old one until that is freed
+	uint32_t OverBudgetUpdates = 0;
+	uint32_t UnsatisfiedRequests = 0; // Textures of the last update still blurrier than requested
+};
+
+// Decides which mip levels of streamed textures should be resident under a memory budget.
+// Every frame the renderer reports the mip each visible texture needs (RequestMip), Update()
+// then returns stream-in and evict operations:
+//  - textures blurrier than requested stream in one level per update, highest priority and
+//    biggest deficit first, at most MaxStreamInsPerUpdate at a time;
+//  - room is made by dropping detail nobody requested, least recently used first, and then by
+//    taking levels from requested textures of lower priority than the one streaming in (a
+//    stream-in that can't be fit this way waits, nothing is evicted for it);
+//  - levels from the tail (tailMip and smaller) never leave.
+// Stream-ins are asynchronous: their bytes count as in flight until CompleteStreamIn.
+// With a release delay (see SetReleaseDelay) a residency change is modelled as what the
+// renderer really does: a new allocation for the new range of levels replaces the old one,
+// which stays alive for a few more frames.
+// Pure bookkeeping without any graphics API, so usage traces can be replayed offline.
+class ResidencyPolicy
+{
+  public:
+	static constexpr uint32_t InvalidMip = 0xFFFFFFFFu;
+	static constexpr uint32_t MaxStreamInsPerUpdate = 8;
+
+	void SetBudget(uint64_t bytes)
+	{
+		m_budget = bytes;
+	}
+	uint64_t GetBudget() const
+	{
+		return m_budget;
+	}
+
+	// updates = how many Update() calls a replaced allocation stays alive (the renderer
+	// releases it with a frame delay). Its bytes count against the budget until then, and a
+	// stream-in reserves the whole new allocation, not just the added level. 0 = levels are
+	// added and removed in place
+	void SetReleaseDelay(uint32_t updates)
+	{
+		m_releaseDelay = updates;
+	}
+
+	// mipBytes[i] is the size of level i (0 = full resolution). Levels tailMip and smaller are
+	// resident from the start and count against the budget right away
+	uint32_t Register(const std::vector<uint64_t>& mipBytes, uint32_t tailMip)
+	{
+		Entry entry;
+		entry.Alive = true;
+		entry.BytesFrom.assign(mipBytes.size() + 1, 0);
+		for (size_t i = mipBytes.size(); i-- > 0;)
+			entry.BytesFrom[i] = entry.BytesFrom[i + 1] + mipBytes[i];
+		entry.TailMip = mipBytes.empty() ? 0 : std::min(tailMip, (uint32_t)mipBytes.size() - 1);
+		entry.Resident = entry.TailMip;
+		m_resident += entry.BytesFrom[entry.Resident];
+
+		uint32_t id;
+		if (!m_freeIds.empty())
+		{
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+			m_entries[id] = entry;
+		}
+		else
+		{
+			id = (uint32_t)m_entries.size();
+			m_entries.push_back(entry);
+		}
+		return id;
+	}
+
+	void Unregister(uint32_t texture)
+	{
+		if (!IsValid(texture))
+			return;
+		Entry& entry = m_entries[texture];
+		m_resident -= entry.BytesFrom[entry.Resident];
+		Retire(entry.BytesFrom[entry.Resident]);
+		if (entry.Pending != InvalidMip)
+			m_inFlight -= entry.Reserved;
+		entry = Entry();
+		m_freeIds.push_back(texture);
+	}
+
+	// Several requests in one frame keep the most detailed mip and the highest priority
+	void RequestMip(uint32_t texture, uint32_t mip, float priority = 1.0f)
+	{
+		if (!IsValid(texture))
+			return;
+		Entry& entry = m_entries[texture];
+		mip = std::min(mip, entry.TailMip);
+		if (entry.LastRequested != m_update)
+		{
+			entry.LastRequested = m_update;
+			entry.Requested = mip;
+			entry.Priority = priority;
+		}
+		else
+		{
+			entry.Requested = std::min(entry.Requested, mip);
+			entry.Priority = std::max(entry.Priority, priority);
+		}
+	}
+
+	// Mip to ask for when a texture of textureSize texels covers screenSize pixels (per axis)
+	static uint32_t MipForScreenSize(uint32_t textureSize, float screenSize)
+	{
+		uint32_t mip = 0;
+		float size = (float)textureSize;
+		while (size > 1.0f && size * 0.5f >= screenSize)
+		{
+			size *= 0.5f;
+			++mip;
+		}
+		return mip;
+	}
+
+	// Ends the frame: requests made since the previous call are turned into operations
+	void Update(std::vector<ResidencyOp>& ops)
+	{
+		while (!m_retiring.empty() && m_retiring.front().FreedAt <= m_update)
+		{
+			m_retiringBytes -= m_retiring.front().Bytes;
+			m_retiring.pop_front();
+		}
+
+		// Budget may have shrunk: give back unrequested detail first, then low priority detail.
+		// Retiring bytes are not evicted for, they go away by themselves
+		if (m_resident + m_inFlight > m_budget)
+			MakeRoom(m_resident + m_inFlight - m_budget, InvalidMip, 0.0f, ops);
+
+		m_candidates.clear();
+		for (uint32_t id = 0; id < (uint32_t)m_entries.size(); ++id)
+		{
+			const Entry& entry = m_entries[id];
+			if (entry.Alive && entry.Pending == InvalidMip && GetWanted(entry) < entry.Resident)
+				m_candidates.push_back(id);
+		}
+		std::sort(m_candidates.begin(), m_candidates.end(), [this](uint32_t a, uint32_t b) {
+			const Entry& ea = m_entries[a];
+			const Entry& eb = m_entries[b];
+			if (ea.Priority != eb.Priority)
+				return ea.Priority > eb.Priority;
+			uint32_t deficitA = ea.Resident - GetWanted(ea);
+			uint32_t deficitB = eb.Resident - GetWanted(eb);
+			if (deficitA != deficitB)
+				return deficitA > deficitB;
+			return a < b;
+		});
+
+		// Stream-ins waiting for retiring bytes keep the room made for them, so the ones after
+		// them make their own and the old allocations are released together, not one by one
+		uint64_t waiting = 0;
+		uint32_t issued = 0;
+		for (uint32_t id : m_candidates)
+		{
+			if (issued >= MaxStreamInsPerUpdate)
+				break;
+			Entry& entry = m_entries[id];
+			// Just lost a level to a more important texture, don't bring it straight back
+			if (entry.LastEvicted == m_update)
+				continue;
+			uint32_t target = entry.Resident - 1;
+			// A replacing stream-in needs the new allocation next to the old one until the swap
+			uint64_t cost = entry.BytesFrom[target];
+			if (m_releaseDelay == 0)
+				cost -= entry.BytesFrom[entry.Resident];
+
+			if (m_resident + m_inFlight + waiting + cost > m_budget)
+			{
+				uint64_t needed = m_resident + m_inFlight + waiting + cost - m_budget;
+				if (!MakeRoom(needed, id, entry.Priority, ops))
+					continue;
+			}
+			// Evicted or replaced allocations still alive: wait until they are freed
+			if (m_resident + m_inFlight + m_retiringBytes + waiting + cost > m_budget)
+			{
+				waiting += cost;
+				++issued;
+				continue;
+			}
+
+			entry.Pending = target;
+			entry.Reserved = cost;
+			m_inFlight += cost;
+			ops.push_back({ResidencyOp::Type::StreamIn, id, target});
+			++m_stats.StreamIns;
+			++issued;
+		}
+
+		m_stats.Budget = m_budget;
+		m_stats.ResidentBytes = m_resident;
+		m_stats.InFlightBytes = m_inFlight;
+		m_stats.RetiringBytes = m_retiringBytes;
+		uint64_t used = m_resident + m_inFlight + m_retiringBytes;
+		m_stats.PeakBytes = std::max(m_stats.PeakBytes, used);
+		m_stats.Textures = (uint32_t)(m_entries.size() - m_freeIds.size());
+		++m_stats.Updates;
+		if (used > m_budget)
+			++m_stats.OverBudgetUpdates;
+
+		m_stats.UnsatisfiedRequests = 0;
+		for (const Entry& entry : m_entries)
+		{
+			if (entry.Alive && entry.LastRequested == m_update && entry.Resident > entry.Requested)
+				++m_stats.UnsatisfiedRequests;
+		}
+
+		++m_update;
+	}
+
+	// The level from a StreamIn op is loaded and in use
+	void CompleteStreamIn(uint32_t texture)
+	{
+		if (!IsValid(texture) || m_entries[texture].Pending == InvalidMip)
+			return;
+		Entry& entry = m_entries[texture];
+		m_inFlight -= entry.Reserved;
+		m_resident += entry.BytesFrom[entry.Pending] - entry.BytesFrom[entry.Resident];
+		Retire(entry.BytesFrom[entry.Resident]);
+		entry.Resident = entry.Pending;
+		entry.Pending = InvalidMip;
+		entry.Reserved = 0;
+	}
+
+	// Load failed or was dropped: the reservation is returned, the level may be asked for again
+	void CancelStreamIn(uint32_t texture)
+	{
+		if (!IsValid(texture) || m_entries[texture].Pending == InvalidMip)
+			return;
+		Entry& entry = m_entries[texture];
+		m_inFlight -= entry.Reserved;
+		entry.Pending = InvalidMip;
+		entry.Reserved = 0;
+	}
+
+	uint32_t GetResidentMip(uint32_t texture) const
+	{
+		return IsValid(texture) ? m_entries[texture].Resident : InvalidMip;
+	}
+	bool IsStreaming(uint32_t texture) const
+	{
+		return IsValid(texture) && m_entries[texture].Pending != InvalidMip;
+	}
+	const ResidencyStats& GetStats() const
+	{
+		return m_stats;
+	}
+
+  private:
+	struct Entry
+	{
+		std::vector<uint64_t> BytesFrom; // BytesFrom[m] = size of levels m..last
+		uint32_t TailMip = 0;
+		uint32_t Resident = 0;
+		uint32_t Pending = InvalidMip;
+		uint64_t Reserved = 0; // In flight bytes of the pending stream-in
+		uint32_t Requested = InvalidMip;
+		uint64_t LastRequested = ~0ull;
+		uint64_t LastEvicted = ~0ull;
+		float Priority = 0.0f;
+		bool Alive = false;
+	};
+
+	bool IsValid(uint32_t texture) const
+	{
+		return texture < m_entries.size() && m_entries[texture].Alive;
+	}
+
+	// Detail the texture should have after this frame: what was requested, or just the tail
+	uint32_t GetWanted(const Entry& entry) const
+	{
+		return entry.LastRequested == m_update ? entry.Requested : entry.TailMip;
+	}
+
+	// protect = texture that needs the room (never a victim), priority = its priority.
+	// InvalidMip = the budget shrank, then everything above the tails may go
+	bool MakeRoom(uint64_t needed, uint32_t protect, float priority, std::vector<ResidencyOp>& ops)
+	{
+		// 1. Detail beyond what the texture wants, least recently requested first
+		m_victims.clear();
+		m_lowPriority.clear();
+		uint64_t available = 0;
+		for (uint32_t id = 0; id < (uint32_t)m_entries.size(); ++id)
+		{
+			const Entry& entry = m_entries[id];
+			if (id == protect || !entry.Alive || entry.Pending != InvalidMip)
+				continue;
+			uint32_t wanted = GetWanted(entry);
+			if (entry.Resident < wanted)
+			{
+				m_victims.push_back(id);
+				available += entry.BytesFrom[entry.Resident] - entry.BytesFrom[wanted];
+				// 2. Requested detail of textures that matter less
+				if (wanted < entry.TailMip && (protect == InvalidMip || entry.Priority < priority))
+				{
+					m_lowPriority.push_back(id);
+					available += entry.BytesFrom[wanted] - entry.BytesFrom[entry.TailMip];
+				}
+			}
+			else if (entry.Resident < entry.TailMip && (protect == InvalidMip || entry.Priority < priority))
+			{
+				m_lowPriority.push_back(id);
+				available += entry.BytesFrom[entry.Resident] - entry.BytesFrom[entry.TailMip];
+			}
+		}
+		if (available < needed && protect != InvalidMip)
+			return false;
+
+		std::sort(m_victims.begin(), m_victims.end(), [this](uint32_t a, uint32_t b) {
+			const Entry& ea = m_entries[a];
+			const Entry& eb = m_entries[b];
+			uint64_t lastA = ea.LastRequested == ~0ull ? 0 : ea.LastRequested + 1;
+			uint64_t lastB = eb.LastRequested == ~0ull ? 0 : eb.LastRequested + 1;
+			if (lastA != lastB)
+				return lastA < lastB;
+			if (ea.Priority != eb.Priority)
+				return ea.Priority < eb.Priority;
+			return a < b;
+		});
+
+		uint64_t freed = 0;
+		for (uint32_t id : m_victims)
+		{
+			if (freed >= needed)
+				return true;
+			freed += Evict(id, GetWanted(m_entries[id]), ops);
+		}
+
+		std::sort(m_lowPriority.begin(), m_lowPriority.end(), [this](uint32_t a, uint32_t b) {
+			const Entry& ea = m_entries[a];
+			const Entry& eb = m_entries[b];
+			if (ea.Priority != eb.Priority)
+				return ea.Priority < eb.Priority;
+			return a < b;
+		});
+		for (uint32_t id : m_lowPriority)
+		{
+			while (freed < needed && m_entries[id].Resident < m_entries[id].TailMip)
+				freed += Evict(id, m_entries[id].Resident + 1, ops);
+			if (freed >= needed)
+				return true;
+		}
+		return freed >= needed;
+	}
+
+	uint64_t Evict(uint32_t texture, uint32_t mip, std::vector<ResidencyOp>& ops)
+	{
+		Entry& entry = m_entries[texture];
+		uint64_t freed = entry.BytesFrom[entry.Resident] - entry.BytesFrom[mip];
+		m_resident -= freed;
+		// Several steps in one update are a single copy: only the original allocation retires
+		if (entry.LastEvicted != m_update)
+			Retire(entry.BytesFrom[entry.Resident]);
+		entry.Resident = mip;
+		entry.LastEvicted = m_update;
+		ops.push_back({ResidencyOp::Type::Evict, texture, mip});
+		++m_stats.Evictions;
+		return freed;
+	}
+
+	// The allocation of a texture was replaced; with a release delay it lives a while longer
+	void Retire(uint64_t bytes)
+	{
+		if (m_releaseDelay == 0 || bytes == 0)
+			return;
+		m_retiring.push_back({m_update + m_releaseDelay + 1, bytes});
+		m_retiringBytes += bytes;
+	}
+
+	struct RetiredAllocation
+	{
+		uint64_t FreedAt; // Update index from which it no longer counts
+		uint64_t Bytes;
+	};
+
+	std::vector<Entry> m_entries;
+	std::vector<uint32_t> m_freeIds;
+	std::vector<uint32_t> m_candidates;
+	std::vector<uint32_t> m_victims;
+	std::vector<uint32_t> m_lowPriority;
+	uint64_t m_budget = ~0ull;
+	uint64_t m_resident = 0;
+	uint64_t m_inFlight = 0;
+	uint64_t m_retiringBytes = 0;
+	std::deque<RetiredAllocation> m_retiring;
+	uint32_t m_releaseDelay = 0;
+	uint64_t m_update = 0;
+	ResidencyStats m_stats;
+};
@@ -2,24 +2,65 @@
 #include "Rendeructor.h"
 #include "BackendDX11.h"
 
+void ShaderPass::SetVertexShader(const std::string& path, const std::string& entryPoint) {
+    m_vertexShaderPath = path;
+    m_vertexShaderEntryPoint = entryPoint;
+    ++m_version;
+}
+
+void ShaderPass::SetPixelShader(const std::string& path, const std::string& entryPoint) {
+    m_pixelShaderPath = path;
+    m_pixelShaderEntryPoint = entryPoint;
+    ++m_version;
+}
+
+ShaderPermutationKey ShaderPass::AddFeature(const std::string& define) {
+    for (size_t i = 0; i < m_featureDefines.size(); ++i) {
+        if (m_featureDefines[i] == define) return 1u << i;
+    }
+    if (m_featureDefines.size() >= MaxFeatures) return 0;
+
+    m_featureDefines.push_back(define);
+    ++m_version;
+    return 1u << (m_featureDefines.size() - 1);
+}
+
+void ShaderPass::DeclareVariant(ShaderPermutationKey key) {
+    if (std::find(m_declaredVariants.begin(), m_declaredVariants.end(), key) == m_declaredVariants.end()) {
+        m_declaredVariants.push_back(key);
+    }
+}
+
 void ShaderPass::AddTexture(const std::string& name, const Texture& texture) {
     m_textures[name] = &texture;
+    ++m_version;
 }
 
 void ShaderPass::AddTexture(const std::string& name, const Texture3D& texture) {
     m_textures3D[name] = &texture;
+    ++m_version;
 }
 
 void ShaderPass::AddTexture(const std::string& name, const TextureCube& texture) {
     m_texturesCube[name] = &texture;
+    ++m_version;
 }
 
 void ShaderPass::AddSampler(const std::string& name, const Sampler& sampler) {
     m_samplers[name] = &sampler;
+    ++m_version;
 }
 
 void Sampler::Create(const std::string& filterName) {
+    Release();
     if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
         m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateSamplerResource(filterName);
     }
+}
+
+void Sampler::Release(uint32_t framesToWait) {
+    if (m_backendHandle.IsValid() && Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        Rendeructor::GetCurrent()->GetBackendAPI()->DestroySampler(m_backendHandle, framesToWait);
+    }
+    m_backendHandle = SamplerHandle();
 }
\ No newline at end of file
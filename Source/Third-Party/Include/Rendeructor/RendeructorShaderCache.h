@@ -0,0 +1,425 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// API-neutral copy of what the backend reflects from a compiled shader. The backend fills it
+// once after compiling, and on later launches rebuilds its own reflection from it without
+// touching the compiler or the reflection API.
+struct ShaderCacheVariable
+{
+	std::string Name;
+	uint32_t Offset = 0;
+	uint32_t Size = 0;
+};
+
+struct ShaderCacheConstantBuffer
+{
+	std::string Name;
+	uint32_t Slot = 0;
+	uint32_t Size = 0;
+	std::vector<ShaderCacheVariable> Variables;
+};
+
+struct ShaderCacheSlot
+{
+	std::string Name;
+	uint32_t Slot = 0;
+};
+
+// Vertex shader input parameter; the backend derives the input layout from it
+struct ShaderCacheInputElement
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex = 0;
+	uint32_t Mask = 0;
+};
+
+struct ShaderCacheEntry
+{
+	std::vector<uint8_t> Bytecode;
+	std::vector<ShaderCacheConstantBuffer> ConstantBuffers;
+	std::vector<ShaderCacheSlot> TextureSlots;
+	std::vector<ShaderCacheSlot> SamplerSlots;
+	std::vector<ShaderCacheInputElement> InputElements;
+};
+
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Content-addressed store of compiled shaders: one "<key>.shc" file per shader in a directory.
+// The key hashes everything that affects the compiler output (source text, the text of every
+// file it includes, defines, entry point, profile, flags and compiler version), so an edited
+// shader or include simply gets a new key and stale files are never read.
+class ShaderCache
+{
+  public:
+	static constexpr uint32_t FileMagic = 0x43485341; // "ASHC"
+	static constexpr uint32_t FormatVersion = 1;
+
+	ShaderCache() = default;
+	explicit ShaderCache(std::filesystem::path directory) : m_directory(std::move(directory))
+	{
+	}
+
+	void SetDirectory(std::filesystem::path directory)
+	{
+		m_directory = std::move(directory);
+	}
+	const std::filesystem::path& GetDirectory() const
+	{
+		return m_directory;
+	}
+
+	// Returns 0 if the source file cannot be read (nothing to cache then). Includes are looked
+	// up relative to the including file, like D3D_COMPILE_STANDARD_FILE_INCLUDE does.
+	static uint64_t ComputeKey(const std::filesystem::path& sourcePath, const std::string& entryPoint,
+							   const std::string& profile, const ShaderDefines& defines, uint32_t flags,
+							   uint32_t compilerVersion)
+	{
+		std::string source;
+		if (!ReadTextFile(sourcePath, source))
+			return 0;
+
+		uint64_t hash = FnvOffset;
+		HashValue(hash, FormatVersion);
+		HashValue(hash, compilerVersion);
+		HashValue(hash, flags);
+		HashString(hash, entryPoint);
+		HashString(hash, profile);
+		for (const auto& define : defines)
+		{
+			HashString(hash, define.first);
+			HashString(hash, define.second);
+		}
+		HashString(hash, source);
+
+		std::set<std::filesystem::path> visited = {sourcePath.lexically_normal()};
+		HashIncludes(hash, sourcePath, source, visited);
+
+		return hash != 0 ? hash : 1;
+	}
+
+	bool Load(uint64_t key, ShaderCacheEntry& entry) const
+	{
+		if (m_directory.empty() || key == 0)
+			return false;
+
+		std::ifstream file(GetEntryPath(key), std::ios::binary);
+		if (!file)
+			return false;
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return Deserialize(data.data(), data.size(), key, entry);
+	}
+
+	// Writes to a temporary file first, so a crash or a second process never leaves a torn entry
+	bool Store(uint64_t key, const ShaderCacheEntry& entry) const
+	{
+		if (m_directory.empty() || key == 0)
+			return false;
+
+		std::error_code error;
+		std::filesystem::create_directories(m_directory, error);
+
+		std::filesystem::path path = GetEntryPath(key);
+		// Per-thread name: two passes sharing a shader may store the same key at the same time
+		std::filesystem::path tempPath = path;
+		tempPath += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+		std::vector<uint8_t> data = Serialize(key, entry);
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+			file.write((const char*)data.data(), (std::streamsize)data.size());
+			if (!file)
+				return false;
+		}
+
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	std::filesystem::path GetEntryPath(uint64_t key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.shc", (unsigned long long)key);
+		return m_directory / name;
+	}
+
+	static std::vector<uint8_t> Serialize(uint64_t key, const ShaderCacheEntry& entry)
+	{
+		std::vector<uint8_t> out;
+		Write(out, FileMagic);
+		Write(out, FormatVersion);
+		Write(out, key);
+
+		WriteBytes(out, entry.Bytecode.data(), entry.Bytecode.size());
+
+		Write(out, (uint32_t)entry.ConstantBuffers.size());
+		for (const auto& cb : entry.ConstantBuffers)
+		{
+			WriteString(out, cb.Name);
+			Write(out, cb.Slot);
+			Write(out, cb.Size);
+			Write(out, (uint32_t)cb.Variables.size());
+			for (const auto& variable : cb.Variables)
+			{
+				WriteString(out, variable.Name);
+				Write(out, variable.Offset);
+				Write(out, variable.Size);
+			}
+		}
+
+		WriteSlots(out, entry.TextureSlots);
+		WriteSlots(out, entry.SamplerSlots);
+
+		Write(out, (uint32_t)entry.InputElements.size());
+		for (const auto& element : entry.InputElements)
+		{
+			WriteString(out, element.SemanticName);
+			Write(out, element.SemanticIndex);
+			Write(out, element.Mask);
+		}
+		return out;
+	}
+
+	// Fails on a foreign, truncated or outdated file, or one written for a different key
+	static bool Deserialize(const uint8_t* data, size_t size, uint64_t key, ShaderCacheEntry& entry)
+	{
+		Reader reader = {data, data + size};
+
+		uint32_t magic = 0, version = 0;
+		uint64_t storedKey = 0;
+		if (!reader.Read(magic) || magic != FileMagic || !reader.Read(version) || version != FormatVersion ||
+			!reader.Read(storedKey) || storedKey != key)
+			return false;
+
+		ShaderCacheEntry result;
+		if (!reader.ReadBytes(result.Bytecode) || result.Bytecode.empty())
+			return false;
+
+		uint32_t bufferCount = 0;
+		if (!reader.ReadCount(bufferCount))
+			return false;
+		result.ConstantBuffers.resize(bufferCount);
+		for (auto& cb : result.ConstantBuffers)
+		{
+			uint32_t variableCount = 0;
+			if (!reader.ReadString(cb.Name) || !reader.Read(cb.Slot) || !reader.Read(cb.Size) ||
+				!reader.ReadCount(variableCount))
+				return false;
+			cb.Variables.resize(variableCount);
+			for (auto& variable : cb.Variables)
+			{
+				if (!reader.ReadString(variable.Name) || !reader.Read(variable.Offset) || !reader.Read(variable.Size))
+					return false;
+			}
+		}
+
+		if (!ReadSlots(reader, result.TextureSlots) || !ReadSlots(reader, result.SamplerSlots))
+			return false;
+
+		uint32_t elementCount = 0;
+		if (!reader.ReadCount(elementCount))
+			return false;
+		result.InputElements.resize(elementCount);
+		for (auto& element : result.InputElements)
+		{
+			if (!reader.ReadString(element.SemanticName) || !reader.Read(element.SemanticIndex) ||
+				!reader.Read(element.Mask))
+				return false;
+		}
+
+		if (reader.Cursor != reader.End)
+			return false;
+
+		entry = std::move(result);
+		return true;
+	}
+
+  private:
+	static constexpr uint64_t FnvOffset = 14695981039346656037ull;
+	static constexpr uint64_t FnvPrime = 1099511628211ull;
+
+	struct Reader
+	{
+		const uint8_t* Cursor;
+		const uint8_t* End;
+
+		template <typename T>
+		bool Read(T& value)
+		{
+			if ((size_t)(End - Cursor) < sizeof(T))
+				return false;
+			memcpy(&value, Cursor, sizeof(T));
+			Cursor += sizeof(T);
+			return true;
+		}
+		// Element count that can't exceed the remaining bytes, so a corrupt file can't make us allocate gigabytes
+		bool ReadCount(uint32_t& count)
+		{
+			return Read(count) && count <= (size_t)(End - Cursor);
+		}
+		bool ReadBytes(std::vector<uint8_t>& bytes)
+		{
+			uint32_t size = 0;
+			if (!ReadCount(size))
+				return false;
+			bytes.assign(Cursor, Cursor + size);
+			Cursor += size;
+			return true;
+		}
+		bool ReadString(std::string& text)
+		{
+			uint32_t size = 0;
+			if (!ReadCount(size))
+				return false;
+			text.assign((const char*)Cursor, size);
+			Cursor += size;
+			return true;
+		}
+	};
+
+	template <typename T>
+	static void Write(std::vector<uint8_t>& out, const T& value)
+	{
+		const uint8_t* bytes = (const uint8_t*)&value;
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+	static void WriteBytes(std::vector<uint8_t>& out, const void* data, size_t size)
+	{
+		Write(out, (uint32_t)size);
+		out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+	}
+	static void WriteString(std::vector<uint8_t>& out, const std::string& text)
+	{
+		WriteBytes(out, text.data(), text.size());
+	}
+	static void WriteSlots(std::vector<uint8_t>& out, const std::vector<ShaderCacheSlot>& slots)
+	{
+		Write(out, (uint32_t)slots.size());
+		for (const auto& slot : slots)
+		{
+			WriteString(out, slot.Name);
+			Write(out, slot.Slot);
+		}
+	}
+	static bool ReadSlots(Reader& reader, std::vector<ShaderCacheSlot>& slots)
+	{
+		uint32_t count = 0;
+		if (!reader.ReadCount(count))
+			return false;
+		slots.resize(count);
+		for (auto& slot : slots)
+		{
+			if (!reader.ReadString(slot.Name) || !reader.Read(slot.Slot))
+				return false;
+		}
+		return true;
+	}
+
+	static void HashData(uint64_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FnvPrime;
+		}
+	}
+	template <typename T>
+	static void HashValue(uint64_t& hash, const T& value)
+	{
+		HashData(hash, &value, sizeof(T));
+	}
+	// Length-prefixed, so ("ab", "c") and ("a", "bc") hash differently
+	static void HashString(uint64_t& hash, const std::string& text)
+	{
+		HashValue(hash, (uint64_t)text.size());
+		HashData(hash, text.data(), text.size());
+	}
+
+	static bool ReadTextFile(const std::filesystem::path& path, std::string& text)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		text.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// Hashes every #include'd file once, depth first in the order they appear. A directive inside
+	// a comment or a disabled #if block is hashed too: that can only cause an extra recompile.
+	static void HashIncludes(uint64_t& hash, const std::filesystem::path& filePath, const std::string& source,
+							 std::set<std::filesystem::path>& visited)
+	{
+		size_t lineStart = 0;
+		while (lineStart < source.size())
+		{
+			size_t lineEnd = source.find('\n', lineStart);
+			if (lineEnd == std::string::npos)
+				lineEnd = source.size();
+
+			std::string name;
+			if (ParseInclude(source, lineStart, lineEnd, name))
+			{
+				std::filesystem::path includePath = (filePath.parent_path() / name).lexically_normal();
+				HashString(hash, name);
+				if (visited.insert(includePath).second)
+				{
+					std::string includeSource;
+					if (ReadTextFile(includePath, includeSource))
+					{
+						HashString(hash, includeSource);
+						HashIncludes(hash, includePath, includeSource, visited);
+					}
+				}
+			}
+			lineStart = lineEnd + 1;
+		}
+	}
+
+	static bool ParseInclude(const std::string& source, size_t pos, size_t end, std::string& name)
+	{
+		auto skipSpaces = [&]() {
+			while (pos < end && (source[pos] == ' ' || source[pos] == '\t'))
+				++pos;
+		};
+
+		skipSpaces();
+		if (pos >= end || source[pos] != '#')
+			return false;
+		++pos;
+		skipSpaces();
+		if (source.compare(pos, 7, "include") != 0)
+			return false;
+		pos += 7;
+		skipSpaces();
+		if (pos >= end || (source[pos] != '"' && source[pos] != '<'))
+			return false;
+
+		char terminator = source[pos] == '"' ? '"' : '>';
+		size_t nameEnd = source.find(terminator, pos + 1);
+		if (nameEnd == std::string::npos || nameEnd >= end)
+			return false;
+		name = source.substr(pos + 1, nameEnd - pos - 1);
+		return !name.empty();
+	}
+
+	std::filesystem::path m_directory;
+};
@@ -0,0 +1,150 @@
+﻿#include "pch.h"
+#include "RendeructorStreamer.h"
+#include "Rendeructor.h"
+#include <iostream>
+
+// Старая текстура может быть в командах последних кадров
+static constexpr uint32_t ReleaseDelayFrames = 3;
+
+TextureStreamer::TextureStreamer() {
+    // Замененные текстуры живут еще ReleaseDelayFrames кадров и занимают память до тех пор
+    m_policy.SetReleaseDelay(ReleaseDelayFrames);
+}
+
+TextureStreamer::~TextureStreamer() {
+    m_loads.Stop();
+    for (auto& entry : m_entries) {
+        if (entry.Object) entry.Object->Release();
+    }
+}
+
+uint32_t TextureStreamer::Load(const std::string& path, bool srgb) {
+    std::vector<uint8_t> file;
+    DdsImage image;
+    if (!Texture::ReadDds(path, file, image)) return InvalidId;
+    if (image.IsCube) {
+        std::cerr << "[TextureStreamer] " << path << ": cube maps are not streamed" << std::endl;
+        return InvalidId;
+    }
+
+    // Хвост - первый уровень, который помещается в TailBytes, и все меньше него; он не выгружается
+    std::vector<uint64_t> mipBytes;
+    uint32_t tailMip = image.MipCount - 1;
+    for (uint32_t mip = 0; mip < image.MipCount; ++mip) {
+        mipBytes.push_back(image.Get(0, mip).Size);
+        if (image.Get(0, mip).Size <= TailBytes && tailMip == image.MipCount - 1) tailMip = mip;
+    }
+
+    auto object = std::make_unique<Texture>();
+    if (!object->CreateFromDds(image, tailMip, srgb, false)) return InvalidId;
+
+    uint32_t id = m_policy.Register(mipBytes, tailMip);
+    if (id >= m_entries.size()) m_entries.resize(id + 1);
+
+    Entry& entry = m_entries[id];
+    entry.Path = path;
+    entry.Srgb = srgb;
+    entry.FullSize = std::max(image.Width, image.Height);
+    entry.GpuMip = tailMip;
+    entry.Serial = m_nextSerial++;
+    entry.Object = std::move(object);
+
+    if (!m_loads.IsRunning()) m_loads.Start(1);
+    return id;
+}
+
+void TextureStreamer::Unload(uint32_t id) {
+    if (!IsValid(id)) return;
+    m_policy.Unregister(id);
+    // Загрузки, еще идущие для этой текстуры, отбросит несовпадение Serial
+    m_entries[id].Object->Release(ReleaseDelayFrames);
+    m_entries[id] = Entry();
+}
+
+const Texture& TextureStreamer::GetTexture(uint32_t id) const {
+    static const Texture empty;
+    return IsValid(id) ? *m_entries[id].Object : empty;
+}
+
+void TextureStreamer::RequestMip(uint32_t id, uint32_t mip, float priority) {
+    m_policy.RequestMip(id, mip, priority);
+}
+
+void TextureStreamer::RequestScreenSize(uint32_t id, float screenSize, float priority) {
+    if (!IsValid(id)) return;
+    m_policy.RequestMip(id, ResidencyPolicy::MipForScreenSize(m_entries[id].FullSize, screenSize), priority);
+}
+
+void TextureStreamer::Update() {
+    m_finished.clear();
+    m_loads.TakeCompleted(m_finished);
+    for (auto& result : m_finished) {
+        Install(result);
+    }
+    m_finished.clear();
+
+    m_ops.clear();
+    m_policy.Update(m_ops);
+
+    // Выгрузка сразу на потоке рендера, подъем уровня - чтение файла на рабочем потоке.
+    // Политика не выгружает текстуру, пока для нее идет загрузка, так что они не пересекаются
+    m_evicted.clear();
+    for (const ResidencyOp& op : m_ops) {
+        if (op.Kind == ResidencyOp::Type::Evict) {
+            // Несколько шагов выгрузки за кадр - одно пересоздание до итогового уровня
+            if (std::find(m_evicted.begin(), m_evicted.end(), op.Texture) != m_evicted.end()) continue;
+            m_evicted.push_back(op.Texture);
+            Evict(op.Texture, m_policy.GetResidentMip(op.Texture));
+            continue;
+        }
+
+        const Entry& entry = m_entries[op.Texture];
+        uint32_t id = op.Texture;
+        uint32_t serial = entry.Serial;
+        uint32_t mip = op.Mip;
+        std::string path = entry.Path;
+        m_loads.Enqueue([id, serial, mip, path]() {
+            LoadResult result;
+            result.Id = id;
+            result.Serial = serial;
+            result.Mip = mip;
+            result.Ok = Texture::ReadDds(path, result.File, result.Image);
+            return result;
+        });
+    }
+}
+
+void TextureStreamer::Evict(uint32_t id, uint32_t mip) {
+    Entry& entry = m_entries[id];
+    if (mip <= entry.GpuMip) return;
+
+    // Оставшиеся уровни уже есть в текущей текстуре - копируем их на GPU
+    Texture smaller;
+    if (!smaller.CreateFromMips(*entry.Object, mip - entry.GpuMip)) {
+        std::cerr << "[TextureStreamer] Failed to evict " << entry.Path << " to mip " << mip << std::endl;
+        return;
+    }
+
+    entry.Object->Release(ReleaseDelayFrames);
+    *entry.Object = smaller;
+    entry.GpuMip = mip;
+}
+
+void TextureStreamer::Install(LoadResult& result) {
+    // Текстуру выгрузили, пока файл читался
+    if (!IsValid(result.Id) || m_entries[result.Id].Serial != result.Serial) return;
+    Entry& entry = m_entries[result.Id];
+
+    // Файл поменялся на диске и уровня больше нет - тоже ошибка
+    Texture fresh;
+    if (!result.Ok || result.Mip >= result.Image.MipCount || !fresh.CreateFromDds(result.Image, result.Mip, entry.Srgb, false)) {
+        std::cerr << "[TextureStreamer] Failed to reload " << entry.Path << " from mip " << result.Mip << std::endl;
+        m_policy.CancelStreamIn(result.Id);
+        return;
+    }
+
+    entry.Object->Release(ReleaseDelayFrames);
+    *entry.Object = fresh;
+    entry.GpuMip = result.Mip;
+    m_policy.CompleteStreamIn(result.Id);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "RendeructorDefines.h"
+#include "RendeructorResidency.h"
+#include "RendeructorCompileQueue.h"
+#include "RendeructorDDS.h"
+
+// Keeps the mip levels of DDS textures resident under a memory budget (see ResidencyPolicy).
+// Load() uploads only the mip tail (levels up to TailBytes in size); every frame the game
+// reports the detail it needs and Update() streams finer levels in from disk on a worker
+// thread and drops detail when the budget runs out. Dropping detail copies the kept levels
+// into a smaller texture on the GPU, the file isn't read again.
+//
+// D3D11 has no partially resident textures here, so a residency change recreates the GPU
+// texture with the new range of levels and swaps it into the same Texture object. Shader
+// passes read the handle on every bind and pick the new texture up by themselves; the old one
+// is destroyed after the frames that may still use it and counts against the budget until
+// then.
+class RENDER_API TextureStreamer
+{
+  public:
+	static constexpr uint64_t TailBytes = 64 * 1024;
+	static constexpr uint32_t InvalidId = 0xFFFFFFFFu;
+
+	TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+	~TextureStreamer();
+
+	void SetBudget(uint64_t bytes)
+	{
+		m_policy.SetBudget(bytes);
+	}
+
+	// Returns InvalidId if the file can't be read or isn't a 2D DDS texture. The texture lives
+	// until Unload() or the streamer's destruction
+	uint32_t Load(const std::string& path, bool srgb = true);
+	void Unload(uint32_t id);
+	// The object stays the same while the streamer swaps its GPU texture
+	const Texture& GetTexture(uint32_t id) const;
+
+	// mip 0 = full resolution. Call every frame for the textures in view, unrequested detail is
+	// the first to go
+	void RequestMip(uint32_t id, uint32_t mip, float priority = 1.0f);
+	// screenSize = pixels the texture covers on screen along its larger side
+	void RequestScreenSize(uint32_t id, float screenSize, float priority = 1.0f);
+
+	// Once per frame on the render thread: installs finished loads and starts new ones
+	void Update();
+
+	uint32_t GetResidentMip(uint32_t id) const
+	{
+		return m_policy.GetResidentMip(id);
+	}
+	const ResidencyStats& GetStats() const
+	{
+		return m_policy.GetStats();
+	}
+
+  private:
+	struct Entry
+	{
+		std::string Path;
+		bool Srgb = true;
+		uint32_t FullSize = 0;
+		uint32_t GpuMip = 0; // Most detailed level of the current GPU texture
+		uint32_t Serial = 0; // Tells a reused id from the texture a late load was started for
+		std::unique_ptr<Texture> Object;
+	};
+
+	struct LoadResult
+	{
+		uint32_t Id = 0;
+		uint32_t Serial = 0;
+		uint32_t Mip = 0;
+		std::vector<uint8_t> File;
+		DdsImage Image;
+		bool Ok = false;
+	};
+
+	bool IsValid(uint32_t id) const
+	{
+		return id < m_entries.size() && m_entries[id].Object;
+	}
+	void Install(LoadResult& result);
+	void Evict(uint32_t id, uint32_t mip);
+
+	ResidencyPolicy m_policy;
+	std::vector<Entry> m_entries; // Indexed by the policy's texture id
+	BackgroundCompileQueue<LoadResult> m_loads;
+	std::vector<ResidencyOp> m_ops;
+	std::vector<uint32_t> m_evicted;
+	std::vector<LoadResult> m_finished;
+	uint32_t m_nextSerial = 1;
+};
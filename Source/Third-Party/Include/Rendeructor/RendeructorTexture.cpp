@@ -1,11 +1,17 @@
 #include "pch.h"
 #include "Rendeructor.h"
 #include "BackendDX11.h"
+#include "RendeructorMipChain.h"
+#include "RendeructorDDS.h"
+#include "RendeructorCompileQueue.h"
+#include <chrono>
+#include <fstream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image/stb_image.h>
 
 void Texture::Create(int width, int height, TextureFormat format, const void* data) {
+    Release();
     m_width = width;
     m_height = height;
     m_format = format;
@@ -14,24 +20,206 @@ void Texture::Create(int width, int height, TextureFormat format, const void* da
     }
 }
 
-bool Texture::LoadFromDisk(const std::string& path) {
+static TextureFormat ToTextureFormat(DdsFormat format) {
+    switch (format) {
+    case DdsFormat::BGRA8: return TextureFormat::BGRA8;
+    case DdsFormat::BGRX8: return TextureFormat::BGRX8;
+    case DdsFormat::RGBA16F: return TextureFormat::RGBA16F;
+    case DdsFormat::RGBA32F: return TextureFormat::RGBA32F;
+    case DdsFormat::BC1: return TextureFormat::BC1;
+    case DdsFormat::BC2: return TextureFormat::BC2;
+    case DdsFormat::BC3: return TextureFormat::BC3;
+    case DdsFormat::BC4: return TextureFormat::BC4;
+    case DdsFormat::BC5: return TextureFormat::BC5;
+    case DdsFormat::BC6H: return TextureFormat::BC6H;
+    case DdsFormat::BC7: return TextureFormat::BC7;
+    default: return TextureFormat::RGBA8;
+    }
+}
+
+static bool IsDdsPath(const std::string& path) {
+    if (path.size() < 4) return false;
+    std::string ext = path.substr(path.size() - 4);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return ext == ".dds";
+}
+
+//    ;  DdsImage     
+static bool LoadDds(const std::string& path, std::vector<uint8_t>& file, DdsImage& image) {
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream) return false;
+    std::streamoff size = stream.tellg();
+    if (size <= 0) return false;
+    file.resize((size_t)size);
+    stream.seekg(0);
+    if (!stream.read((char*)file.data(), size)) return false;
+
+    std::string error;
+    if (!DdsParser::Parse(file.data(), file.size(), image, &error)) {
+        std::cerr << "[Texture] " << path << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ,    GPU: , , .   API,     
+struct DecodedImage {
+    bool Ok = false;
+    bool IsDds = false;
+    std::vector<uint8_t> File; // DDS , Dds   
+    DdsImage Dds;
+    MipChain Mips;
+};
+
+static DecodedImage DecodeImage(const std::string& path, bool srgb, bool generateMips) {
+    DecodedImage image;
+    if (IsDdsPath(path)) {
+        image.IsDds = true;
+        image.Ok = LoadDds(path, image.File, image.Dds);
+        if (image.Ok && image.Dds.IsCube) {
+            std::cerr << "[Texture] " << path << " is a cube map, use TextureCube::LoadFromDisk" << std::endl;
+            image.Ok = false;
+        }
+        return image;
+    }
+
     int w, h, channels;
     unsigned char* data = stbi_load(path.c_str(), &w, &h, &channels, 4);
-
     if (!data) {
-        return false;
+        return image;
     }
 
-    m_width = w;
-    m_height = h;
+    //     CPU,   GPU      
+    image.Mips.Generate(data, w, h, srgb, generateMips ? 0 : 1);
+    stbi_image_free(data);
+    image.Ok = true;
+    return image;
+}
+
+bool Texture::LoadFromDisk(const std::string& path, bool srgb, bool generateMips) {
+    return Upload(DecodeImage(path, srgb, generateMips), srgb, generateMips);
+}
+
+bool Texture::Upload(const DecodedImage& image, bool srgb, bool generateMips) {
+    if (!image.Ok) return false;
+    if (image.IsDds) return CreateFromDds(image.Dds, 0, srgb, generateMips);
+
+    Release();
+    m_width = image.Mips.GetWidth(0);
+    m_height = image.Mips.GetHeight(0);
     m_format = TextureFormat::RGBA8;
 
+    std::vector<const void*> levels = image.Mips.GetLevelPointers();
     if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
-        m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateTextureResource(w, h, (int)m_format, data);
+        m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateSampledTexture(m_width, m_height, (int)m_format, levels.data(), (int)levels.size());
     }
+    return m_backendHandle.IsValid();
+}
 
-    stbi_image_free(data);
-    return (m_backendHandle != nullptr);
+TextureBatchStats Texture::LoadBatch(const std::vector<TextureLoadRequest>& requests, uint32_t threadCount) {
+    using Clock = std::chrono::steady_clock;
+    auto toMs = [](Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+    auto batchStart = Clock::now();
+
+    TextureBatchStats stats;
+    if (requests.empty()) return stats;
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    stats.Threads = std::min(threadCount, (uint32_t)requests.size());
+
+    struct Decoded {
+        size_t Index;
+        DecodedImage Image;
+        double Ms;
+    };
+
+    //   ;   ,    
+    BackgroundCompileQueue<Decoded> decoder;
+    decoder.Start(stats.Threads);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const TextureLoadRequest& request = requests[i];
+        decoder.Enqueue([i, &request, toMs]() {
+            auto start = Clock::now();
+            Decoded decoded = { i, DecodeImage(request.Path, request.Srgb, request.GenerateMips), 0.0 };
+            decoded.Ms = toMs(Clock::now() - start);
+            return decoded;
+        });
+    }
+
+    std::vector<Decoded> finished;
+    size_t done = 0;
+    while (done < requests.size()) {
+        decoder.WaitForResults();
+        finished.clear();
+        decoder.TakeCompleted(finished);
+
+        for (auto& decoded : finished) {
+            ++done;
+            stats.DecodeMs += decoded.Ms;
+
+            const TextureLoadRequest& request = requests[decoded.Index];
+            auto uploadStart = Clock::now();
+            bool loaded = request.Target && request.Target->Upload(decoded.Image, request.Srgb, request.GenerateMips);
+            stats.UploadMs += toMs(Clock::now() - uploadStart);
+
+            if (loaded) {
+                ++stats.Loaded;
+            }
+            else {
+                ++stats.Failed;
+                std::cerr << "[Texture] Failed to load " << request.Path << std::endl;
+            }
+        }
+    }
+    decoder.Stop();
+
+    stats.TotalMs = toMs(Clock::now() - batchStart);
+    return stats;
+}
+
+bool Texture::CreateFromDds(const DdsImage& image, uint32_t firstMip, bool srgb, bool generateMips) {
+    if (firstMip >= image.MipCount) return false;
+
+    Release();
+    m_width = (int)image.Get(0, firstMip).Width;
+    m_height = (int)image.Get(0, firstMip).Height;
+    m_format = ToTextureFormat(image.Format);
+
+    //        GPU  ;  -   
+    std::vector<const void*> levels;
+    for (uint32_t mip = firstMip; mip < image.MipCount; ++mip) {
+        levels.push_back(image.Get(0, mip).Data);
+    }
+
+    //  8-   :  ,    
+    MipChain mips;
+    bool bytePixels = image.Format == DdsFormat::RGBA8 || image.Format == DdsFormat::BGRA8 || image.Format == DdsFormat::BGRX8;
+    if (generateMips && image.MipCount == 1 && bytePixels) {
+        mips.Generate(image.Get(0, 0).Data, m_width, m_height, srgb);
+        levels = mips.GetLevelPointers();
+    }
+
+    if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateSampledTexture(m_width, m_height, (int)m_format, levels.data(), (int)levels.size());
+    }
+    return m_backendHandle.IsValid();
+}
+
+bool Texture::CreateFromMips(const Texture& source, uint32_t firstMip) {
+    if (&source == this) return false;
+
+    Release();
+    m_width = std::max(1, source.m_width >> firstMip);
+    m_height = std::max(1, source.m_height >> firstMip);
+    m_format = source.m_format;
+
+    if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateTextureFromMips(source.GetHandle(), (int)firstMip);
+    }
+    return m_backendHandle.IsValid();
+}
+
+bool Texture::ReadDds(const std::string& path, std::vector<uint8_t>& file, DdsImage& image) {
+    return LoadDds(path, file, image);
 }
 
 void Texture::Copy(const Texture& source) {
@@ -40,27 +228,62 @@ void Texture::Copy(const Texture& source) {
     }
 }
 
+void Texture::Release(uint32_t framesToWait) {
+    if (m_backendHandle.IsValid() && Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        Rendeructor::GetCurrent()->GetBackendAPI()->DestroyTexture(m_backendHandle, framesToWait);
+    }
+    m_backendHandle = TextureHandle();
+}
+
 void Texture3D::Create(int width, int height, int depth, const void* data) {
+    Release();
     if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
         m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateTexture3DResource(width, height, depth, 0, data);
     }
 }
 
+void Texture3D::Release(uint32_t framesToWait) {
+    if (m_backendHandle.IsValid() && Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        Rendeructor::GetCurrent()->GetBackendAPI()->DestroyTexture(m_backendHandle, framesToWait);
+    }
+    m_backendHandle = TextureHandle();
+}
+
 bool TextureCube::LoadFromFiles(const std::vector<std::string>& paths) {
     if (paths.size() != 6) {
         std::cerr << "[TextureCube] Error: Need exactly 6 file paths." << std::endl;
         return false;
     }
 
+    //   ,    
+    struct Face {
+        unsigned char* Data;
+        int Width, Height;
+    };
+    std::vector<Face> faces(6, Face{ nullptr, 0, 0 });
+    {
+        BackgroundCompileQueue<int> decoder;
+        decoder.Start(std::min(6u, std::max(1u, std::thread::hardware_concurrency())));
+        for (int i = 0; i < 6; i++) {
+            decoder.Enqueue([i, &paths, &faces]() {
+                int c;
+                //   4  (RGBA)
+                faces[i].Data = stbi_load(paths[i].c_str(), &faces[i].Width, &faces[i].Height, &c, 4);
+                return i;
+            });
+        }
+        decoder.WaitIdle();
+    }
+
     //   
     std::vector<const void*> pixelData(6, nullptr);
-    int width = 0, height = 0, channels = 0;
+    int width = 0, height = 0;
     bool success = true;
 
     for (int i = 0; i < 6; i++) {
-        int w, h, c;
-        //   4  (RGBA)
-        unsigned char* data = stbi_load(paths[i].c_str(), &w, &h, &c, 4);
+        int w = faces[i].Width, h = faces[i].Height;
+        unsigned char* data = faces[i].Data;
+        faces[i].Data = nullptr;
 
         if (!data) {
             std::cerr << "[TextureCube] Failed to load face: " << paths[i] << std::endl;
@@ -83,14 +306,50 @@ bool TextureCube::LoadFromFiles(const std::vector<std::string>& paths) {
     }
 
     if (success && Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        Release();
         //   
         m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateTextureCubeResource(width, height, (int)TextureFormat::RGBA8, pixelData.data());
     }
 
-    //   STB
+    //   STB,    ,   
     for (auto ptr : pixelData) {
         if (ptr) stbi_image_free((void*)ptr);
     }
+    for (auto& face : faces) {
+        if (face.Data) stbi_image_free(face.Data);
+    }
+
+    return m_backendHandle.IsValid();
+}
 
-    return (m_backendHandle != nullptr);
+bool TextureCube::LoadFromDisk(const std::string& path) {
+    std::vector<uint8_t> file;
+    DdsImage image;
+    if (!LoadDds(path, file, image)) return false;
+    if (!image.IsCube) {
+        std::cerr << "[TextureCube] " << path << " is not a cube map" << std::endl;
+        return false;
+    }
+
+    //    DDS   D3D: +X, -X, +Y, -Y, +Z, -Z
+    std::vector<const void*> levels;
+    for (uint32_t face = 0; face < 6; ++face) {
+        for (uint32_t mip = 0; mip < image.MipCount; ++mip) {
+            levels.push_back(image.Get(face, mip).Data);
+        }
+    }
+
+    if (Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        Release();
+        m_backendHandle = Rendeructor::GetCurrent()->GetBackendAPI()->CreateSampledTexture(
+            (int)image.Width, (int)image.Height, (int)ToTextureFormat(image.Format), levels.data(), (int)image.MipCount, true);
+    }
+    return m_backendHandle.IsValid();
+}
+
+void TextureCube::Release(uint32_t framesToWait) {
+    if (m_backendHandle.IsValid() && Rendeructor::GetCurrent() && Rendeructor::GetCurrent()->GetBackendAPI()) {
+        Rendeructor::GetCurrent()->GetBackendAPI()->DestroyTexture(m_backendHandle, framesToWait);
+    }
+    m_backendHandle = TextureHandle();
 }
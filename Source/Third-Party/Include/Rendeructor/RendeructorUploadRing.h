@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Offset bookkeeping for a linear ring over one large CPU-writable GPU buffer. Allocations
+// are appended at the head; at the end of each frame the head position is fenced with the
+// frame index, and once the backend reports that frame as finished on the GPU the tail jumps
+// past it. Space still read by in-flight frames is therefore never handed out again.
+// Knows nothing about the graphics API, the backend maps the returned offsets.
+class UploadRing
+{
+  public:
+	static constexpr uint64_t InvalidOffset = ~0ull;
+
+	UploadRing() = default;
+	explicit UploadRing(uint64_t capacity)
+	{
+		Reset(capacity);
+	}
+
+	void Reset(uint64_t capacity)
+	{
+		m_capacity = capacity;
+		m_head = 0;
+		m_tail = 0;
+		m_fences.clear();
+	}
+
+	// Returns the byte offset of the allocation, or InvalidOffset if in-flight frames still
+	// hold the space. wrapped is set when the allocation restarted at offset 0.
+	uint64_t Allocate(uint64_t size, uint64_t alignment, bool& wrapped)
+	{
+		wrapped = false;
+		if (size == 0 || size > m_capacity)
+			return InvalidOffset;
+		if (alignment == 0)
+			alignment = 1;
+
+		uint64_t position = m_head;
+		uint64_t offset = position % m_capacity;
+
+		uint64_t alignPad = (alignment - offset % alignment) % alignment;
+		if (offset + alignPad + size > m_capacity)
+		{
+			// Not enough room before the end: skip the rest of the buffer and start over at 0
+			position += m_capacity - offset;
+			offset = 0;
+			alignPad = 0;
+			wrapped = true;
+		}
+		position += alignPad;
+		offset += alignPad;
+
+		if (position + size - m_tail > m_capacity)
+		{
+			wrapped = false;
+			return InvalidOffset;
+		}
+
+		m_head = position + size;
+		return offset;
+	}
+
+	// Everything allocated so far belongs to frameIndex or earlier. A frame that allocated
+	// nothing adds no fence: the space behind the last one still belongs to its older frame
+	void EndFrame(uint64_t frameIndex)
+	{
+		if (m_head != (m_fences.empty() ? m_tail : m_fences.back().Position))
+			m_fences.push_back({frameIndex, m_head});
+	}
+
+	// The GPU has finished every frame up to and including completedFrame
+	void ReleaseCompletedFrames(uint64_t completedFrame)
+	{
+		while (!m_fences.empty() && m_fences.front().Frame <= completedFrame)
+		{
+			m_tail = m_fences.front().Position;
+			m_fences.pop_front();
+		}
+	}
+
+	uint64_t GetCapacity() const
+	{
+		return m_capacity;
+	}
+	// Bytes that are allocated and not yet released (including skipped space at a wrap)
+	uint64_t GetUsedBytes() const
+	{
+		return m_head - m_tail;
+	}
+
+  private:
+	struct Fence
+	{
+		uint64_t Frame;
+		uint64_t Position;
+	};
+
+	// Monotonic positions; the physical offset is position % capacity
+	uint64_t m_capacity = 0;
+	uint64_t m_head = 0;
+	uint64_t m_tail = 0;
+	std::deque<Fence> m_fences;
+};
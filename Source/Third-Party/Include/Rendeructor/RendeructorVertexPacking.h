@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// 20-byte vertex of meshes created with VertexLayout::Compact (Vertex takes 56):
+//  POSITION  R16G16B16A16_SNORM  xyz = position inside the mesh bounds, w = bitangent sign
+//  NORMAL    R16G16_SNORM        octahedral normal
+//  TANGENT   R16G16_SNORM        octahedral tangent
+//  TEXCOORD0 R16G16_FLOAT        uv
+// The vertex shader declares them as float4 / float2 / float2 / float2 and rebuilds the rest
+// with the mesh's dequantization constants (Mesh::GetPositionScale/GetPositionOffset, set by
+// the backend on every draw from the mesh's vertex buffer):
+//   position  = PositionOffset + input.Position.xyz * PositionScale
+//   normal    = OctDecode(input.Normal), tangent = OctDecode(input.Tangent)
+//   bitangent = cross(normal, tangent) * input.Position.w
+//   float3 OctDecode(float2 e)
+//   {
+//       float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+//       if (n.z < 0.0)
+//           n.xy = (1.0 - abs(n.yx)) * (n.xy >= 0.0 ? 1.0 : -1.0);
+//       return normalize(n);
+//   }
+struct CompactVertex
+{
+	int16_t Position[4];
+	int16_t Normal[2];
+	int16_t Tangent[2];
+	uint16_t UV[2];
+};
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must match the compact input layout");
+
+// Dequantized position = Offset + snorm * Scale, per axis
+struct PositionQuantization
+{
+	float Offset[3] = {0.0f, 0.0f, 0.0f};
+	float Scale[3] = {1.0f, 1.0f, 1.0f};
+};
+
+// Encoding and decoding of CompactVertex. Decoding mirrors what the GPU does, for tools and
+// error checks: positions are off by at most half a step (Scale / 32767) per axis, unit
+// vectors by less than 0.04 degrees, uvs keep 11 significant bits
+class VertexPacking
+{
+  public:
+	static PositionQuantization QuantizationFromBounds(const float boundsMin[3], const float boundsMax[3])
+	{
+		PositionQuantization quantization;
+		for (int i = 0; i < 3; ++i)
+		{
+			quantization.Offset[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+			quantization.Scale[i] = (boundsMax[i] - boundsMin[i]) * 0.5f;
+		}
+		return quantization;
+	}
+
+	// bitangentSign: +1 if bitangent = cross(normal, tangent), -1 if mirrored
+	static CompactVertex Pack(const float position[3], const float normal[3], const float tangent[3], float bitangentSign,
+							  const float uv[2], const PositionQuantization& quantization)
+	{
+		CompactVertex vertex;
+		for (int i = 0; i < 3; ++i)
+		{
+			float scale = quantization.Scale[i];
+			vertex.Position[i] = ToSnorm16(scale > 0.0f ? (position[i] - quantization.Offset[i]) / scale : 0.0f);
+		}
+		vertex.Position[3] = bitangentSign < 0.0f ? -32767 : 32767;
+		OctEncode(normal, vertex.Normal);
+		OctEncode(tangent, vertex.Tangent);
+		vertex.UV[0] = ToHalf(uv[0]);
+		vertex.UV[1] = ToHalf(uv[1]);
+		return vertex;
+	}
+
+	static void Unpack(const CompactVertex& vertex, const PositionQuantization& quantization, float position[3], float normal[3],
+					   float tangent[3], float& bitangentSign, float uv[2])
+	{
+		for (int i = 0; i < 3; ++i)
+			position[i] = quantization.Offset[i] + FromSnorm16(vertex.Position[i]) * quantization.Scale[i];
+		bitangentSign = vertex.Position[3] < 0 ? -1.0f : 1.0f;
+		OctDecode(vertex.Normal, normal);
+		OctDecode(vertex.Tangent, tangent);
+		uv[0] = FromHalf(vertex.UV[0]);
+		uv[1] = FromHalf(vertex.UV[1]);
+	}
+
+	static int16_t ToSnorm16(float value)
+	{
+		value = std::clamp(value, -1.0f, 1.0f);
+		return (int16_t)std::lround(value * 32767.0f);
+	}
+	static float FromSnorm16(int16_t value)
+	{
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	// Round to nearest even, overflow goes to infinity
+	static uint16_t ToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+		uint32_t magnitude = bits & 0x7FFFFFFF;
+
+		if (magnitude >= 0x7F800000) // Inf, NaN
+			return sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00);
+		if (magnitude >= 0x477FF000) // Rounds to 65536 or more
+			return sign | 0x7C00;
+
+		uint32_t exponent = magnitude >> 23;
+		if (exponent < 113) // Below the smallest normal half: subnormal or zero
+		{
+			uint32_t shift = 126 - exponent;
+			if (shift > 24)
+				return sign;
+			uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+			return sign | (uint16_t)RoundShift(mantissa, shift);
+		}
+		// Rebias the exponent; a mantissa carry correctly rolls into the exponent
+		return sign | (uint16_t)RoundShift(magnitude - 0x38000000, 13);
+	}
+
+	static float FromHalf(uint16_t value)
+	{
+		uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+		uint32_t exponent = (value >> 10) & 0x1F;
+		uint32_t mantissa = value & 0x3FF;
+		uint32_t bits;
+
+		if (exponent == 0x1F)
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		else if (exponent != 0)
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		else if (mantissa == 0)
+			bits = sign;
+		else
+		{
+			float subnormal = mantissa * (1.0f / 16777216.0f); // mantissa * 2^-24
+			memcpy(&bits, &subnormal, sizeof(bits));
+			bits |= sign;
+		}
+
+		float result;
+		memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	// Octahedral mapping of a unit vector to two snorm16. Of the four roundings around the exact
+	// point the one that decodes closest to the input is kept. A zero vector encodes as +Z
+	static void OctEncode(const float v[3], int16_t out[2])
+	{
+		float length = std::fabs(v[0]) + std::fabs(v[1]) + std::fabs(v[2]);
+		if (length <= 0.0f)
+		{
+			out[0] = out[1] = 0;
+			return;
+		}
+
+		float x = v[0] / length, y = v[1] / length;
+		if (v[2] < 0.0f)
+		{
+			float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		float normLength = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		float fx = std::floor(x * 32767.0f), fy = std::floor(y * 32767.0f);
+		float best = -2.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			int16_t candidate[2] = {ClampSnorm(fx + (i & 1)), ClampSnorm(fy + (i >> 1))};
+			float decoded[3];
+			OctDecode(candidate, decoded);
+			float similarity = (decoded[0] * v[0] + decoded[1] * v[1] + decoded[2] * v[2]) / normLength;
+			if (similarity > best)
+			{
+				best = similarity;
+				out[0] = candidate[0];
+				out[1] = candidate[1];
+			}
+		}
+	}
+
+	static void OctDecode(const int16_t e[2], float out[3])
+	{
+		float x = FromSnorm16(e[0]), y = FromSnorm16(e[1]);
+		float z = 1.0f - std::fabs(x) - std::fabs(y);
+		if (z < 0.0f)
+		{
+			float unfoldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float unfoldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+		float length = std::sqrt(x * x + y * y + z * z);
+		out[0] = x / length;
+		out[1] = y / length;
+		out[2] = z / length;
+	}
+
+  private:
+	static uint32_t RoundShift(uint32_t value, uint32_t shift)
+	{
+		uint32_t result = value >> shift;
+		uint32_t remainder = value & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (result & 1)))
+			++result;
+		return result;
+	}
+
+	static int16_t ClampSnorm(float value)
+	{
+		return (int16_t)std::clamp(value, -32767.0f, 32767.0f);
+	}
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "RendeructorHandles.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Contiguous storage for backend resources addressed by generation-checked handles.
+// Released slots go on a free list and are reused, so memory stays bounded by the peak
+// number of live resources. Pointers returned by Get() are only valid until the next Allocate().
+template <typename T, typename HandleType>
+class ResourcePool
+{
+  public:
+	HandleType Allocate(T&& value)
+	{
+		uint32_t index;
+		if (m_freeHead != HandleType::InvalidIndex)
+		{
+			index = m_freeHead;
+			m_freeHead = m_slots[index].NextFree;
+		}
+		else
+		{
+			index = (uint32_t)m_slots.size();
+			m_slots.emplace_back();
+		}
+
+		Slot& slot = m_slots[index];
+		slot.Value = std::move(value);
+		slot.Alive = true;
+		++m_liveCount;
+
+		HandleType handle;
+		handle.Index = index;
+		handle.Generation = slot.Generation;
+		return handle;
+	}
+
+	T* Get(HandleType handle)
+	{
+		if (handle.Index >= m_slots.size())
+			return nullptr;
+		Slot& slot = m_slots[handle.Index];
+		return (slot.Alive && slot.Generation == handle.Generation) ? &slot.Value : nullptr;
+	}
+
+	bool IsAlive(HandleType handle) const
+	{
+		return handle.Index < m_slots.size() && m_slots[handle.Index].Alive &&
+			   m_slots[handle.Index].Generation == handle.Generation;
+	}
+
+	// Destroys the resource now. Returns false for stale or invalid handles.
+	bool Release(HandleType handle)
+	{
+		if (!IsAlive(handle))
+			return false;
+
+		Slot& slot = m_slots[handle.Index];
+		slot.Value = T();
+		slot.Alive = false;
+		// Generation 0 is never handed out, default handles can't match a slot
+		if (++slot.Generation == 0)
+			slot.Generation = 1;
+		slot.NextFree = m_freeHead;
+		m_freeHead = handle.Index;
+		--m_liveCount;
+		return true;
+	}
+
+	// Destroys the resource once CollectGarbage() is called with releaseFrame or later.
+	// The handle stays valid until then, so in-flight frames can still use it.
+	void ReleaseDeferred(HandleType handle, uint64_t releaseFrame)
+	{
+		if (IsAlive(handle))
+			m_pending.push_back({handle, releaseFrame});
+	}
+
+	void CollectGarbage(uint64_t currentFrame)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < m_pending.size(); ++i)
+		{
+			if (m_pending[i].ReleaseFrame <= currentFrame)
+				Release(m_pending[i].Handle);
+			else
+				m_pending[kept++] = m_pending[i];
+		}
+		m_pending.resize(kept);
+	}
+
+	void Clear()
+	{
+		m_slots.clear();
+		m_pending.clear();
+		m_freeHead = HandleType::InvalidIndex;
+		m_liveCount = 0;
+	}
+
+	size_t GetLiveCount() const
+	{
+		return m_liveCount;
+	}
+	size_t GetCapacity() const
+	{
+		return m_slots.size();
+	}
+	size_t GetPendingCount() const
+	{
+		return m_pending.size();
+	}
+
+  private:
+	struct Slot
+	{
+		T Value = T();
+		uint32_t Generation = 1;
+		uint32_t NextFree = HandleType::InvalidIndex;
+		bool Alive = false;
+	};
+
+	struct PendingRelease
+	{
+		HandleType Handle;
+		uint64_t ReleaseFrame;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<PendingRelease> m_pending;
+	uint32_t m_freeHead = HandleType::InvalidIndex;
+	size_t m_liveCount = 0;
+};